@@ -74,6 +74,17 @@ namespace ranae {
       return {{ std::forward<T>(t)... }};
   }
 
+  // Runs func(begin, end) over [0, count) in chunks of at most grain items.
+  // Anything with this call signature can be handed to the passes that
+  // support running in parallel, this one just runs the chunks in order.
+  struct SerialExecutor {
+    template <typename Func>
+    void operator()(size_t count, size_t grain, Func&& func) const {
+      for (size_t begin = 0; begin < count; begin += grain)
+        func(begin, std::min(count, begin + grain));
+    }
+  };
+
 }
 
 #define defer_1(x, y) x##y
@@ -0,0 +1,576 @@
+#pragma once
+
+#include <Ranae/Common.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ranae {
+
+  // Counters every allocator here keeps, to check that a warmed up frame
+  // doesn't touch the heap: heapAllocations must not move between frames.
+  // Only the owner of the allocator should read them while it is in use.
+  struct AllocatorStats {
+    size_t allocations     = 0;  // requests served
+    size_t deallocations   = 0;  // requests given back, reset() doesn't count
+    size_t heapAllocations = 0;  // times the allocator itself asked the system for memory
+    size_t bytesReserved   = 0;  // held from the system right now
+
+    AllocatorStats& operator += (const AllocatorStats& other) {
+      allocations     += other.allocations;
+      deallocations   += other.deallocations;
+      heapAllocations += other.heapAllocations;
+      bytesReserved   += other.bytesReserved;
+      return *this;
+    }
+  };
+
+  // Bump allocator over a list of blocks. Nothing is freed on its own,
+  // reset() makes everything available again and keeps the blocks, so a
+  // warmed up arena doesn't allocate. Destructors are never run.
+  class LinearArena {
+  public:
+    static constexpr size_t DefaultBlockSize = 64 * 1024;
+
+    explicit LinearArena(size_t blockSize = DefaultBlockSize)
+      : m_blockSize{ blockSize } {}
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    LinearArena(LinearArena&&) = default;
+    LinearArena& operator=(LinearArena&&) = default;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+      rnAssert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+      while (m_block < m_blocks.size()) {
+        Block& block = m_blocks[m_block];
+        const uintptr_t base    = reinterpret_cast<uintptr_t>(block.data.get());
+        const size_t    aligned = ((base + m_offset + alignment - 1) & ~(alignment - 1)) - base;
+        if (aligned + size <= block.size) {
+          m_offset = aligned + size;
+          m_used  += size;
+          m_stats.allocations++;
+          return block.data.get() + aligned;
+        }
+        m_block++;
+        m_offset = 0;
+      }
+
+      // Oversized requests get a block to themselves.
+      const size_t blockSize = std::max(m_blockSize, size + alignment);
+      m_blocks.push_back(Block{ std::make_unique<std::byte[]>(blockSize), blockSize });
+      m_block  = m_blocks.size() - 1;
+      m_offset = 0;
+      m_stats.heapAllocations++;
+      m_stats.bytesReserved += blockSize;
+      return allocate(size, alignment);
+    }
+
+    template <typename T>
+    T* allocate(size_t count) {
+      return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Nothing to do, the memory comes back on reset().
+    void deallocate(void*, size_t, size_t = alignof(std::max_align_t)) {
+      m_stats.deallocations++;
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+      return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    void reset() {
+      m_block  = 0;
+      m_offset = 0;
+      m_used   = 0;
+    }
+
+    // Gives the memory back too.
+    void release() {
+      m_blocks.clear();
+      m_stats.bytesReserved = 0;
+      reset();
+    }
+
+    size_t used() const { return m_used; }
+
+    size_t capacity() const { return m_stats.bytesReserved; }
+
+    const AllocatorStats& stats() const { return m_stats; }
+
+  private:
+    struct Block {
+      std::unique_ptr<std::byte[]> data;
+      size_t                       size;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t m_blockSize;
+    size_t m_block  = 0;
+    size_t m_offset = 0;
+    size_t m_used   = 0;
+    AllocatorStats m_stats;
+  };
+
+  // One LinearArena per thread, for temporaries that live until the end of
+  // the frame. Each thread bumps its own arena without any locking, the
+  // first allocation from a new thread registers it. reset() rewinds every
+  // thread's arena and must only be called between frames, while nothing
+  // is allocating.
+  class FrameArena {
+  public:
+    explicit FrameArena(size_t blockSize = LinearArena::DefaultBlockSize)
+      : m_blockSize{ blockSize } {}
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // The calling thread's arena.
+    LinearArena& local() {
+      // Ids are never reused, so a stale entry from a destroyed FrameArena
+      // can't match.
+      thread_local LocalArena cache;
+      if (cache.owner != m_id) {
+        cache.owner = m_id;
+        cache.arena = &registerThread();
+      }
+      return *cache.arena;
+    }
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+      return local().allocate(size, alignment);
+    }
+
+    template <typename T>
+    T* allocate(size_t count) {
+      return local().allocate<T>(count);
+    }
+
+    void deallocate(void* ptr, size_t size, size_t alignment = alignof(std::max_align_t)) {
+      local().deallocate(ptr, size, alignment);
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+      return local().create<T>(std::forward<Args>(args)...);
+    }
+
+    void reset() {
+      std::lock_guard lock{ m_mutex };
+      for (const ThreadArena& thread : m_threads)
+        thread.arena->reset();
+    }
+
+    void release() {
+      std::lock_guard lock{ m_mutex };
+      for (const ThreadArena& thread : m_threads)
+        thread.arena->release();
+    }
+
+    size_t threadCount() const {
+      std::lock_guard lock{ m_mutex };
+      return m_threads.size();
+    }
+
+    // Summed over all threads.
+    size_t used() const {
+      std::lock_guard lock{ m_mutex };
+      size_t total = 0;
+      for (const ThreadArena& thread : m_threads)
+        total += thread.arena->used();
+      return total;
+    }
+
+    AllocatorStats stats() const {
+      std::lock_guard lock{ m_mutex };
+      AllocatorStats total;
+      for (const ThreadArena& thread : m_threads)
+        total += thread.arena->stats();
+      return total;
+    }
+
+  private:
+    struct LocalArena {
+      uint64_t     owner = 0;
+      LinearArena* arena = nullptr;
+    };
+
+    struct ThreadArena {
+      std::thread::id              thread;
+      std::unique_ptr<LinearArena> arena;
+    };
+
+    static uint64_t nextId() {
+      static std::atomic<uint64_t> s_id{ 0 };
+      return ++s_id;
+    }
+
+    LinearArena& registerThread() {
+      std::lock_guard lock{ m_mutex };
+      const std::thread::id thread = std::this_thread::get_id();
+      for (const ThreadArena& entry : m_threads) {
+        if (entry.thread == thread)
+          return *entry.arena;
+      }
+      return *m_threads.emplace_back(ThreadArena{ thread, std::make_unique<LinearArena>(m_blockSize) }).arena;
+    }
+
+    const uint64_t           m_id = nextId();
+    size_t                   m_blockSize;
+    std::vector<ThreadArena> m_threads;
+    mutable std::mutex       m_mutex;
+  };
+
+  // Fixed size blocks from a free list threaded through the free blocks
+  // themselves. Memory comes in chunks of blocksPerChunk blocks and is only
+  // given back on release(), so allocate/deallocate are a couple of loads
+  // and stores once the pool is warm. Not thread safe.
+  class PoolAllocator {
+  public:
+    static constexpr size_t DefaultBlocksPerChunk = 256;
+
+    explicit PoolAllocator(size_t blockSize, size_t alignment = alignof(std::max_align_t), size_t blocksPerChunk = DefaultBlocksPerChunk)
+      : m_blockSize     { align(std::max(blockSize, sizeof(FreeBlock)), std::max(alignment, alignof(FreeBlock))) }
+      , m_alignment     { std::max(alignment, alignof(FreeBlock)) }
+      , m_blocksPerChunk{ std::max<size_t>(blocksPerChunk, 1) } {
+      rnAssert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    }
+
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+    // Blocks still handed out become invalid.
+    ~PoolAllocator() {
+      m_live = 0;
+      release();
+    }
+
+    void* allocate() {
+      if (!m_free)
+        grow();
+
+      FreeBlock* block = m_free;
+      m_free = block->next;
+      m_live++;
+      m_stats.allocations++;
+      return block;
+    }
+
+    // Same interface as the other allocators, size and alignment must fit
+    // in a block.
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+      rnAssert(size <= m_blockSize && alignment <= m_alignment);
+      return allocate();
+    }
+
+    void deallocate(void* ptr, size_t = 0, size_t = 0) {
+      if (!ptr)
+        return;
+
+      FreeBlock* block = static_cast<FreeBlock*>(ptr);
+      block->next = m_free;
+      m_free = block;
+      m_live--;
+      m_stats.deallocations++;
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+      rnAssert(sizeof(T) <= m_blockSize && alignof(T) <= m_alignment);
+      return new (allocate()) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    void destroy(T* ptr) {
+      if (!ptr)
+        return;
+      ptr->~T();
+      deallocate(ptr);
+    }
+
+    // Every block must have been given back.
+    void release() {
+      rnAssert(m_live == 0);
+      for (std::byte* chunk : m_chunks)
+        ::operator delete(chunk, std::align_val_t{ m_alignment });
+      m_chunks.clear();
+      m_free = nullptr;
+      m_stats.bytesReserved = 0;
+    }
+
+    size_t blockSize() const { return m_blockSize; }
+    size_t alignment() const { return m_alignment; }
+
+    // Blocks handed out and not given back yet.
+    size_t live() const { return m_live; }
+
+    size_t capacity() const { return m_chunks.size() * m_blocksPerChunk; }
+
+    const AllocatorStats& stats() const { return m_stats; }
+
+  private:
+    struct FreeBlock {
+      FreeBlock* next;
+    };
+
+    void grow() {
+      const size_t chunkSize = m_blockSize * m_blocksPerChunk;
+      std::byte* chunk = static_cast<std::byte*>(::operator new(chunkSize, std::align_val_t{ m_alignment }));
+      m_chunks.push_back(chunk);
+      m_stats.heapAllocations++;
+      m_stats.bytesReserved += chunkSize;
+
+      // Linked front to back, so a fresh chunk hands out ascending addresses.
+      for (size_t i = m_blocksPerChunk; i-- > 0;) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * m_blockSize);
+        block->next = m_free;
+        m_free = block;
+      }
+    }
+
+    size_t                  m_blockSize;
+    size_t                  m_alignment;
+    size_t                  m_blocksPerChunk;
+    FreeBlock*              m_free = nullptr;
+    size_t                  m_live = 0;
+    std::vector<std::byte*> m_chunks;
+    AllocatorStats          m_stats;
+  };
+
+  namespace impl {
+
+    inline size_t pageSize() {
+#if defined(_WIN32)
+      static const size_t s_pageSize = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return size_t(info.dwPageSize);
+      }();
+#else
+      static const size_t s_pageSize = size_t(sysconf(_SC_PAGESIZE));
+#endif
+      return s_pageSize;
+    }
+
+    inline std::byte* reservePages(size_t size) {
+#if defined(_WIN32)
+      return static_cast<std::byte*>(VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS));
+#else
+      void* ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      return ptr == MAP_FAILED ? nullptr : static_cast<std::byte*>(ptr);
+#endif
+    }
+
+    inline bool commitPages(std::byte* ptr, size_t size) {
+#if defined(_WIN32)
+      return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+      return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+    }
+
+    inline void decommitPages(std::byte* ptr, size_t size) {
+#if defined(_WIN32)
+      VirtualFree(ptr, size, MEM_DECOMMIT);
+#else
+      // Drops the contents and the physical pages, keeps the range reserved.
+      mmap(ptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
+    }
+
+    inline void releasePages(std::byte* ptr, size_t size) {
+#if defined(_WIN32)
+      (void)size;
+      VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+      munmap(ptr, size);
+#endif
+    }
+
+  }
+
+  // Growable buffer that reserves its whole address range up front and
+  // commits pages as it grows. It never moves, so pointers into it stay
+  // valid, and growing never copies. Use it as a bump allocator through
+  // allocate(), or as a plain byte buffer through resize(). Not thread
+  // safe.
+  class VirtualBuffer {
+  public:
+    static constexpr size_t DefaultReserveSize = size_t(1) << 30;
+
+    explicit VirtualBuffer(size_t reserveSize = DefaultReserveSize)
+      : m_reserved{ align(reserveSize, impl::pageSize()) }
+      , m_data    { impl::reservePages(m_reserved) } {
+      if (!m_data)
+        throw std::bad_alloc{};
+    }
+
+    VirtualBuffer(const VirtualBuffer&) = delete;
+    VirtualBuffer& operator=(const VirtualBuffer&) = delete;
+
+    VirtualBuffer(VirtualBuffer&& other) noexcept
+      : m_reserved { std::exchange(other.m_reserved, 0) }
+      , m_data     { std::exchange(other.m_data, nullptr) }
+      , m_size     { std::exchange(other.m_size, 0) }
+      , m_committed{ std::exchange(other.m_committed, 0) }
+      , m_stats    { std::exchange(other.m_stats, AllocatorStats{}) } {}
+
+    VirtualBuffer& operator=(VirtualBuffer&& other) noexcept {
+      std::swap(m_reserved,  other.m_reserved);
+      std::swap(m_data,      other.m_data);
+      std::swap(m_size,      other.m_size);
+      std::swap(m_committed, other.m_committed);
+      std::swap(m_stats,     other.m_stats);
+      return *this;
+    }
+
+    ~VirtualBuffer() {
+      if (m_data)
+        impl::releasePages(m_data, m_reserved);
+    }
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+      rnAssert(alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= impl::pageSize());
+
+      const size_t offset = align(m_size, alignment);
+      resize(offset + size);
+      m_stats.allocations++;
+      return m_data + offset;
+    }
+
+    template <typename T>
+    T* allocate(size_t count) {
+      return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    void deallocate(void*, size_t, size_t = alignof(std::max_align_t)) {
+      m_stats.deallocations++;
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+      return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Grows or shrinks the used part, committing pages as needed. Pages
+    // stay committed when shrinking, see shrinkToFit().
+    void resize(size_t size) {
+      if (size > m_committed) {
+        if (size > m_reserved)
+          throw std::bad_alloc{};
+
+        // Commit in 64 KiB steps at least, to keep the syscalls rare.
+        const size_t committed = std::min(m_reserved, align(std::max(size, m_committed + CommitStep), impl::pageSize()));
+        if (!impl::commitPages(m_data + m_committed, committed - m_committed))
+          throw std::bad_alloc{};
+        m_stats.heapAllocations++;
+        m_stats.bytesReserved = committed;
+        m_committed = committed;
+      }
+      m_size = size;
+    }
+
+    void reset() { m_size = 0; }
+
+    // Gives the pages past size() back to the system.
+    void shrinkToFit() {
+      const size_t committed = align(m_size, impl::pageSize());
+      if (committed < m_committed) {
+        impl::decommitPages(m_data + committed, m_committed - committed);
+        m_stats.bytesReserved = committed;
+        m_committed = committed;
+      }
+    }
+
+    std::byte*       data()       { return m_data; }
+    const std::byte* data() const { return m_data; }
+
+    size_t size() const { return m_size; }
+
+    size_t capacity() const { return m_committed; }
+
+    // Address space set aside, the most the buffer can grow to.
+    size_t reserved() const { return m_reserved; }
+
+    const AllocatorStats& stats() const { return m_stats; }
+
+  private:
+    static constexpr size_t CommitStep = 64 * 1024;
+
+    size_t         m_reserved;
+    std::byte*     m_data;
+    size_t         m_size      = 0;
+    size_t         m_committed = 0;
+    AllocatorStats m_stats;
+  };
+
+  // std::pmr adaptor for any of the allocators above, so pmr containers
+  // can opt in: std::pmr::vector<int> v{ &resource }. The allocator must
+  // outlive the resource and everything allocated through it.
+  //
+  // Requests a PoolAllocator can't serve (bigger or more aligned than its
+  // blocks) go to the upstream resource.
+  template <typename Allocator>
+  class AllocatorResource : public std::pmr::memory_resource {
+  public:
+    explicit AllocatorResource(Allocator& allocator, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : m_allocator{ allocator }
+      , m_upstream { upstream } {}
+
+    Allocator& allocator() const { return m_allocator; }
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+      if constexpr (std::is_same_v<Allocator, PoolAllocator>) {
+        if (bytes > m_allocator.blockSize() || alignment > m_allocator.alignment())
+          return m_upstream->allocate(bytes, alignment);
+      }
+      return m_allocator.allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+      if constexpr (std::is_same_v<Allocator, PoolAllocator>) {
+        if (bytes > m_allocator.blockSize() || alignment > m_allocator.alignment())
+          return m_upstream->deallocate(ptr, bytes, alignment);
+      }
+      m_allocator.deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      const AllocatorResource* resource = dynamic_cast<const AllocatorResource*>(&other);
+      return resource && &resource->m_allocator == &m_allocator;
+    }
+
+    Allocator&                 m_allocator;
+    std::pmr::memory_resource* m_upstream;
+  };
+
+  using LinearArenaResource   = AllocatorResource<LinearArena>;
+  using FrameArenaResource    = AllocatorResource<FrameArena>;
+  using PoolResource          = AllocatorResource<PoolAllocator>;
+  using VirtualBufferResource = AllocatorResource<VirtualBuffer>;
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Ranae/Common.h>
+
+#include <atomic>
+#include <bit>
+#include <limits>
+
+namespace ranae {
+
+  // Fixed size bitset that any number of threads can set, clear and claim
+  // bits in without a lock. Meant for handing out slots (entities, pool
+  // entries, descriptor indices, ...) where a set bit means "in use".
+  //
+  // The words are packed into 64 byte cache lines. Claims pass a hint, and
+  // threads that start their search in different lines don't contend
+  // with each other until their own region fills up.
+  class AtomicBitset {
+  public:
+    static constexpr size_t CacheLineSize = 64;
+    static constexpr size_t WordsPerLine  = CacheLineSize / sizeof(uint64_t);
+    static constexpr size_t InvalidIndex  = ~size_t(0);
+
+    explicit AtomicBitset(size_t size)
+      : m_size     { size }
+      , m_wordCount{ align(size, 64) / 64 }
+      , m_lines    { std::make_unique<Line[]>(align(m_wordCount, WordsPerLine) / WordsPerLine) } {
+      clearAll();
+    }
+
+    size_t size() const { return m_size; }
+
+    bool test(size_t idx) const {
+      rnAssert(idx < m_size);
+      return word(idx / 64).load(std::memory_order_acquire) & bit(idx);
+    }
+
+    // Return the previous value of the bit. Acquire/release, so whatever
+    // the thread that set a bit wrote before is visible to the thread
+    // that clears it, and the other way around.
+    bool testAndSet(size_t idx) {
+      rnAssert(idx < m_size);
+      return word(idx / 64).fetch_or(bit(idx), std::memory_order_acq_rel) & bit(idx);
+    }
+
+    bool testAndClear(size_t idx) {
+      rnAssert(idx < m_size);
+      return word(idx / 64).fetch_and(~bit(idx), std::memory_order_acq_rel) & bit(idx);
+    }
+
+    // Sets the lowest clear bit at or after hint (wrapping around) and
+    // returns its index, or InvalidIndex if every bit is set. Give each
+    // thread its own hint, e.g. threadIndex * size() / threadCount.
+    size_t findFirstClearAndSet(size_t hint = 0) {
+      if (m_wordCount == 0)
+        return InvalidIndex;
+
+      if (hint >= m_size)
+        hint = 0;
+      const size_t   start = hint / 64;
+      const uint64_t above = ~uint64_t(0) << (hint % 64);
+
+      // hint's word is visited twice: first from hint up, and once every
+      // other word was full, below hint.
+      for (size_t n = 0; n <= m_wordCount; n++) {
+        uint64_t skip = 0;
+        if (n == 0)
+          skip = ~above;
+        else if (n == m_wordCount)
+          skip = above;
+        if (skip == std::numeric_limits<uint64_t>::max())
+          break;
+
+        const size_t w = start + n < m_wordCount ? start + n : start + n - m_wordCount;
+        std::atomic<uint64_t>& atomic = word(w);
+
+        // Losing a race to another claim just means trying the next
+        // clear bit of the same word.
+        uint64_t bits = atomic.load(std::memory_order_relaxed) | skip;
+        while (bits != std::numeric_limits<uint64_t>::max()) {
+          const uint64_t lowest = ~bits & (bits + 1);
+          bits = atomic.fetch_or(lowest, std::memory_order_acq_rel);
+          if (!(bits & lowest))
+            return w * 64 + std::countr_zero(lowest);
+          bits |= skip;
+        }
+      }
+
+      return InvalidIndex;
+    }
+
+    // Only a snapshot while other threads are changing bits.
+    size_t count() const {
+      size_t total = 0;
+      for (size_t w = 0; w < m_wordCount; w++)
+        total += std::popcount(word(w).load(std::memory_order_relaxed));
+      return total - (m_wordCount * 64 - m_size);
+    }
+
+    // Not safe to call while other threads use the set.
+    void clearAll() {
+      for (size_t w = 0; w < m_wordCount; w++)
+        word(w).store(0, std::memory_order_relaxed);
+
+      // The bits past size() stay set, so they are never claimed.
+      if (m_size % 64 != 0)
+        word(m_wordCount - 1).store(~uint64_t(0) << (m_size % 64), std::memory_order_relaxed);
+    }
+
+  private:
+    struct alignas(CacheLineSize) Line {
+      std::atomic<uint64_t> words[WordsPerLine] = {};
+    };
+
+    static uint64_t bit(size_t idx) { return uint64_t(1) << (idx % 64); }
+
+    std::atomic<uint64_t>& word(size_t w) const {
+      return m_lines[w / WordsPerLine].words[w % WordsPerLine];
+    }
+
+    size_t                  m_size;
+    size_t                  m_wordCount;
+    std::unique_ptr<Line[]> m_lines;
+  };
+
+}
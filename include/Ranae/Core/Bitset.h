@@ -1,89 +1,393 @@
 #pragma once
 
 #include <Ranae/Common.h>
+#include <Ranae/Core/Simd.h>
+
+#include <bit>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace ranae {
+
+  namespace impl {
+    // Bulk kernels over runs of 64-bit words, for DynamicBitset and large
+    // Bitsets. The SIMD paths take 2 (SSE4.1) or 4 (AVX2) words per step,
+    // whatever is left over goes through the scalar loop.
+    enum class WordOp {
+      And,
+      Or,
+      Xor,
+      AndNot,
+    };
+
+    // Below this many words the plain loops are as fast, and the compiler
+    // vectorizes them where it pays.
+    constexpr size_t KernelWordCount = 8;
+
+    template <WordOp Op>
+    constexpr uint64_t applyWord(uint64_t a, uint64_t b) {
+      if constexpr (Op == WordOp::And)
+        return a & b;
+      else if constexpr (Op == WordOp::Or)
+        return a | b;
+      else if constexpr (Op == WordOp::Xor)
+        return a ^ b;
+      else
+        return a & ~b;
+    }
 
-namespace Ranae {
+    // Bits of the last word that belong to a set of bitCount bits.
+    constexpr uint64_t tailMask(size_t bitCount) {
+      return bitCount % 64 == 0
+        ? std::numeric_limits<uint64_t>::max()
+        : (uint64_t(1) << (bitCount % 64)) - 1;
+    }
 
-  template <size_t BitCount>
-  struct Bitset {
-    static constexpr size_t DwordCount = align(BitCount, 32) / 32;
+#if RN_SIMD_SSE4
+    inline __m128i loadWords128(const uint64_t* p) {
+      return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
 
-    constexpr Bitset()
-      : dwords{ } { }
+    template <WordOp Op>
+    inline __m128i applyWord(__m128i a, __m128i b) {
+      if constexpr (Op == WordOp::And)
+        return _mm_and_si128(a, b);
+      else if constexpr (Op == WordOp::Or)
+        return _mm_or_si128(a, b);
+      else if constexpr (Op == WordOp::Xor)
+        return _mm_xor_si128(a, b);
+      else
+        return _mm_andnot_si128(b, a);
+    }
+#endif
 
+#if RN_SIMD_AVX2
+    inline __m256i loadWords256(const uint64_t* p) {
+      return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
 
-    constexpr bool get(size_t idx) const {
-      uint32_t dword = 0u;
-      uint32_t bit   = idx;
+    template <WordOp Op>
+    inline __m256i applyWord(__m256i a, __m256i b) {
+      if constexpr (Op == WordOp::And)
+        return _mm256_and_si256(a, b);
+      else if constexpr (Op == WordOp::Or)
+        return _mm256_or_si256(a, b);
+      else if constexpr (Op == WordOp::Xor)
+        return _mm256_xor_si256(a, b);
+      else
+        return _mm256_andnot_si256(b, a);
+    }
+#endif
+
+    // dst[i] = dst[i] op src[i]
+    template <WordOp Op>
+    inline void applyWords(uint64_t* dst, const uint64_t* src, size_t count) {
+      size_t i = 0;
+#if RN_SIMD_AVX2
+      for (; i < count / 4 * 4; i += 4)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), applyWord<Op>(loadWords256(dst + i), loadWords256(src + i)));
+#elif RN_SIMD_SSE4
+      for (; i < count / 2 * 2; i += 2)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), applyWord<Op>(loadWords128(dst + i), loadWords128(src + i)));
+#endif
+      for (; i < count; i++)
+        dst[i] = applyWord<Op>(dst[i], src[i]);
+    }
 
-      if constexpr (DwordCount > 1u) {
-        dword = idx / 32u;
-        bit   = idx % 32u;
+    // Whether every bit set in b is set in a.
+    inline bool containsWords(const uint64_t* a, const uint64_t* b, size_t count) {
+      size_t i = 0;
+#if RN_SIMD_AVX2
+      for (; i < count / 4 * 4; i += 4) {
+        if (!_mm256_testc_si256(loadWords256(a + i), loadWords256(b + i)))
+          return false;
+      }
+#elif RN_SIMD_SSE4
+      for (; i < count / 2 * 2; i += 2) {
+        if (!_mm_testc_si128(loadWords128(a + i), loadWords128(b + i)))
+          return false;
+      }
+#endif
+      for (; i < count; i++) {
+        if ((b[i] & ~a[i]) != 0)
+          return false;
+      }
+      return true;
+    }
+
+    inline bool intersectsWords(const uint64_t* a, const uint64_t* b, size_t count) {
+      size_t i = 0;
+#if RN_SIMD_AVX2
+      for (; i < count / 4 * 4; i += 4) {
+        if (!_mm256_testz_si256(loadWords256(a + i), loadWords256(b + i)))
+          return true;
       }
+#elif RN_SIMD_SSE4
+      for (; i < count / 2 * 2; i += 2) {
+        if (!_mm_testz_si128(loadWords128(a + i), loadWords128(b + i)))
+          return true;
+      }
+#endif
+      for (; i < count; i++) {
+        if ((a[i] & b[i]) != 0)
+          return true;
+      }
+      return false;
+    }
 
-      return dwords[dword] & (1u << bit);
+    // Index of the first non-zero word in [begin, count), or count.
+    inline size_t findWord(const uint64_t* words, size_t begin, size_t count) {
+      size_t i = begin;
+#if RN_SIMD_AVX2
+      for (; count - i >= 4; i += 4) {
+        const __m256i v = loadWords256(words + i);
+        if (!_mm256_testz_si256(v, v))
+          break;
+      }
+#elif RN_SIMD_SSE4
+      for (; count - i >= 2; i += 2) {
+        const __m128i v = loadWords128(words + i);
+        if (!_mm_testz_si128(v, v))
+          break;
+      }
+#endif
+      for (; i < count; i++) {
+        if (words[i] != 0)
+          return i;
+      }
+      return count;
     }
 
+    inline size_t countWords(const uint64_t* words, size_t count) {
+      size_t total = 0;
+      size_t i     = 0;
+#if RN_SIMD_AVX2
+      // Per-nibble lookup, summed into the 64-bit lanes by psadbw.
+      const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+      const __m256i nibble = _mm256_set1_epi8(0x0f);
+      __m256i sums = _mm256_setzero_si256();
+      for (; i < count / 4 * 4; i += 4) {
+        const __m256i v  = loadWords256(words + i);
+        const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble));
+        const __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+      }
+      total = size_t(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1)
+                   + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+#elif RN_SIMD_SSE4
+      // Same as above two words at a time. -msse4.1 alone doesn't imply
+      // the popcnt instruction, so this beats the scalar loop.
+      const __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+      const __m128i nibble = _mm_set1_epi8(0x0f);
+      __m128i sums = _mm_setzero_si128();
+      for (; i < count / 2 * 2; i += 2) {
+        const __m128i v  = loadWords128(words + i);
+        const __m128i lo = _mm_shuffle_epi8(lookup, _mm_and_si128(v, nibble));
+        const __m128i hi = _mm_shuffle_epi8(lookup, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_add_epi8(lo, hi), _mm_setzero_si128()));
+      }
+      total = size_t(_mm_extract_epi64(sums, 0) + _mm_extract_epi64(sums, 1));
+#endif
+      for (; i < count; i++)
+        total += std::popcount(words[i]);
+      return total;
+    }
 
-    constexpr void set(uint32_t idx, bool value) {
-      uint32_t dword = 0u;
-      uint32_t bit   = idx;
+    // First set bit at or after idx, or ~0.
+    inline size_t findNextBit(const uint64_t* words, size_t count, size_t idx) {
+      size_t word = idx / 64;
+      if (word >= count)
+        return ~size_t(0);
+
+      uint64_t bits = words[word] & (~uint64_t(0) << (idx % 64));
+      if (bits == 0) {
+        word = findWord(words, word + 1, count);
+        if (word == count)
+          return ~size_t(0);
+        bits = words[word];
+      }
+      return word * 64 + std::countr_zero(bits);
+    }
 
-      if constexpr (DwordCount > 1u) {
-        dword = idx / 32u;
-        bit   = idx % 32u;
+    template <typename Func>
+    void forEachSetBit(const uint64_t* words, size_t count, Func&& func) {
+      for (size_t i = findWord(words, 0, count); i < count; i = findWord(words, i + 1, count)) {
+        for (uint64_t bits = words[i]; bits != 0; bits &= bits - 1)
+          func(uint32_t(i * 64 + std::countr_zero(bits)));
       }
+    }
+  }
+
+  // Fixed size set of bits. Bits past BitCount are always clear, so the
+  // whole-set operations don't need to mask them. Sets of a few words are
+  // handled with plain loops (and a single ptest for 128/256 bit subset
+  // and overlap tests), larger ones go through the SIMD kernels.
+  template <size_t BitCount>
+  struct Bitset {
+    static_assert(BitCount > 0);
+
+    static constexpr size_t WordCount    = align(BitCount, 64) / 64;
+    static constexpr size_t InvalidIndex = ~size_t(0);
 
+    constexpr Bitset()
+      : words{ } { }
+
+
+    // A set with only idx set.
+    static constexpr Bitset single(size_t idx) {
+      Bitset result;
+      result.set(idx, true);
+      return result;
+    }
+
+
+    // Plain assert rather than rnAssert, these are usable in constant
+    // expressions.
+    constexpr bool get(size_t idx) const {
+      assert(idx < BitCount);
+      return words[idx / 64] & (uint64_t(1) << (idx % 64));
+    }
+
+
+    constexpr void set(size_t idx, bool value) {
+      assert(idx < BitCount);
       if (value)
-        dwords[dword] |= 1u << bit;
+        words[idx / 64] |= uint64_t(1) << (idx % 64);
       else
-        dwords[dword] &= ~(1u << bit);
+        words[idx / 64] &= ~(uint64_t(1) << (idx % 64));
     }
 
 
-    constexpr bool exchange(uint32_t idx, bool value) {
+    constexpr bool exchange(size_t idx, bool value) {
       bool oldValue = get(idx);
       set(idx, value);
       return oldValue;
     }
 
 
-    constexpr void flip(uint32_t idx) {
-      uint32_t dword = 0u;
-      uint32_t bit   = idx;
+    constexpr void flip(size_t idx) {
+      assert(idx < BitCount);
+      words[idx / 64] ^= uint64_t(1) << (idx % 64);
+    }
+
+
+    constexpr void setAll() {
+      for (size_t i = 0; i < WordCount - 1; i++)
+        words[i] = std::numeric_limits<uint64_t>::max();
+
+      words[WordCount - 1] = impl::tailMask(BitCount);
+    }
+
+
+    constexpr void clearAll() {
+      for (size_t i = 0; i < WordCount; i++)
+        words[i] = 0;
+    }
+
+
+    constexpr bool any() const {
+      if constexpr (UseKernels) {
+        if (!std::is_constant_evaluated())
+          return impl::findWord(words.data(), 0, WordCount) != WordCount;
+      }
+
+      for (size_t i = 0; i < WordCount; i++) {
+        if (words[i] != 0)
+          return true;
+      }
+
+      return false;
+    }
+
+
+    constexpr bool none() const {
+      return !any();
+    }
 
-      if constexpr (DwordCount > 1) {
-        dword = idx / 32u;
-        bit   = idx % 32u;
+
+    constexpr size_t count() const {
+      if constexpr (UseKernels) {
+        if (!std::is_constant_evaluated())
+          return impl::countWords(words.data(), WordCount);
       }
 
-      dwords[dword] ^= 1u << bit;
+      size_t total = 0;
+      for (size_t i = 0; i < WordCount; i++)
+        total += std::popcount(words[i]);
+      return total;
     }
 
 
-    constexpr void setAll() {
-      if constexpr (BitCount % 32u == 0u) {
-        for (size_t i = 0; i < DwordCount; i++)
-          dwords[i] = std::numeric_limits<uint32_t>::max();
+    // Index of the first set bit, or InvalidIndex.
+    constexpr size_t findFirst() const {
+      return findNext(0);
+    }
+
+
+    // Index of the first set bit at or after idx, or InvalidIndex.
+    constexpr size_t findNext(size_t idx) const {
+      if constexpr (UseKernels) {
+        if (!std::is_constant_evaluated())
+          return impl::findNextBit(words.data(), WordCount, idx);
       }
-      else {
-        for (size_t i = 0; i < DwordCount - 1u; i++)
-          dwords[i] = std::numeric_limits<uint32_t>::max();
 
-        dwords[DwordCount - 1] = (1u << (BitCount % 32u)) - 1u;
+      for (size_t i = idx / 64; i < WordCount; i++) {
+        const uint64_t bits = i == idx / 64
+          ? words[i] & (~uint64_t(0) << (idx % 64))
+          : words[i];
+        if (bits != 0)
+          return i * 64 + std::countr_zero(bits);
       }
+
+      return InvalidIndex;
     }
 
 
-    constexpr void clearAll() {
-      for (size_t i = 0; i < DwordCount; i++)
-        dwords[i] = 0u;
+    // Whether every bit of other is set here too.
+    constexpr bool contains(const Bitset& other) const {
+      if (!std::is_constant_evaluated()) {
+#if RN_SIMD_SSE4
+        if constexpr (WordCount == 2)
+          return _mm_testc_si128(impl::loadWords128(words.data()), impl::loadWords128(other.words.data()));
+#endif
+#if RN_SIMD_AVX2
+        if constexpr (WordCount == 4)
+          return _mm256_testc_si256(impl::loadWords256(words.data()), impl::loadWords256(other.words.data()));
+#endif
+        if constexpr (UseKernels)
+          return impl::containsWords(words.data(), other.words.data(), WordCount);
+      }
+
+      for (size_t i = 0; i < WordCount; i++) {
+        if ((other.words[i] & ~words[i]) != 0)
+          return false;
+      }
+
+      return true;
     }
 
 
-    constexpr bool any() const {
-      for (size_t i = 0; i < DwordCount; i++) {
-        if (dwords[i] != 0u)
+    // Whether any bit is set in both.
+    constexpr bool intersects(const Bitset& other) const {
+      if (!std::is_constant_evaluated()) {
+#if RN_SIMD_SSE4
+        if constexpr (WordCount == 2)
+          return !_mm_testz_si128(impl::loadWords128(words.data()), impl::loadWords128(other.words.data()));
+#endif
+#if RN_SIMD_AVX2
+        if constexpr (WordCount == 4)
+          return !_mm256_testz_si256(impl::loadWords256(words.data()), impl::loadWords256(other.words.data()));
+#endif
+        if constexpr (UseKernels)
+          return impl::intersectsWords(words.data(), other.words.data(), WordCount);
+      }
+
+      for (size_t i = 0; i < WordCount; i++) {
+        if ((words[i] & other.words[i]) != 0)
           return true;
       }
 
@@ -91,13 +395,264 @@ namespace Ranae {
     }
 
 
-    constexpr bool operator [] (uint32_t idx) const {
+    // Calls func(idx) for every set bit, in increasing order.
+    template <typename Func>
+    constexpr void forEachSet(Func&& func) const {
+      if constexpr (UseKernels) {
+        if (!std::is_constant_evaluated())
+          return impl::forEachSetBit(words.data(), WordCount, func);
+      }
+
+      for (size_t i = 0; i < WordCount; i++) {
+        for (uint64_t bits = words[i]; bits != 0; bits &= bits - 1)
+          func(uint32_t(i * 64 + std::countr_zero(bits)));
+      }
+    }
+
+
+    constexpr size_t hash() const {
+      uint64_t result = 0xcbf29ce484222325ull;
+      for (size_t i = 0; i < WordCount; i++)
+        result = (result ^ words[i]) * 0x100000001b3ull;
+      return size_t(result ^ (result >> 32));
+    }
+
+
+    constexpr bool operator [] (size_t idx) const {
       return get(idx);
     }
 
 
-    std::array<uint32_t, DwordCount> dwords;
+    constexpr Bitset& operator &= (const Bitset& other) {
+      return apply<impl::WordOp::And>(other);
+    }
+
+
+    constexpr Bitset& operator |= (const Bitset& other) {
+      return apply<impl::WordOp::Or>(other);
+    }
+
+
+    constexpr Bitset& operator ^= (const Bitset& other) {
+      return apply<impl::WordOp::Xor>(other);
+    }
+
+
+    // Clears every bit that is set in other.
+    constexpr Bitset& andNot(const Bitset& other) {
+      return apply<impl::WordOp::AndNot>(other);
+    }
+
+
+    friend constexpr Bitset operator & (Bitset a, const Bitset& b) { return a &= b; }
+    friend constexpr Bitset operator | (Bitset a, const Bitset& b) { return a |= b; }
+    friend constexpr Bitset operator ^ (Bitset a, const Bitset& b) { return a ^= b; }
+
+
+    constexpr Bitset operator ~ () const {
+      Bitset result;
+      for (size_t i = 0; i < WordCount; i++)
+        result.words[i] = ~words[i];
+      result.words[WordCount - 1] &= impl::tailMask(BitCount);
+      return result;
+    }
+
+
+    constexpr bool operator == (const Bitset& other) const = default;
+
+
+    std::array<uint64_t, WordCount> words;
+
+  private:
+    static constexpr bool UseKernels = WordCount >= impl::KernelWordCount;
+
+    template <impl::WordOp Op>
+    constexpr Bitset& apply(const Bitset& other) {
+      if constexpr (UseKernels) {
+        if (!std::is_constant_evaluated()) {
+          impl::applyWords<Op>(words.data(), other.words.data(), WordCount);
+          return *this;
+        }
+      }
+
+      for (size_t i = 0; i < WordCount; i++)
+        words[i] = impl::applyWord<Op>(words[i], other.words[i]);
+      return *this;
+    }
+  };
+
+  template <size_t BitCount>
+  struct BitsetHash {
+    size_t operator()(const Bitset<BitCount>& bitset) const { return bitset.hash(); }
+  };
+
+
+  // Bitset sized at runtime, for masks over all entities or resources
+  // (alive, dirty, visible, ...). Bits past size() are always clear.
+  // Whole-set operations need both sides to be the same size.
+  class DynamicBitset {
+  public:
+    static constexpr size_t InvalidIndex = ~size_t(0);
+
+    DynamicBitset() = default;
+
+    explicit DynamicBitset(size_t size, bool value = false) {
+      resize(size, value);
+    }
+
+
+    // New bits are set to value, the existing ones are kept.
+    void resize(size_t size, bool value = false) {
+      const size_t oldSize = m_size;
+      m_words.resize(align(size, 64) / 64, value ? std::numeric_limits<uint64_t>::max() : 0);
+      m_size = size;
+
+      if (value && oldSize < size && oldSize % 64 != 0)
+        m_words[oldSize / 64] |= ~impl::tailMask(oldSize);
+      clearTail();
+    }
+
+
+    size_t size() const { return m_size; }
+
+    std::span<const uint64_t> words() const { return m_words; }
+
+
+    bool get(size_t idx) const {
+      rnAssert(idx < m_size);
+      return m_words[idx / 64] & (uint64_t(1) << (idx % 64));
+    }
+
+
+    void set(size_t idx, bool value) {
+      rnAssert(idx < m_size);
+      if (value)
+        m_words[idx / 64] |= uint64_t(1) << (idx % 64);
+      else
+        m_words[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+    }
+
+
+    bool exchange(size_t idx, bool value) {
+      bool oldValue = get(idx);
+      set(idx, value);
+      return oldValue;
+    }
+
+
+    void flip(size_t idx) {
+      rnAssert(idx < m_size);
+      m_words[idx / 64] ^= uint64_t(1) << (idx % 64);
+    }
+
+
+    void setAll() {
+      std::fill(m_words.begin(), m_words.end(), std::numeric_limits<uint64_t>::max());
+      clearTail();
+    }
+
+
+    void clearAll() {
+      std::fill(m_words.begin(), m_words.end(), 0);
+    }
+
+
+    bool any() const {
+      return impl::findWord(m_words.data(), 0, m_words.size()) != m_words.size();
+    }
+
+
+    bool none() const {
+      return !any();
+    }
+
+
+    size_t count() const {
+      return impl::countWords(m_words.data(), m_words.size());
+    }
+
+
+    size_t findFirst() const {
+      return findNext(0);
+    }
+
+
+    size_t findNext(size_t idx) const {
+      return impl::findNextBit(m_words.data(), m_words.size(), idx);
+    }
+
+
+    bool contains(const DynamicBitset& other) const {
+      rnAssert(m_size == other.m_size);
+      return impl::containsWords(m_words.data(), other.m_words.data(), m_words.size());
+    }
+
+
+    bool intersects(const DynamicBitset& other) const {
+      rnAssert(m_size == other.m_size);
+      return impl::intersectsWords(m_words.data(), other.m_words.data(), m_words.size());
+    }
+
+
+    // Skips over empty runs of words at a time, so sparse masks over a
+    // lot of entities are cheap to walk.
+    template <typename Func>
+    void forEachSet(Func&& func) const {
+      impl::forEachSetBit(m_words.data(), m_words.size(), func);
+    }
+
+
+    bool operator [] (size_t idx) const {
+      return get(idx);
+    }
+
+
+    DynamicBitset& operator &= (const DynamicBitset& other) {
+      return apply<impl::WordOp::And>(other);
+    }
+
+
+    DynamicBitset& operator |= (const DynamicBitset& other) {
+      return apply<impl::WordOp::Or>(other);
+    }
+
+
+    DynamicBitset& operator ^= (const DynamicBitset& other) {
+      return apply<impl::WordOp::Xor>(other);
+    }
+
+
+    DynamicBitset& andNot(const DynamicBitset& other) {
+      return apply<impl::WordOp::AndNot>(other);
+    }
+
+
+    DynamicBitset operator ~ () const {
+      DynamicBitset result = *this;
+      for (uint64_t& word : result.m_words)
+        word = ~word;
+      result.clearTail();
+      return result;
+    }
+
+
+    bool operator == (const DynamicBitset& other) const = default;
+
+  private:
+    template <impl::WordOp Op>
+    DynamicBitset& apply(const DynamicBitset& other) {
+      rnAssert(m_size == other.m_size);
+      impl::applyWords<Op>(m_words.data(), other.m_words.data(), m_words.size());
+      return *this;
+    }
+
+    void clearTail() {
+      if (!m_words.empty())
+        m_words.back() &= impl::tailMask(m_size);
+    }
 
+    std::vector<uint64_t> m_words;
+    size_t                m_size = 0;
   };
 
-}
\ No newline at end of file
+}
@@ -2,6 +2,10 @@
 
 #include <Ranae/Common.h>
 
+#include <bit>
+#include <cstring>
+#include <string_view>
+
 namespace ranae {
 
   constexpr uint32_t hash_string(const char* s, size_t count) {
@@ -12,4 +16,107 @@ namespace ranae {
     return hash_string(s, count);
   }
 
-}
\ No newline at end of file
+  namespace impl {
+    // Little endian loads, byte by byte when constant evaluated.
+    template <typename T>
+    constexpr T hashRead(const char* p) {
+      if (std::is_constant_evaluated() || std::endian::native != std::endian::little) {
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); i++)
+          value |= T(uint8_t(p[i])) << (i * 8);
+        return value;
+      }
+
+      T value;
+      std::memcpy(&value, p, sizeof(T));
+      return value;
+    }
+
+    constexpr uint64_t hashRead3(const char* p, size_t count) {
+      return uint64_t(uint8_t(p[0])) << 16 | uint64_t(uint8_t(p[count >> 1])) << 8 | uint8_t(p[count - 1]);
+    }
+
+    // 64x64 -> 128 bit multiply, returning both halves.
+    constexpr void hashMultiply(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+      const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+      a = uint64_t(r);
+      b = uint64_t(r >> 64);
+#else
+      const uint64_t ha = a >> 32, hb = b >> 32, la = uint32_t(a), lb = uint32_t(b);
+      const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+      const uint64_t t  = rl + (rm0 << 32);
+      const uint64_t lo = t + (rm1 << 32);
+      const uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+      a = lo;
+      b = hi;
+#endif
+    }
+
+    constexpr uint64_t hashMix(uint64_t a, uint64_t b) {
+      hashMultiply(a, b);
+      return a ^ b;
+    }
+
+    constexpr uint64_t HashSecret[4] = {
+      0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull,
+    };
+  }
+
+  // 64-bit hash of arbitrary bytes, after wyhash: strings up to 16 bytes
+  // are a couple of multiplies, longer ones are consumed 48 bytes per step
+  // over three independent lanes. The same function runs at compile time,
+  // so "name"_hash64 matches hash64("name") computed at runtime.
+  constexpr uint64_t hash64(const char* data, size_t count, uint64_t seed = 0) {
+    using namespace impl;
+
+    const char* p = data;
+    seed ^= hashMix(seed ^ HashSecret[0], HashSecret[1]);
+
+    uint64_t a = 0, b = 0;
+    if (count <= 16) {
+      if (count >= 4) {
+        const size_t offset = (count >> 3) << 2;
+        a = uint64_t(hashRead<uint32_t>(p)) << 32 | hashRead<uint32_t>(p + offset);
+        b = uint64_t(hashRead<uint32_t>(p + count - 4)) << 32 | hashRead<uint32_t>(p + count - 4 - offset);
+      } else if (count > 0) {
+        a = hashRead3(p, count);
+      }
+    } else {
+      size_t remaining = count;
+      if (remaining > 48) {
+        uint64_t lane1 = seed, lane2 = seed;
+        do {
+          seed  = hashMix(hashRead<uint64_t>(p)      ^ HashSecret[1], hashRead<uint64_t>(p + 8)  ^ seed);
+          lane1 = hashMix(hashRead<uint64_t>(p + 16) ^ HashSecret[2], hashRead<uint64_t>(p + 24) ^ lane1);
+          lane2 = hashMix(hashRead<uint64_t>(p + 32) ^ HashSecret[3], hashRead<uint64_t>(p + 40) ^ lane2);
+          p         += 48;
+          remaining -= 48;
+        } while (remaining > 48);
+        seed ^= lane1 ^ lane2;
+      }
+      while (remaining > 16) {
+        seed = hashMix(hashRead<uint64_t>(p) ^ HashSecret[1], hashRead<uint64_t>(p + 8) ^ seed);
+        p         += 16;
+        remaining -= 16;
+      }
+      a = hashRead<uint64_t>(p + remaining - 16);
+      b = hashRead<uint64_t>(p + remaining - 8);
+    }
+
+    a ^= HashSecret[1];
+    b ^= seed;
+    hashMultiply(a, b);
+    return hashMix(a ^ HashSecret[0] ^ count, b ^ HashSecret[1]);
+  }
+
+  constexpr uint64_t hash64(std::string_view s, uint64_t seed = 0) {
+    return hash64(s.data(), s.size(), seed);
+  }
+
+  // Unlike _hash, the terminating null is not part of the key.
+  constexpr uint64_t operator"" _hash64(const char* s, size_t count) {
+    return hash64(s, count);
+  }
+
+}
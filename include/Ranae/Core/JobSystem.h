@@ -0,0 +1,585 @@
+#pragma once
+
+#include <Ranae/Common.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ranae {
+
+  // Chase-Lev work stealing deque. The owning thread pushes and pops the
+  // bottom without taking a lock, any other thread may steal from the top.
+  // Only the last item left is contended, owner and thieves settle it with
+  // one CAS. Holds pointer sized, trivially copyable items.
+  //
+  // Grows when full. Old buffers are kept until the deque is destroyed,
+  // a thief may still be reading from one.
+  template <typename T>
+  class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>);
+  public:
+    static constexpr size_t DefaultCapacity = 256;
+
+    explicit WorkStealingDeque(size_t capacity = DefaultCapacity) {
+      rnAssert(capacity != 0 && (capacity & (capacity - 1)) == 0);
+      m_buffers.push_back(std::make_unique<Buffer>(capacity));
+      m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only.
+    void push(T item) {
+      const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+      const int64_t top    = m_top.load(std::memory_order_acquire);
+      Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+      if (bottom - top >= int64_t(buffer->capacity()))
+        buffer = grow(buffer, top, bottom);
+
+      buffer->put(bottom, item);
+      // Release, so a thief that sees the new bottom sees the item too.
+      m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner only. Newest first, false if empty.
+    bool pop(T& item) {
+      const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+      Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+      m_bottom.store(bottom, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t top = m_top.load(std::memory_order_relaxed);
+
+      if (top > bottom) {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+      }
+
+      item = buffer->get(bottom);
+      if (top == bottom) {
+        // The last item, a thief may be after it as well.
+        const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+      }
+      return true;
+    }
+
+    // Any thread. Oldest first. Also false when losing a race for the item
+    // to another thread, so an empty result is not proof the deque is empty.
+    bool steal(T& item) {
+      int64_t top = m_top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+      if (top >= bottom)
+        return false;
+
+      item = m_buffer.load(std::memory_order_acquire)->get(top);
+      return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // Only a snapshot unless called by the owner with no thieves around.
+    size_t size() const {
+      const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+      const int64_t top    = m_top.load(std::memory_order_relaxed);
+      return bottom > top ? size_t(bottom - top) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+  private:
+    class Buffer {
+    public:
+      explicit Buffer(size_t capacity)
+        : m_mask { capacity - 1 }
+        , m_items{ std::make_unique<std::atomic<T>[]>(capacity) } {}
+
+      size_t capacity() const { return m_mask + 1; }
+
+      T get(int64_t index) const { return m_items[size_t(index) & m_mask].load(std::memory_order_relaxed); }
+      void put(int64_t index, T item) { m_items[size_t(index) & m_mask].store(item, std::memory_order_relaxed); }
+
+    private:
+      size_t                            m_mask;
+      std::unique_ptr<std::atomic<T>[]> m_items;
+    };
+
+    Buffer* grow(Buffer* buffer, int64_t top, int64_t bottom) {
+      Buffer* bigger = m_buffers.emplace_back(std::make_unique<Buffer>(buffer->capacity() * 2)).get();
+      for (int64_t i = top; i < bottom; i++)
+        bigger->put(i, buffer->get(i));
+      m_buffer.store(bigger, std::memory_order_release);
+      return bigger;
+    }
+
+    // Top and bottom on their own cache lines, thieves hammer on top.
+    alignas(64) std::atomic<int64_t> m_top{ 0 };
+    alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+    std::atomic<Buffer*>                 m_buffer;
+    std::vector<std::unique_ptr<Buffer>> m_buffers;
+  };
+
+  namespace impl {
+    // What parallelFor reduces.
+    struct NoResult {};
+
+    template <typename T, typename Map, typename Reduce>
+    struct ParallelRange;
+  }
+
+  // Jobs started through a JobSystem against this counter that have not
+  // finished yet. Must outlive the jobs counted on it, and the jobs
+  // waiting on it through JobSystem::runAfter.
+  class JobCounter {
+  public:
+    bool done() const { return m_pending.load(std::memory_order_seq_cst) == 0; }
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_pending{ 0 };
+  };
+
+  namespace impl {
+    // A queued job. Callables up to InlineSize bytes live in storage, bigger
+    // ones on the heap with storage holding the pointer. call runs the
+    // callable (or not, when dropping it) and destroys it.
+    struct JobEntry {
+      static constexpr size_t InlineSize = 48;
+
+      alignas(std::max_align_t) unsigned char storage[InlineSize];
+      void        (*call)(JobEntry& entry, bool run);
+      JobCounter* counter;
+      JobEntry*   nextFree;
+    };
+
+    // Entries freed by this thread, reused by the next jobs it starts.
+    // Capped, since a thread that only runs jobs others started would
+    // otherwise collect all of them.
+    struct JobEntryCache {
+      static constexpr size_t MaxSize = 1024;
+
+      JobEntry* head = nullptr;
+      size_t    size = 0;
+
+      ~JobEntryCache() {
+        while (head) {
+          JobEntry* next = head->nextFree;
+          delete head;
+          head = next;
+        }
+      }
+    };
+  }
+
+  // Fixed pool of worker threads, each with its own work stealing deque.
+  // A worker pushes and pops the bottom of its own deque and steals from
+  // the top of the others when it runs dry. Threads that are not workers
+  // share one locked queue, and help run jobs while they wait on a counter.
+  //
+  // Also an executor: operator()(count, grain, func(begin, end)) is
+  // parallelFor, the same shape SerialExecutor has.
+  //
+  // Starting a job doesn't allocate in the common case: small callables
+  // are stored inline in the job's entry, and entries are recycled through
+  // a per-thread free list. Sleeping workers are only woken (which takes a
+  // lock) when there are any.
+  class JobSystem {
+  public:
+    using Job = std::function<void()>;
+
+    static size_t defaultWorkerCount() {
+      const size_t threads = std::thread::hardware_concurrency();
+      return threads > 1 ? threads - 1 : 0;
+    }
+
+    explicit JobSystem(size_t workerCount = defaultWorkerCount()) {
+      // Index 0 is the shared queue, it has no deque.
+      m_deques.resize(workerCount + 1);
+      for (size_t i = 1; i < workerCount + 1; i++)
+        m_deques[i] = std::make_unique<WorkStealingDeque<Entry*>>();
+
+      m_threads.reserve(workerCount);
+      for (size_t i = 0; i < workerCount; i++)
+        m_threads.emplace_back([this, i] { workerLoop(i + 1); });
+    }
+
+    // Outstanding jobs are finished first. Jobs still waiting on a counter
+    // that never finished are dropped.
+    ~JobSystem() {
+      {
+        std::lock_guard lock{ m_sleepMutex };
+        m_stop = true;
+      }
+      m_wake.notify_all();
+      for (auto& thread : m_threads)
+        thread.join();
+
+      for (const Deferred& deferred : m_deferred) {
+        deferred.entry->call(*deferred.entry, false);
+        releaseEntry(deferred.entry);
+      }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    size_t workerCount() const { return m_threads.size(); }
+
+    // Workers plus the thread waiting on them.
+    size_t threadCount() const { return m_threads.size() + 1; }
+
+    // In [0, threadCount()). Workers are 1 and up, any other thread is 0.
+    size_t threadIndex() const { return queueIndex(); }
+
+    // job is any void() callable.
+    template <typename Func>
+    void run(JobCounter& counter, Func&& job) {
+      counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+      enqueue(makeEntry(counter, std::forward<Func>(job)));
+    }
+
+    // Like run, but the job is only queued once dependency is done. The
+    // jobs dependency counts must all have been started by then, one
+    // started later doesn't hold it back if the counter already drained.
+    template <typename Func>
+    void runAfter(const JobCounter& dependency, JobCounter& counter, Func&& job) {
+      counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+      Entry* entry = makeEntry(counter, std::forward<Func>(job));
+
+      {
+        std::lock_guard lock{ m_deferMutex };
+        // Seq_cst against the decrement in finish(): either it sees this
+        // job parked, or this sees the dependency done.
+        m_deferredCount.fetch_add(1, std::memory_order_seq_cst);
+        if (!dependency.done()) {
+          m_deferred.push_back(Deferred{ &dependency, entry });
+          return;
+        }
+        m_deferredCount.fetch_sub(1, std::memory_order_relaxed);
+      }
+      enqueue(entry);
+    }
+
+    // Runs queued jobs until everything counted on counter has finished.
+    void wait(JobCounter& counter) {
+      const size_t self = queueIndex();
+      while (!counter.done()) {
+        if (!runOne(self))
+          std::this_thread::yield();
+      }
+    }
+
+    // Calls func(begin, end) over [0, count) in chunks of at most grain
+    // items, starting at multiples of grain, and returns once all of them
+    // ran. The calling thread takes part.
+    //
+    // Chunking adapts to the load: a thread working through a range only
+    // splits off the upper half as a new job when its own queue is empty,
+    // so idle threads have something to steal. A busy system ends up with
+    // a few large jobs, an idle one with as many as it has threads.
+    template <typename Func>
+    void parallelFor(size_t count, size_t grain, Func&& func) {
+      parallelReduce(count, grain, impl::NoResult{}, [&func](size_t begin, size_t end) {
+        func(begin, end);
+        return impl::NoResult{};
+      }, [](impl::NoResult, impl::NoResult) { return impl::NoResult{}; });
+    }
+
+    template <typename Func>
+    void parallelFor(size_t count, Func&& func) {
+      parallelFor(count, defaultGrain(count), std::forward<Func>(func));
+    }
+
+    // Combines map(begin, end) of every chunk with reduce(T, T), starting
+    // from identity. Chunks are formed as in parallelFor, and results are
+    // combined in no particular order, so reduce must be associative and
+    // commutative.
+    template <typename T, typename Map, typename Reduce>
+    T parallelReduce(size_t count, size_t grain, T identity, Map&& map, Reduce&& reduce) {
+      rnAssert(grain > 0);
+      if (count <= grain || m_threads.empty()) {
+        T result = identity;
+        for (size_t begin = 0; begin < count; begin += grain)
+          result = reduce(std::move(result), map(begin, std::min(count, begin + grain)));
+        return result;
+      }
+
+      JobCounter counter;
+      T          result = identity;
+      std::mutex mutex;
+      const impl::ParallelRange<T, Map, Reduce> range{ *this, counter, count, grain, identity, map, reduce, result, mutex };
+      range(0, (count + grain - 1) / grain);
+      wait(counter);
+      return result;
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    T parallelReduce(size_t count, T identity, Map&& map, Reduce&& reduce) {
+      return parallelReduce(count, defaultGrain(count), std::move(identity), std::forward<Map>(map), std::forward<Reduce>(reduce));
+    }
+
+    template <typename Func>
+    void operator()(size_t count, size_t grain, Func&& func) {
+      parallelFor(count, grain, std::forward<Func>(func));
+    }
+
+    // Whether the calling thread has nothing queued that others could
+    // steal, the cue for splitting up more work.
+    bool localQueueEmpty() const {
+      const size_t self = queueIndex();
+      return self != 0 ? m_deques[self]->empty() : m_sharedCount.load(std::memory_order_relaxed) == 0;
+    }
+
+  private:
+    using Entry      = impl::JobEntry;
+    using EntryCache = impl::JobEntryCache;
+
+    struct Deferred {
+      const JobCounter* dependency;
+      Entry*            entry;
+    };
+
+    // Small enough to keep the split checks rare, small enough that there
+    // are plenty of chunks to go around.
+    size_t defaultGrain(size_t count) const {
+      return std::max<size_t>(1, count / (threadCount() * 64));
+    }
+
+    // Workers own queues 1..n, everyone else shares queue 0.
+    size_t queueIndex() const {
+      return t_owner == this ? t_queue : 0;
+    }
+
+    template <typename Func>
+    static Entry* makeEntry(JobCounter& counter, Func&& job) {
+      using F = std::decay_t<Func>;
+
+      EntryCache& cache = t_entries;
+      Entry* entry = cache.head;
+      if (entry) {
+        cache.head = entry->nextFree;
+        cache.size--;
+      } else {
+        entry = new Entry;
+      }
+
+      if constexpr (sizeof(F) <= Entry::InlineSize && alignof(F) <= alignof(std::max_align_t)) {
+        ::new (entry->storage) F(std::forward<Func>(job));
+        entry->call = [](Entry& self, bool run) {
+          F& f = *std::launder(reinterpret_cast<F*>(self.storage));
+          if (run)
+            f();
+          f.~F();
+        };
+      } else {
+        ::new (entry->storage) F*(new F(std::forward<Func>(job)));
+        entry->call = [](Entry& self, bool run) {
+          F* f = *std::launder(reinterpret_cast<F**>(self.storage));
+          if (run)
+            (*f)();
+          delete f;
+        };
+      }
+      entry->counter = &counter;
+      return entry;
+    }
+
+    static void releaseEntry(Entry* entry) {
+      EntryCache& cache = t_entries;
+      if (cache.size >= EntryCache::MaxSize) {
+        delete entry;
+        return;
+      }
+      entry->nextFree = cache.head;
+      cache.head = entry;
+      cache.size++;
+    }
+
+    void enqueue(Entry* entry) {
+      // Seq_cst against the sleeper count, see workerLoop.
+      m_queued.fetch_add(1, std::memory_order_seq_cst);
+
+      const size_t self = queueIndex();
+      if (self != 0) {
+        m_deques[self]->push(entry);
+      } else {
+        std::lock_guard lock{ m_sharedMutex };
+        m_shared.push_back(entry);
+        m_sharedCount.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      if (m_sleeping.load(std::memory_order_seq_cst) != 0) {
+        // Pairs with the predicate check in workerLoop so the wake up
+        // can't be lost.
+        {
+          std::lock_guard lock{ m_sleepMutex };
+        }
+        m_wake.notify_one();
+      }
+    }
+
+    bool popShared(Entry*& entry) {
+      if (m_sharedCount.load(std::memory_order_relaxed) == 0)
+        return false;
+
+      std::lock_guard lock{ m_sharedMutex };
+      if (m_shared.empty())
+        return false;
+
+      entry = m_shared.front();
+      m_shared.pop_front();
+      m_sharedCount.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    bool take(size_t self, Entry*& entry) {
+      if (self != 0 ? m_deques[self]->pop(entry) : popShared(entry))
+        return true;
+
+      const size_t count = m_deques.size();
+      for (size_t i = 1; i < count; i++) {
+        const size_t victim = (self + i) % count;
+        if (victim != 0 ? m_deques[victim]->steal(entry) : popShared(entry))
+          return true;
+      }
+      return false;
+    }
+
+    bool runOne(size_t self) {
+      if (m_queued.load(std::memory_order_acquire) == 0)
+        return false;
+
+      Entry* entry;
+      if (!take(self, entry))
+        return false;
+
+      m_queued.fetch_sub(1, std::memory_order_relaxed);
+      finish(entry);
+      return true;
+    }
+
+    void finish(Entry* entry) {
+      // The job and whatever it captured go before it is counted as done.
+      entry->call(*entry, true);
+      JobCounter& counter = *entry->counter;
+      releaseEntry(entry);
+      if (counter.m_pending.fetch_sub(1, std::memory_order_seq_cst) == 1 && m_deferredCount.load(std::memory_order_seq_cst) != 0)
+        releaseDeferred();
+    }
+
+    // Counter is not touched past this point, it may be gone already.
+    // Everything parked on a counter that is done now gets queued instead.
+    void releaseDeferred() {
+      std::vector<Entry*> ready;
+      {
+        std::lock_guard lock{ m_deferMutex };
+        for (size_t i = 0; i < m_deferred.size();) {
+          if (m_deferred[i].dependency->done()) {
+            ready.push_back(m_deferred[i].entry);
+            m_deferred[i] = m_deferred.back();
+            m_deferred.pop_back();
+            m_deferredCount.fetch_sub(1, std::memory_order_relaxed);
+          } else {
+            i++;
+          }
+        }
+      }
+      for (Entry* entry : ready)
+        enqueue(entry);
+    }
+
+    void workerLoop(size_t index) {
+      t_owner = this;
+      t_queue = index;
+
+      for (;;) {
+        if (runOne(index))
+          continue;
+
+        // Announced before checking for work, and enqueue counts the job
+        // before checking for sleepers: at least one of the two sees the
+        // other, so a job is never left behind with everyone asleep.
+        std::unique_lock lock{ m_sleepMutex };
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        m_wake.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_seq_cst) != 0; });
+        m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+        if (m_stop && m_queued.load(std::memory_order_acquire) == 0)
+          return;
+      }
+    }
+
+    static inline thread_local const JobSystem* t_owner = nullptr;
+    static inline thread_local size_t           t_queue = 0;
+    static inline thread_local EntryCache       t_entries;
+
+    std::vector<std::unique_ptr<WorkStealingDeque<Entry*>>> m_deques;
+    std::vector<std::thread>                                m_threads;
+
+    std::mutex          m_sharedMutex;
+    std::deque<Entry*>  m_shared;
+    std::atomic<size_t> m_sharedCount{ 0 };
+
+    std::mutex            m_deferMutex;
+    std::vector<Deferred> m_deferred;
+    std::atomic<size_t>   m_deferredCount{ 0 };
+
+    std::atomic<size_t>     m_queued{ 0 };
+    std::atomic<uint32_t>   m_sleeping{ 0 };
+    std::mutex              m_sleepMutex;
+    std::condition_variable m_wake;
+    bool                    m_stop = false;
+  };
+
+  namespace impl {
+
+    // One job's share of a parallelReduce, a run of chunks in units of
+    // grain. Work is split off the top while the thread's queue is empty.
+    template <typename T, typename Map, typename Reduce>
+    struct ParallelRange {
+      JobSystem&  jobs;
+      JobCounter& counter;
+      size_t      count;
+      size_t      grain;
+      const T&    identity;
+      Map&        map;
+      Reduce&     reduce;
+      T&          result;
+      std::mutex& mutex;
+
+      void operator()(size_t first, size_t last) const {
+        T value = identity;
+        while (first < last) {
+          if (last - first > 1 && jobs.localQueueEmpty()) {
+            const size_t middle = first + (last - first) / 2;
+            // Splits all point back at the first range, which outlives
+            // them (parallelReduce waits), so the job stays small.
+            jobs.run(counter, [range = this, middle, last] { (*range)(middle, last); });
+            last = middle;
+            continue;
+          }
+
+          const size_t begin = first * grain;
+          value = reduce(std::move(value), map(begin, std::min(count, begin + grain)));
+          first++;
+        }
+
+        if constexpr (!std::is_empty_v<T>) {
+          std::lock_guard lock{ mutex };
+          result = reduce(std::move(result), std::move(value));
+        }
+      }
+    };
+
+  }
+
+}
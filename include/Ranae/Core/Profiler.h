@@ -0,0 +1,383 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Core/Hash.h>
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+  #define RN_PROFILE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define RN_PROFILE_RDTSC 1
+#else
+  #define RN_PROFILE_RDTSC 0
+#endif
+
+namespace ranae {
+
+  enum class ProfileEventType : uint32_t {
+    Zone,     // data is the end tick
+    Counter,  // data is the value, a double's bits
+    Frame,    // data is the frame number
+  };
+
+  struct ProfileEvent {
+    uint64_t         begin;
+    uint64_t         data;
+    uint32_t         name;    // hash_string of the name, as _hash gives it
+    ProfileEventType type;
+    uint32_t         thread;  // index in Profiler::threadNames()
+
+    double value() const { return std::bit_cast<double>(data); }
+  };
+
+  // One thread's events. Only the owning thread writes, and it never
+  // waits: the oldest events get overwritten when the ring is full. A
+  // reader copies the ring and then drops whatever the writer may have
+  // overwritten in the meantime.
+  class ProfileBuffer {
+  public:
+    static constexpr size_t Capacity = size_t(1) << 16;
+
+    explicit ProfileBuffer(uint32_t thread)
+      : m_slots { std::make_unique<Slot[]>(Capacity) }
+      , m_thread{ thread } {}
+
+    void write(uint64_t begin, uint64_t data, uint32_t name, ProfileEventType type) {
+      const uint64_t head = m_head.load(std::memory_order_relaxed);
+      Slot& slot = m_slots[head & (Capacity - 1)];
+      slot.begin.store(begin, std::memory_order_relaxed);
+      slot.data.store(data, std::memory_order_relaxed);
+      slot.info.store(uint64_t(type) << 32 | name, std::memory_order_relaxed);
+      m_head.store(head + 1, std::memory_order_release);
+    }
+
+    // Appends the newest Capacity - 1 events, oldest first. The slot of
+    // the oldest one is where the next write goes.
+    void collect(std::vector<ProfileEvent>& events) const {
+      const uint64_t head  = m_head.load(std::memory_order_acquire);
+      const uint64_t start = std::max(m_floor.load(std::memory_order_relaxed), head >= Capacity ? head - Capacity + 1 : 0);
+
+      const size_t first = events.size();
+      for (uint64_t i = start; i < head; i++) {
+        const Slot& slot = m_slots[i & (Capacity - 1)];
+        const uint64_t info = slot.info.load(std::memory_order_relaxed);
+        events.push_back(ProfileEvent{
+          slot.begin.load(std::memory_order_relaxed), slot.data.load(std::memory_order_relaxed),
+          uint32_t(info), ProfileEventType(info >> 32), m_thread });
+      }
+
+      // Index i may be torn once the writer started on i + Capacity.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const uint64_t after = m_head.load(std::memory_order_relaxed);
+      if (after + 1 > start + Capacity) {
+        const size_t torn = size_t(std::min(head - start, after + 1 - Capacity - start));
+        events.erase(events.begin() + first, events.begin() + first + torn);
+      }
+    }
+
+    // Hides everything written so far from collect().
+    void clear() { m_floor.store(m_head.load(std::memory_order_acquire), std::memory_order_relaxed); }
+
+    uint32_t thread() const { return m_thread; }
+
+  private:
+    struct Slot {
+      std::atomic<uint64_t> begin;
+      std::atomic<uint64_t> data;
+      std::atomic<uint64_t> info;
+    };
+
+    std::unique_ptr<Slot[]>           m_slots;
+    alignas(64) std::atomic<uint64_t> m_head{ 0 };
+    alignas(64) std::atomic<uint64_t> m_floor{ 0 };
+    uint32_t                          m_thread;
+  };
+
+  // Process wide event recorder behind RN_ZONE, RN_COUNTER and RN_FRAME.
+  // Recording is a thread local lookup and a few stores into that thread's
+  // ProfileBuffer. Buffers are created on a thread's first event and kept
+  // until the process ends, so events of threads that exited can still be
+  // dumped.
+  class Profiler {
+  public:
+    // Raw timestamp: the TSC where there is one, steady_clock otherwise.
+    static uint64_t now() {
+#if RN_PROFILE_RDTSC
+      return __rdtsc();
+#else
+      return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    static void zone(uint32_t name, uint64_t begin, uint64_t end) {
+      buffer().write(begin, end, name, ProfileEventType::Zone);
+    }
+
+    static void counter(uint32_t name, double value) {
+      buffer().write(now(), std::bit_cast<uint64_t>(value), name, ProfileEventType::Counter);
+    }
+
+    // Marks the start of a new frame, call it once per frame from the main
+    // loop.
+    static void frame() {
+      const uint64_t frame = state().frame.fetch_add(1, std::memory_order_relaxed);
+      buffer().write(now(), frame, "Frame"_hash, ProfileEventType::Frame);
+    }
+
+    // Makes hash resolvable to name in dumps. RN_ZONE and RN_COUNTER do
+    // this on their first use.
+    static void registerName(uint32_t hash, const char* name) {
+      State& s = state();
+      std::lock_guard lock{ s.mutex };
+      for (const auto& [known, _] : s.names) {
+        if (known == hash)
+          return;
+      }
+      s.names.emplace_back(hash, name);
+    }
+
+    static const char* name(uint32_t hash) {
+      State& s = state();
+      std::lock_guard lock{ s.mutex };
+      for (const auto& [known, name] : s.names) {
+        if (known == hash)
+          return name;
+      }
+      return nullptr;
+    }
+
+    static void setThreadName(const char* name) {
+      ProfileBuffer& thread = buffer();
+      State& s = state();
+      std::lock_guard lock{ s.mutex };
+      s.threadNames[thread.thread()] = name;
+    }
+
+    static std::vector<std::string> threadNames() {
+      State& s = state();
+      std::lock_guard lock{ s.mutex };
+      return s.threadNames;
+    }
+
+    // Snapshot of every thread's buffer. Safe while threads keep
+    // recording, events overwritten during the copy are left out.
+    static std::vector<ProfileEvent> collect() {
+      State& s = state();
+      std::lock_guard lock{ s.mutex };
+      std::vector<ProfileEvent> events;
+      for (const auto& buffer : s.buffers)
+        buffer->collect(events);
+      return events;
+    }
+
+    // Drops everything recorded so far.
+    static void clear() {
+      State& s = state();
+      std::lock_guard lock{ s.mutex };
+      for (const auto& buffer : s.buffers)
+        buffer->clear();
+    }
+
+    // Nanoseconds per tick of now(), measured against steady_clock since
+    // the profiler started.
+    static double tickPeriod() {
+      State& s = state();
+      auto elapsed = std::chrono::steady_clock::now() - s.startTime;
+      // Too short to measure well, wait a bit.
+      while (elapsed < std::chrono::milliseconds(1))
+        elapsed = std::chrono::steady_clock::now() - s.startTime;
+
+      const uint64_t ticks = now() - s.startTicks;
+      return double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / double(ticks);
+    }
+
+    // Chrome's trace event JSON, opens in Perfetto and chrome://tracing.
+    static void writeChromeTrace(std::ostream& out) {
+      State& s = state();
+      const std::vector<ProfileEvent> events   = collect();
+      const std::vector<std::string>  threads  = threadNames();
+      const double                    toMicros = tickPeriod() / 1000.0;
+
+      std::vector<std::pair<uint32_t, const char*>> names;
+      {
+        std::lock_guard lock{ s.mutex };
+        names = s.names;
+      }
+      std::sort(names.begin(), names.end());
+
+      const auto micros = [&](uint64_t ticks) { return double(ticks - std::min(ticks, s.startTicks)) * toMicros; };
+      const auto writeName = [&](uint32_t hash) {
+        const auto it = std::lower_bound(names.begin(), names.end(), std::pair<uint32_t, const char*>{ hash, nullptr });
+        if (it != names.end() && it->first == hash)
+          writeJsonString(out, it->second);
+        else
+          out << "\"0x" << std::hex << hash << std::dec << '"';
+      };
+
+      const std::ios::fmtflags flags = out.flags();
+      const std::streamsize precision = out.precision();
+      out << std::fixed;
+      out.precision(3);
+
+      out << "{\"traceEvents\":[\n";
+      bool first = true;
+      const auto next = [&]() -> std::ostream& {
+        if (!first)
+          out << ",\n";
+        first = false;
+        return out;
+      };
+
+      for (uint32_t t = 0; t < threads.size(); t++) {
+        next() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":";
+        writeJsonString(out, threads[t].c_str());
+        out << "}}";
+      }
+
+      for (const ProfileEvent& event : events) {
+        next() << "{\"name\":";
+        switch (event.type) {
+          case ProfileEventType::Zone:
+            writeName(event.name);
+            out << ",\"ph\":\"X\",\"ts\":" << micros(event.begin) << ",\"dur\":" << double(event.data - event.begin) * toMicros;
+            break;
+          case ProfileEventType::Counter:
+            writeName(event.name);
+            out << ",\"ph\":\"C\",\"ts\":" << micros(event.begin) << ",\"args\":{\"value\":" << event.value() << '}';
+            break;
+          case ProfileEventType::Frame:
+            out << "\"Frame " << event.data << "\",\"ph\":\"i\",\"s\":\"g\",\"ts\":" << micros(event.begin);
+            break;
+        }
+        out << ",\"pid\":1,\"tid\":" << event.thread << '}';
+      }
+
+      out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+      out.flags(flags);
+      out.precision(precision);
+    }
+
+    static bool writeChromeTrace(const char* path) {
+      std::ofstream file{ path };
+      if (!file)
+        return false;
+      writeChromeTrace(file);
+      return bool(file);
+    }
+
+  private:
+    struct State {
+      std::mutex                                    mutex;
+      std::vector<std::unique_ptr<ProfileBuffer>>   buffers;
+      std::vector<std::string>                      threadNames;
+      std::vector<std::pair<uint32_t, const char*>> names;
+      std::atomic<uint64_t>                         frame{ 0 };
+      uint64_t                                      startTicks = now();
+      std::chrono::steady_clock::time_point         startTime  = std::chrono::steady_clock::now();
+    };
+
+    static State& state() {
+      static State s_state;
+      return s_state;
+    }
+
+    static ProfileBuffer& buffer() {
+      if (!t_buffer) [[unlikely]]
+        t_buffer = &registerThread();
+      return *t_buffer;
+    }
+
+    static ProfileBuffer& registerThread() {
+      State& s = state();
+      std::lock_guard lock{ s.mutex };
+      const uint32_t thread = uint32_t(s.buffers.size());
+      s.threadNames.push_back("Thread " + std::to_string(thread));
+      return *s.buffers.emplace_back(std::make_unique<ProfileBuffer>(thread));
+    }
+
+    static void writeJsonString(std::ostream& out, const char* s) {
+      out << '"';
+      for (; *s; s++) {
+        const unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\')
+          out << '\\' << char(c);
+        else if (c < 0x20)
+          out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+        else
+          out << char(c);
+      }
+      out << '"';
+    }
+
+    static inline thread_local ProfileBuffer* t_buffer = nullptr;
+  };
+
+  // A name for RN_ZONE/RN_COUNTER, registered once per call site.
+  struct ProfileName {
+    ProfileName(uint32_t hash, const char* name)
+      : hash{ hash } {
+      Profiler::registerName(hash, name);
+    }
+
+    uint32_t hash;
+  };
+
+  // Records [construction, destruction) as a zone.
+  class ProfileZone {
+  public:
+    explicit ProfileZone(uint32_t name)
+      : m_name { name }
+      , m_begin{ Profiler::now() } {}
+
+    ~ProfileZone() { Profiler::zone(m_name, m_begin, Profiler::now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+  private:
+    uint32_t m_name;
+    uint64_t m_begin;
+  };
+
+}
+
+// Build with RN_PROFILE defined to 1 (meson -Dprofile=true) to record.
+// Otherwise the macros expand to nothing, and their arguments are not
+// evaluated. Names must be string literals, they are hashed at compile time.
+#if defined(RN_PROFILE) && RN_PROFILE
+
+#define RN_PROFILE_HASH(name) (std::integral_constant<uint32_t, ::ranae::hash_string(name, sizeof(name) - 1)>::value)
+
+#define RN_ZONE_1(name, id) \
+  static const ::ranae::ProfileName _rn_zone_name_##id{ RN_PROFILE_HASH(name), name }; \
+  const ::ranae::ProfileZone _rn_zone_##id{ _rn_zone_name_##id.hash }
+#define RN_ZONE_2(name, id) RN_ZONE_1(name, id)
+#define RN_ZONE(name)       RN_ZONE_2(name, __COUNTER__)
+
+#define RN_COUNTER(name, value) do { \
+    static const ::ranae::ProfileName _rn_counter_name{ RN_PROFILE_HASH(name), name }; \
+    ::ranae::Profiler::counter(_rn_counter_name.hash, double(value)); \
+  } while (0)
+
+#define RN_FRAME() ::ranae::Profiler::frame()
+
+#else
+
+#define RN_ZONE(name)
+#define RN_COUNTER(name, value) ((void)0)
+#define RN_FRAME()              ((void)0)
+
+#endif
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <Ranae/Common.h>
+
+#include <type_traits>
+
+#if defined(__SSE4_1__)
+  #include <immintrin.h>
+  #define RN_SIMD_SSE4 1
+#else
+  #define RN_SIMD_SSE4 0
+#endif
+
+#if defined(__AVX2__)
+  #define RN_SIMD_AVX2 1
+#else
+  #define RN_SIMD_AVX2 0
+#endif
+
+#if defined(__FMA__)
+  #define RN_SIMD_FMA 1
+#else
+  #define RN_SIMD_FMA 0
+#endif
+
+namespace ranae::simd {
+
+  // Whether a Vector<T, Size> gets the hand-written 128-bit path.
+  // Everything else goes through the generic std::transform fallback.
+  template <typename T, size_t Size>
+  constexpr bool HasFloat4Path = RN_SIMD_SSE4 && std::is_same_v<T, float> && (Size == 3 || Size == 4);
+
+  // The std:: functional objects we know how to turn into a single instruction.
+  template <typename Op>
+  constexpr bool IsMappedOp =
+    std::is_same_v<Op, std::plus<>>       ||
+    std::is_same_v<Op, std::minus<>>      ||
+    std::is_same_v<Op, std::multiplies<>> ||
+    std::is_same_v<Op, std::divides<>>;
+
+#if RN_SIMD_SSE4
+
+  // 3-wide loads/stores must not touch the 4th float, it might not be ours.
+  template <size_t Size, bool Aligned = false>
+  inline __m128 load(const float* p) {
+    if constexpr (Size == 4 && Aligned) {
+      return _mm_load_ps(p);
+    } else if constexpr (Size == 4) {
+      return _mm_loadu_ps(p);
+    } else {
+      // _mm_load_sd/_mm_store_sd dereference a double*, which breaks strict
+      // aliasing on float storage. The epi64 variants go through may_alias types.
+      __m128 xy = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+      __m128 z  = _mm_load_ss(p + 2);
+      return _mm_movelh_ps(xy, z);
+    }
+  }
+
+  template <size_t Size, bool Aligned = false>
+  inline void store(float* p, __m128 v) {
+    if constexpr (Size == 4 && Aligned) {
+      _mm_store_ps(p, v);
+    } else if constexpr (Size == 4) {
+      _mm_storeu_ps(p, v);
+    } else {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(v));
+      _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+    }
+  }
+
+  inline __m128 fmadd(__m128 a, __m128 b, __m128 c) {
+#if RN_SIMD_FMA
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+  }
+
+  inline __m128 fnmadd(__m128 a, __m128 b, __m128 c) {
+#if RN_SIMD_FMA
+    return _mm_fnmadd_ps(a, b, c);
+#else
+    return _mm_sub_ps(c, _mm_mul_ps(a, b));
+#endif
+  }
+
+  template <typename Op>
+  inline __m128 binary(__m128 a, __m128 b) {
+    if constexpr (std::is_same_v<Op, std::plus<>>)
+      return _mm_add_ps(a, b);
+    else if constexpr (std::is_same_v<Op, std::minus<>>)
+      return _mm_sub_ps(a, b);
+    else if constexpr (std::is_same_v<Op, std::multiplies<>>)
+      return _mm_mul_ps(a, b);
+    else
+      return _mm_div_ps(a, b);
+  }
+
+  // Dot product broadcast to every lane.
+  template <size_t Size>
+  inline __m128 dot(__m128 a, __m128 b) {
+    return _mm_dp_ps(a, b, Size == 4 ? 0xFF : 0x7F);
+  }
+
+  // ~12-bit estimate + one Newton-Raphson step: r' = r * (2 - x * r)
+  inline __m128 rcpFast(__m128 x) {
+    const __m128 r = _mm_rcp_ps(x);
+    return _mm_mul_ps(r, fnmadd(x, r, _mm_set1_ps(2.0f)));
+  }
+
+  // ~12-bit estimate + one Newton-Raphson step: r' = 0.5 * r * (3 - x * r * r)
+  inline __m128 rsqrtFast(__m128 x) {
+    const __m128 r  = _mm_rsqrt_ps(x);
+    const __m128 xr = _mm_mul_ps(x, r);
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), r), fnmadd(xr, r, _mm_set1_ps(3.0f)));
+  }
+
+  // out = a * b for 4x4 matrices stored as four 4-wide basis vectors,
+  // ie. out[j] = sum(b[j][k] * a[k]). out may alias a or b.
+  inline void mul4x4(const float* a, const float* b, float* out) {
+#if RN_SIMD_AVX2 && RN_SIMD_FMA
+    const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 0));
+    const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+    const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+    const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+
+    // Two output vectors per iteration, one in each 128-bit half.
+    for (size_t j = 0; j < 16; j += 8) {
+      const __m256 bj = _mm256_loadu_ps(b + j);
+      __m256 r = _mm256_mul_ps(_mm256_shuffle_ps(bj, bj, 0x00), a0);
+      r = _mm256_fmadd_ps(_mm256_shuffle_ps(bj, bj, 0x55), a1, r);
+      r = _mm256_fmadd_ps(_mm256_shuffle_ps(bj, bj, 0xAA), a2, r);
+      r = _mm256_fmadd_ps(_mm256_shuffle_ps(bj, bj, 0xFF), a3, r);
+      _mm256_storeu_ps(out + j, r);
+    }
+#else
+    const __m128 a0 = _mm_loadu_ps(a + 0);
+    const __m128 a1 = _mm_loadu_ps(a + 4);
+    const __m128 a2 = _mm_loadu_ps(a + 8);
+    const __m128 a3 = _mm_loadu_ps(a + 12);
+
+    for (size_t j = 0; j < 16; j += 4) {
+      const __m128 bj = _mm_loadu_ps(b + j);
+      __m128 r = _mm_mul_ps(_mm_shuffle_ps(bj, bj, 0x00), a0);
+      r = fmadd(_mm_shuffle_ps(bj, bj, 0x55), a1, r);
+      r = fmadd(_mm_shuffle_ps(bj, bj, 0xAA), a2, r);
+      r = fmadd(_mm_shuffle_ps(bj, bj, 0xFF), a3, r);
+      _mm_storeu_ps(out + j, r);
+    }
+#endif
+  }
+
+  // Just enough arithmetic to evaluate a scalar formula on one element of
+  // Width independent problems at once (SoA), eg. Width matrices.
+  struct WideFloat {
+#if RN_SIMD_AVX2
+    using Native = __m256;
+    static constexpr size_t Width = 8;
+
+    static WideFloat load(const float* p)     { return { _mm256_load_ps(p) }; }
+    void store(float* p) const                { _mm256_store_ps(p, v); }
+    static WideFloat splat(float f)           { return { _mm256_set1_ps(f) }; }
+
+    friend WideFloat operator+(WideFloat a, WideFloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+    friend WideFloat operator-(WideFloat a, WideFloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    friend WideFloat operator*(WideFloat a, WideFloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+    friend WideFloat operator/(WideFloat a, WideFloat b) { return { _mm256_div_ps(a.v, b.v) }; }
+    friend WideFloat operator-(WideFloat a)              { return { _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)) }; }
+#else
+    using Native = __m128;
+    static constexpr size_t Width = 4;
+
+    static WideFloat load(const float* p)     { return { _mm_load_ps(p) }; }
+    void store(float* p) const                { _mm_store_ps(p, v); }
+    static WideFloat splat(float f)           { return { _mm_set1_ps(f) }; }
+
+    friend WideFloat operator+(WideFloat a, WideFloat b) { return { _mm_add_ps(a.v, b.v) }; }
+    friend WideFloat operator-(WideFloat a, WideFloat b) { return { _mm_sub_ps(a.v, b.v) }; }
+    friend WideFloat operator*(WideFloat a, WideFloat b) { return { _mm_mul_ps(a.v, b.v) }; }
+    friend WideFloat operator/(WideFloat a, WideFloat b) { return { _mm_div_ps(a.v, b.v) }; }
+    friend WideFloat operator-(WideFloat a)              { return { _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) }; }
+#endif
+
+    Native v;
+  };
+
+#endif
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Core/Allocator.h>
+#include <Ranae/Core/Hash.h>
+
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace ranae {
+
+  // Small dense id of an interned string. 0 is never handed out, so a
+  // zero initialized NameId means "no name".
+  using NameId = uint32_t;
+  constexpr NameId InvalidNameId = 0;
+
+  // Maps strings to NameIds, so names can be compared and hashed as
+  // integers. Each string is stored once, null terminated, and stays valid
+  // as long as the interner does.
+  //
+  // Safe to use from any thread. Looking up names that already exist only
+  // takes a shared lock, adding a new one takes it exclusively.
+  class StringInterner {
+  public:
+    StringInterner() = default;
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    // The id of s, adding it if it isn't interned yet.
+    NameId intern(std::string_view s) {
+      const uint64_t hash = hash64(s);
+      {
+        std::shared_lock lock{ m_mutex };
+        if (const NameId id = findLocked(s, hash))
+          return id;
+      }
+
+      std::unique_lock lock{ m_mutex };
+      // Someone else may have added it in between.
+      if (const NameId id = findLocked(s, hash))
+        return id;
+      return insertLocked(s, hash);
+    }
+
+    // InvalidNameId if s was never interned.
+    NameId find(std::string_view s) const {
+      const uint64_t hash = hash64(s);
+      std::shared_lock lock{ m_mutex };
+      return findLocked(s, hash);
+    }
+
+    // The view's data is null terminated.
+    std::string_view name(NameId id) const {
+      std::shared_lock lock{ m_mutex };
+      const Entry& entry = entryLocked(id);
+      return std::string_view{ entry.data, entry.size };
+    }
+
+    // hash64 of the name, without hashing it again.
+    uint64_t hash(NameId id) const {
+      std::shared_lock lock{ m_mutex };
+      return entryLocked(id).hash;
+    }
+
+    size_t size() const {
+      std::shared_lock lock{ m_mutex };
+      return m_entries.size();
+    }
+
+  private:
+    struct Entry {
+      const char* data;
+      uint32_t    size;
+      uint64_t    hash;
+    };
+
+    // Open addressing with linear probing. The upper half of the hash is
+    // kept next to the id, so a probe only looks at the entry (and the
+    // string) on a likely match.
+    struct Slot {
+      uint32_t tag = 0;
+      NameId   id  = InvalidNameId;
+    };
+
+    static uint32_t tag(uint64_t hash) { return uint32_t(hash >> 32); }
+
+    const Entry& entryLocked(NameId id) const {
+      rnAssert(id != InvalidNameId && id <= m_entries.size());
+      return m_entries[id - 1];
+    }
+
+    NameId findLocked(std::string_view s, uint64_t hash) const {
+      if (m_slots.empty())
+        return InvalidNameId;
+
+      const size_t mask = m_slots.size() - 1;
+      for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = m_slots[i];
+        if (slot.id == InvalidNameId)
+          return InvalidNameId;
+
+        if (slot.tag == tag(hash)) {
+          const Entry& entry = m_entries[slot.id - 1];
+          if (entry.hash == hash && std::string_view{ entry.data, entry.size } == s)
+            return slot.id;
+        }
+      }
+    }
+
+    NameId insertLocked(std::string_view s, uint64_t hash) {
+      rnAssert(s.size() <= std::numeric_limits<uint32_t>::max());
+
+      // At most half full.
+      if ((m_entries.size() + 1) * 2 > m_slots.size())
+        rehash(std::max<size_t>(m_slots.size() * 2, 64));
+
+      char* data = m_strings.allocate<char>(s.size() + 1);
+      std::memcpy(data, s.data(), s.size());
+      data[s.size()] = '\0';
+
+      m_entries.push_back(Entry{ data, uint32_t(s.size()), hash });
+      const NameId id = NameId(m_entries.size());
+      place(Slot{ tag(hash), id }, hash);
+      return id;
+    }
+
+    void place(Slot slot, uint64_t hash) {
+      const size_t mask = m_slots.size() - 1;
+      size_t i = hash & mask;
+      while (m_slots[i].id != InvalidNameId)
+        i = (i + 1) & mask;
+      m_slots[i] = slot;
+    }
+
+    void rehash(size_t slotCount) {
+      m_slots.assign(slotCount, Slot{});
+      for (size_t i = 0; i < m_entries.size(); i++)
+        place(Slot{ tag(m_entries[i].hash), NameId(i + 1) }, m_entries[i].hash);
+    }
+
+    mutable std::shared_mutex m_mutex;
+    std::vector<Slot>         m_slots;
+    std::vector<Entry>        m_entries;
+    LinearArena               m_strings;
+  };
+
+}
@@ -3,6 +3,8 @@
 #include <Ranae/Common.h>
 #include <Ranae/Math/Vector.h>
 
+#include <span>
+
 namespace ranae {
 
   template <typename T, size_t Rows, size_t Columns>
@@ -12,7 +14,8 @@ namespace ranae {
     constexpr Matrix(T scale = T{ 1 }) {
       for (size_t i = 0; i < Rows; i++) {
         RowVector vector{};
-        vector[i] = scale;
+        if (i < Columns)
+          vector[i] = scale;
         data[i] = vector;
       }
     }
@@ -125,12 +128,19 @@ namespace ranae {
     }
 
     // Real matrix operations
-
-    constexpr RowVector operator*(const RowVector& v) const {
-      auto mul = transform_result(v.begin(), std::multiplies());
-      return std::accumulate(mul.begin(), mul.end(), RowVector{});
+    //
+    // Each of data[i] is treated as a basis vector (a column, GLM style),
+    // so m * v = sum(v[i] * m[i]).
+
+    constexpr RowVector operator*(const Vector<T, Rows>& v) const {
+      RowVector result = data[0] * v[0];
+      for (size_t i = 1; i < Rows; i++)
+        result += data[i] * v[i];
+      return result;
     }
 
+    constexpr Matrix<T, Rows, Columns>& operator*=(const Matrix<T, Rows, Rows>& other);
+
     std::array<RowVector, Rows> data;
   };
 
@@ -153,6 +163,112 @@ namespace ranae {
   }
 
 
+  using Matrix4   = Matrix<float, 4, 4>;
+  using Matrix4x3 = Matrix<float, 4, 3>;
+
+
+  namespace impl {
+
+    // Number of output vectors computed together so each a[k] load is
+    // reused from registers, and how far along the shared dimension we go
+    // before moving on so those a[k] stay in cache.
+    constexpr size_t MatrixRegisterBlock = 4;
+    constexpr size_t MatrixTileDepth     = 64;
+
+    template <typename T, size_t N, size_t M, size_t K>
+    constexpr void multiplyBlocked(const Matrix<T, N, M>& a, const Matrix<T, K, N>& b, Matrix<T, K, M>& out) {
+      for (size_t k0 = 0; k0 < N; k0 += MatrixTileDepth) {
+        const size_t k1 = std::min(N, k0 + MatrixTileDepth);
+
+        size_t j = 0;
+        for (; j + MatrixRegisterBlock <= K; j += MatrixRegisterBlock) {
+          std::array<Vector<T, M>, MatrixRegisterBlock> acc;
+          for (size_t jj = 0; jj < MatrixRegisterBlock; jj++)
+            acc[jj] = out[j + jj];
+
+          for (size_t k = k0; k < k1; k++) {
+            const Vector<T, M>& ak = a[k];
+            for (size_t jj = 0; jj < MatrixRegisterBlock; jj++)
+              acc[jj] += ak * b[j + jj][k];
+          }
+
+          for (size_t jj = 0; jj < MatrixRegisterBlock; jj++)
+            out[j + jj] = acc[jj];
+        }
+
+        for (; j < K; j++) {
+          for (size_t k = k0; k < k1; k++)
+            out[j] += a[k] * b[j][k];
+        }
+      }
+    }
+
+  }
+
+  // a: N vectors of M, b: K vectors of N, result: K vectors of M.
+  template <typename T, size_t N, size_t M, size_t K>
+  constexpr Matrix<T, K, M> operator*(const Matrix<T, N, M>& a, const Matrix<T, K, N>& b) {
+    Matrix<T, K, M> result{ T{ 0 } };
+
+#if RN_SIMD_SSE4
+    if constexpr (std::is_same_v<T, float> && N == 4 && M == 4 && K == 4) {
+      if (!std::is_constant_evaluated()) {
+        simd::mul4x4(a[0].data.data(), b[0].data.data(), result[0].data.data());
+        return result;
+      }
+    }
+#endif
+
+    if constexpr (N * M * K >= 8 * 8 * 8) {
+      impl::multiplyBlocked(a, b, result);
+    } else {
+      for (size_t j = 0; j < K; j++)
+        result[j] = a * b[j];
+    }
+    return result;
+  }
+
+  template <typename T, size_t Rows, size_t Columns>
+  constexpr Matrix<T, Rows, Columns>& Matrix<T, Rows, Columns>::operator*=(const Matrix<T, Rows, Rows>& other) {
+    *this = *this * other;
+    return *this;
+  }
+
+  // out[i] = a[i] * b[i]
+  template <typename T, size_t N>
+  void multiply(std::span<const Matrix<T, N, N>> a, std::span<const Matrix<T, N, N>> b, std::span<Matrix<T, N, N>> out) {
+    rnAssert(a.size() == b.size() && a.size() <= out.size());
+
+#if RN_SIMD_SSE4
+    if constexpr (std::is_same_v<T, float> && N == 4) {
+      for (size_t i = 0; i < a.size(); i++)
+        simd::mul4x4(a[i][0].data.data(), b[i][0].data.data(), out[i][0].data.data());
+      return;
+    }
+#endif
+
+    for (size_t i = 0; i < a.size(); i++)
+      out[i] = a[i] * b[i];
+  }
+
+  // out[i] = a * b[i], eg. one view-projection against every model matrix.
+  template <typename T, size_t N>
+  void multiply(const Matrix<T, N, N>& a, std::span<const Matrix<T, N, N>> b, std::span<Matrix<T, N, N>> out) {
+    rnAssert(b.size() <= out.size());
+
+#if RN_SIMD_SSE4
+    if constexpr (std::is_same_v<T, float> && N == 4) {
+      for (size_t i = 0; i < b.size(); i++)
+        simd::mul4x4(a[0].data.data(), b[i][0].data.data(), out[i][0].data.data());
+      return;
+    }
+#endif
+
+    for (size_t i = 0; i < b.size(); i++)
+      out[i] = a * b[i];
+  }
+
+
   template <typename T, size_t Rows, size_t Columns>
   constexpr Matrix<T, Rows - 1, Columns - 1> minor(const Matrix<T, Rows, Columns>& a, size_t column, size_t row) {
     Matrix<T, Rows - 1, Columns - 1> mtx;
@@ -168,22 +284,281 @@ namespace ranae {
     return mtx;
   }
 
+  namespace impl {
+
+    // Closed form 4x4 adjugate via the 2x2 sub-determinants of the top and
+    // bottom halves. Returns the determinant, b is the adjugate (b / det is
+    // the inverse). Templated on E so it can also be run on simd::WideFloat
+    // to invert several matrices at once.
+    template <typename E>
+    constexpr E adjugate4x4(const E (&a)[4][4], E (&b)[4][4]) {
+      const E s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+      const E s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+      const E s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+      const E s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+      const E s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+      const E s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+      const E c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+      const E c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+      const E c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+      const E c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+      const E c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+      const E c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+      b[0][0] =  a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3;
+      b[0][1] = -a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3;
+      b[0][2] =  a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3;
+      b[0][3] = -a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3;
+
+      b[1][0] = -a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1;
+      b[1][1] =  a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1;
+      b[1][2] = -a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1;
+      b[1][3] =  a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1;
+
+      b[2][0] =  a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0;
+      b[2][1] = -a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0;
+      b[2][2] =  a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0;
+      b[2][3] = -a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0;
+
+      b[3][0] = -a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0;
+      b[3][1] =  a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0;
+      b[3][2] = -a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0;
+      b[3][3] =  a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0;
+
+      return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    }
+
+    template <typename T>
+    constexpr T determinant3x3(const Matrix<T, 3, 3>& a) {
+      return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+           - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+           + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    }
+
+    // In-place LU decomposition with partial pivoting (Doolittle, unit
+    // lower diagonal not stored). Returns the permutation sign, or 0 if
+    // the matrix is singular.
+    template <typename T, size_t N>
+    constexpr T luDecompose(Matrix<T, N, N>& a, std::array<size_t, N>& perm) {
+      T sign = T{ 1 };
+      for (size_t i = 0; i < N; i++)
+        perm[i] = i;
+
+      for (size_t k = 0; k < N; k++) {
+        size_t pivot = k;
+        for (size_t i = k + 1; i < N; i++) {
+          if (std::abs(a[i][k]) > std::abs(a[pivot][k]))
+            pivot = i;
+        }
+
+        if (a[pivot][k] == T{ 0 })
+          return T{ 0 };
+
+        if (pivot != k) {
+          std::swap(a[pivot], a[k]);
+          std::swap(perm[pivot], perm[k]);
+          sign = -sign;
+        }
+
+        const T invPivot = T{ 1 } / a[k][k];
+        for (size_t i = k + 1; i < N; i++) {
+          const T factor = a[i][k] * invPivot;
+          a[i][k] = factor;
+          for (size_t j = k + 1; j < N; j++)
+            a[i][j] -= factor * a[k][j];
+        }
+      }
+
+      return sign;
+    }
+
+    // Fraction-free Gaussian elimination, exact for integer types.
+    // Intermediates are products of two minors so they are done in 64-bit.
+    template <typename T, size_t N>
+    constexpr T bareissDeterminant(const Matrix<T, N, N>& m) {
+      std::array<std::array<int64_t, N>, N> a;
+      for (size_t y = 0; y < N; y++) {
+        for (size_t x = 0; x < N; x++)
+          a[y][x] = int64_t(m[y][x]);
+      }
+
+      int64_t sign = 1;
+      int64_t prev = 1;
+      for (size_t k = 0; k + 1 < N; k++) {
+        if (a[k][k] == 0) {
+          size_t swapRow = k + 1;
+          while (swapRow < N && a[swapRow][k] == 0)
+            swapRow++;
+          if (swapRow == N)
+            return T{ 0 };
+          std::swap(a[swapRow], a[k]);
+          sign = -sign;
+        }
+
+        for (size_t i = k + 1; i < N; i++) {
+          for (size_t j = k + 1; j < N; j++)
+            a[i][j] = (a[i][j] * a[k][k] - a[i][k] * a[k][j]) / prev;
+        }
+        prev = a[k][k];
+      }
+      return T(sign * a[N - 1][N - 1]);
+    }
+
+  }
+
   template <typename T, size_t Rows, size_t Columns>
   constexpr T determinant(const Matrix<T, Rows, Columns>& a) {
     static_assert(Rows == Columns);
 
     if constexpr (Rows == 1) {
       return a[0][0];
-    } else {
-      T result = T{};
-      for (size_t x = 0; x < Columns; x++) {
-        const T sign = (x % 2) ? T{ -1 } : T{ 1 };
-        result += sign * a[0][x] * determinant(minor(a, x, 0));
+    } else if constexpr (Rows == 2) {
+      return a[0][0] * a[1][1] - a[0][1] * a[1][0];
+    } else if constexpr (Rows == 3) {
+      return impl::determinant3x3(a);
+    } else if constexpr (Rows == 4) {
+      T m[4][4], adj[4][4];
+      for (size_t y = 0; y < 4; y++) {
+        for (size_t x = 0; x < 4; x++)
+          m[y][x] = a[y][x];
       }
+      return impl::adjugate4x4(m, adj);
+    } else if constexpr (std::is_floating_point_v<T>) {
+      Matrix<T, Rows, Columns> lu = a;
+      std::array<size_t, Rows> perm;
+      T result = impl::luDecompose(lu, perm);
+      for (size_t i = 0; i < Rows; i++)
+        result *= lu[i][i];
       return result;
+    } else {
+      return impl::bareissDeterminant(a);
     }
   }
 
+  // Inverse of a non-singular matrix. Singular input gives inf/NaN.
+  template <typename T, size_t Rows, size_t Columns>
+  constexpr Matrix<T, Rows, Columns> inverse(const Matrix<T, Rows, Columns>& a) {
+    static_assert(Rows == Columns);
+    static_assert(std::is_floating_point_v<T>);
+
+    Matrix<T, Rows, Columns> result;
+    if constexpr (Rows == 1) {
+      result[0][0] = T{ 1 } / a[0][0];
+    } else if constexpr (Rows == 2) {
+      const T invDet = T{ 1 } / determinant(a);
+      result[0][0] =  a[1][1] * invDet;
+      result[0][1] = -a[0][1] * invDet;
+      result[1][0] = -a[1][0] * invDet;
+      result[1][1] =  a[0][0] * invDet;
+    } else if constexpr (Rows == 3) {
+      const T invDet = T{ 1 } / impl::determinant3x3(a);
+      result[0][0] = (a[1][1] * a[2][2] - a[1][2] * a[2][1]) * invDet;
+      result[0][1] = (a[0][2] * a[2][1] - a[0][1] * a[2][2]) * invDet;
+      result[0][2] = (a[0][1] * a[1][2] - a[0][2] * a[1][1]) * invDet;
+      result[1][0] = (a[1][2] * a[2][0] - a[1][0] * a[2][2]) * invDet;
+      result[1][1] = (a[0][0] * a[2][2] - a[0][2] * a[2][0]) * invDet;
+      result[1][2] = (a[0][2] * a[1][0] - a[0][0] * a[1][2]) * invDet;
+      result[2][0] = (a[1][0] * a[2][1] - a[1][1] * a[2][0]) * invDet;
+      result[2][1] = (a[0][1] * a[2][0] - a[0][0] * a[2][1]) * invDet;
+      result[2][2] = (a[0][0] * a[1][1] - a[0][1] * a[1][0]) * invDet;
+    } else if constexpr (Rows == 4) {
+      T m[4][4], adj[4][4];
+      for (size_t y = 0; y < 4; y++) {
+        for (size_t x = 0; x < 4; x++)
+          m[y][x] = a[y][x];
+      }
+      const T invDet = T{ 1 } / impl::adjugate4x4(m, adj);
+      for (size_t y = 0; y < 4; y++) {
+        for (size_t x = 0; x < 4; x++)
+          result[y][x] = adj[y][x] * invDet;
+      }
+    } else {
+      Matrix<T, Rows, Columns> lu = a;
+      std::array<size_t, Rows> perm;
+      rnAssert(impl::luDecompose(lu, perm) != T{ 0 });
+
+      // Solve LU x = P e_j for every column j.
+      for (size_t j = 0; j < Rows; j++) {
+        Vector<T, Rows> x;
+        for (size_t i = 0; i < Rows; i++) {
+          T sum = perm[i] == j ? T{ 1 } : T{ 0 };
+          for (size_t k = 0; k < i; k++)
+            sum -= lu[i][k] * x[k];
+          x[i] = sum;
+        }
+        for (size_t i = Rows; i-- > 0;) {
+          T sum = x[i];
+          for (size_t k = i + 1; k < Rows; k++)
+            sum -= lu[i][k] * x[k];
+          x[i] = sum / lu[i][i];
+        }
+        for (size_t i = 0; i < Rows; i++)
+          result[i][j] = x[i];
+      }
+    }
+    return result;
+  }
+
+  // Inverse of an affine 4x4 (a[0..2] linear part with w = 0, a[3] the
+  // translation with w = 1). Cheaper than the general inverse: one 3x3
+  // inverse and rotating the translation back.
+  template <typename T>
+  constexpr Matrix<T, 4, 4> inverseAffine(const Matrix<T, 4, 4>& a) {
+    Matrix<T, 3, 3> linear;
+    for (size_t y = 0; y < 3; y++) {
+      for (size_t x = 0; x < 3; x++)
+        linear[y][x] = a[y][x];
+    }
+    const Matrix<T, 3, 3> invLinear = inverse(linear);
+    const Vector<T, 3> invTranslation = -(invLinear * Vector<T, 3>{ a[3][0], a[3][1], a[3][2] });
+
+    Matrix<T, 4, 4> result;
+    for (size_t y = 0; y < 3; y++)
+      result[y] = Vector<T, 4>{ invLinear[y][0], invLinear[y][1], invLinear[y][2], T{ 0 } };
+    result[3] = Vector<T, 4>{ invTranslation[0], invTranslation[1], invTranslation[2], T{ 1 } };
+    return result;
+  }
+
+  // out[i] = inverse(in[i]). With SIMD, simd::WideFloat::Width matrices are
+  // transposed into SoA form and inverted together with the same closed form.
+  template <typename T>
+  void inverse(std::span<const Matrix<T, 4, 4>> in, std::span<Matrix<T, 4, 4>> out) {
+    rnAssert(in.size() <= out.size());
+
+    size_t i = 0;
+#if RN_SIMD_SSE4
+    if constexpr (std::is_same_v<T, float>) {
+      using simd::WideFloat;
+      constexpr size_t W = WideFloat::Width;
+
+      alignas(32) float soa[16][W];
+      for (; i + W <= in.size(); i += W) {
+        for (size_t l = 0; l < W; l++) {
+          for (size_t e = 0; e < 16; e++)
+            soa[e][l] = in[i + l][e / 4][e % 4];
+        }
+
+        WideFloat m[4][4], adj[4][4];
+        for (size_t e = 0; e < 16; e++)
+          m[e / 4][e % 4] = WideFloat::load(soa[e]);
+
+        const WideFloat invDet = WideFloat::splat(1.0f) / impl::adjugate4x4(m, adj);
+
+        for (size_t e = 0; e < 16; e++)
+          (adj[e / 4][e % 4] * invDet).store(soa[e]);
+        for (size_t l = 0; l < W; l++) {
+          for (size_t e = 0; e < 16; e++)
+            out[i + l][e / 4][e % 4] = soa[e][l];
+        }
+      }
+    }
+#endif
+
+    for (; i < in.size(); i++)
+      out[i] = inverse(in[i]);
+  }
+
   template <typename T, size_t Rows, size_t Columns>
   constexpr Matrix<T, Columns, Rows> transpose(const Matrix<T, Rows, Columns>& a) {
     Matrix<T, Columns, Rows> result;
@@ -3,6 +3,10 @@
 #include <Ranae/Common.h>
 #include <Ranae/Math/Vector.h>
 
+#include <cmath>
+#include <span>
+#include <type_traits>
+
 namespace ranae {
 
   template <typename T>
@@ -17,8 +21,14 @@ namespace ranae {
     constexpr Quaternion(const Vector<T, 3> v, T s)
       : Vector<T, 4>{ v[0], v[1], v[2], s } { }
 
+    constexpr explicit Quaternion(const Vector<T, 4>& v)
+      : Vector<T, 4>{ v } { }
+
     constexpr Quaternion(const Quaternion& other) = default;
 
+    using Vector<T, 4>::operator*;
+    using Vector<T, 4>::operator/;
+
 
     constexpr Quaternion<T> operator*(const Quaternion<T>& b) const {
       const Quaternion<T>& a = *this;
@@ -72,14 +82,206 @@ namespace ranae {
 
   template <typename T>
   constexpr Quaternion<T> inverse(const Quaternion<T>& q) {
-    return Quaternion<T> { conjugate(q) / length(q) };
+    return Quaternion<T> { conjugate(q) / lengthSqr(q) };
+  }
+
+
+  namespace impl {
+
+    // a * b + c, fused where the target has it.
+    template <typename T>
+    constexpr T madd(T a, T b, T c) {
+#if RN_SIMD_FMA
+      if constexpr (std::is_floating_point_v<T>) {
+        if (!std::is_constant_evaluated())
+          return std::fma(a, b, c);
+      }
+#endif
+      return a * b + c;
+    }
+
+    // t = 2 * cross(u, v), v' = v + w * t + cross(u, t), written so every
+    // output component is one chain of dependent multiply-adds.
+    template <typename T>
+    constexpr void rotateQuaternion(const T (&q)[4], const T (&v)[3], T (&out)[3]) {
+      T t[3] = {
+        q[1] * v[2] - q[2] * v[1],
+        q[2] * v[0] - q[0] * v[2],
+        q[0] * v[1] - q[1] * v[0],
+      };
+      for (T& c : t)
+        c = c + c;
+
+      out[0] = madd(q[3], t[0], madd(q[1], t[2], v[0] - q[2] * t[1]));
+      out[1] = madd(q[3], t[1], madd(q[2], t[0], v[1] - q[0] * t[2]));
+      out[2] = madd(q[3], t[2], madd(q[0], t[1], v[2] - q[1] * t[0]));
+    }
+
+    // Same as Quaternion::operator*.
+    template <typename T>
+    constexpr void multiplyQuaternion(const T (&a)[4], const T (&b)[4], T (&out)[4]) {
+      out[0] = madd(a[3], b[0], madd(a[0], b[3], a[1] * b[2] - a[2] * b[1]));
+      out[1] = madd(a[3], b[1], madd(a[1], b[3], a[2] * b[0] - a[0] * b[2]));
+      out[2] = madd(a[3], b[2], madd(a[2], b[3], a[0] * b[1] - a[1] * b[0]));
+      out[3] = madd(a[3], b[3], -(a[0] * b[0]) - a[1] * b[1] - a[2] * b[2]);
+    }
+
+    // Columns of the 3x3 matrix doing the same rotation as q. Cheaper when
+    // one quaternion is applied to many vectors: 9 multiply-adds each.
+    template <typename T>
+    constexpr void quaternionMatrix(const Quaternion<T>& q, T (&m)[3][3]) {
+      const T x2 = q[0] + q[0], y2 = q[1] + q[1], z2 = q[2] + q[2];
+      const T xx = q[0] * x2, yy = q[1] * y2, zz = q[2] * z2;
+      const T xy = q[0] * y2, xz = q[0] * z2, yz = q[1] * z2;
+      const T wx = q[3] * x2, wy = q[3] * y2, wz = q[3] * z2;
+
+      m[0][0] = T{ 1 } - yy - zz; m[0][1] = xy + wz;          m[0][2] = xz - wy;
+      m[1][0] = xy - wz;          m[1][1] = T{ 1 } - xx - zz; m[1][2] = yz + wx;
+      m[2][0] = xz + wy;          m[2][1] = yz - wx;          m[2][2] = T{ 1 } - xx - yy;
+    }
+
+    // Per-component forms of the interpolations below so the stream
+    // kernels can run them VectorStreamBlock elements at a time. Both take
+    // the shortest path, b is flipped when it is in the other hemisphere.
+    template <typename T>
+    inline void nlerpQuaternion(const T (&a)[4], const T (&b)[4], T t, T (&out)[4]) {
+      const T d  = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+      const T ta = T{ 1 } - t;
+      const T tb = d < T{ 0 } ? -t : t;
+
+      T r[4], lengthSqr = T{ 0 };
+      for (size_t c = 0; c < 4; c++) {
+        r[c] = madd(a[c], ta, b[c] * tb);
+        lengthSqr = madd(r[c], r[c], lengthSqr);
+      }
+      const T scale = T{ 1 } / std::sqrt(lengthSqr);
+      for (size_t c = 0; c < 4; c++)
+        out[c] = r[c] * scale;
+    }
+
+    // nlerp moves fastest in the middle of the arc, this pulls t towards
+    // the ends by a cubic in t whose strength is fitted against d = |a . b|.
+    // After the correction the result is within ~1.5e-3 rad of slerp's for
+    // any pair, against ~0.14 rad uncorrected (Kapoulkine, "Approximating
+    // slerp").
+    template <typename T>
+    inline void slerpFastQuaternion(const T (&a)[4], const T (&b)[4], T t, T (&out)[4]) {
+      const T d  = std::abs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+      const T ka = madd(d, madd(d, madd(d, T{ -1.43519 }, T{ 3.55645 }), T{ -3.2452 }), T{ 1.0904 });
+      const T kb = madd(d, madd(d, T{ 0.215638 }, T{ -1.06021 }), T{ 0.848013 });
+      const T th = t - T{ 0.5 };
+      const T k  = madd(ka * th, th, kb);
+      const T tc = madd(t * th * (t - T{ 1 }), k, t);
+      nlerpQuaternion(a, b, tc, out);
+    }
+
+    template <typename T>
+    constexpr void rotateMatrix(const T (&m)[3][3], const T (&v)[3], T (&out)[3]) {
+      for (size_t r = 0; r < 3; r++)
+        out[r] = madd(m[2][r], v[2], madd(m[1][r], v[1], m[0][r] * v[0]));
+    }
+
   }
 
 
   template <typename T>
   constexpr Vector<T, 3> operator*(const Quaternion<T>& q, const Vector<T, 3> v) {
-    const Vector<T, 3> t = 2.0f * cross(vector(q), v);
-    return Vector<T, 3>{ v + scalar(q) * t + cross(vector(q), t) };
+    const T qs[4] = { q[0], q[1], q[2], q[3] };
+    const T vs[3] = { v[0], v[1], v[2] };
+    T out[3];
+    impl::rotateQuaternion(qs, vs, out);
+    return Vector<T, 3>{ out[0], out[1], out[2] };
+  }
+
+
+  // Batched versions of the above, plain loops over the same formulas
+  // so they vectorize across elements. The VectorStream overloads are
+  // faster still, the AoS layout costs shuffles. out may be the same span
+  // as an input.
+
+  // out[i] = q * v[i], eg. a rigid body's local points to world space.
+  template <typename T>
+  void rotate(const Quaternion<T>& q, std::span<const Vector<T, 3>> v, std::span<Vector<T, 3>> out) {
+    rnAssert(v.size() <= out.size());
+    T m[3][3];
+    impl::quaternionMatrix(q, m);
+    for (size_t i = 0; i < v.size(); i++) {
+      const T vs[3] = { v[i][0], v[i][1], v[i][2] };
+      T r[3];
+      impl::rotateMatrix(m, vs, r);
+      out[i] = Vector<T, 3>{ r[0], r[1], r[2] };
+    }
+  }
+
+  // out[i] = q[i] * v[i]
+  template <typename T>
+  void rotate(std::span<const Quaternion<T>> q, std::span<const Vector<T, 3>> v, std::span<Vector<T, 3>> out) {
+    rnAssert(q.size() == v.size() && v.size() <= out.size());
+    for (size_t i = 0; i < v.size(); i++)
+      out[i] = q[i] * v[i];
+  }
+
+  // out[i] = a[i] * b[i]
+  template <typename T>
+  void multiply(std::span<const Quaternion<T>> a, std::span<const Quaternion<T>> b, std::span<Quaternion<T>> out) {
+    rnAssert(a.size() == b.size() && a.size() <= out.size());
+    for (size_t i = 0; i < a.size(); i++)
+      out[i] = a[i] * b[i];
+  }
+
+  // out[i] = normalize(q[i])
+  template <typename T>
+  void normalize(std::span<const Quaternion<T>> q, std::span<Quaternion<T>> out) {
+    static_assert(std::is_floating_point_v<T>);
+    rnAssert(q.size() <= out.size());
+    for (size_t i = 0; i < q.size(); i++) {
+      const Quaternion<T>& a = q[i];
+      const T scale = T{ 1 } / std::sqrt(impl::madd(a[3], a[3], impl::madd(a[2], a[2], impl::madd(a[1], a[1], a[0] * a[0]))));
+      out[i] = Quaternion<T>{ a[0] * scale, a[1] * scale, a[2] * scale, a[3] * scale };
+    }
+  }
+
+
+
+  // Shortest-path interpolation between unit quaternions, a at t = 0 and
+  // b at t = 1.
+
+  // Normalized lerp: cheap and exact at the ends, but the angular speed
+  // isn't constant, which is most visible between keys far apart.
+  template <typename T>
+  Quaternion<T> nlerp(const Quaternion<T>& a, const Quaternion<T>& b, T t) {
+    const T as[4] = { a[0], a[1], a[2], a[3] };
+    const T bs[4] = { b[0], b[1], b[2], b[3] };
+    T out[4];
+    impl::nlerpQuaternion(as, bs, t, out);
+    return Quaternion<T>{ out[0], out[1], out[2], out[3] };
+  }
+
+  // Constant angular speed along the arc.
+  template <typename T>
+  Quaternion<T> slerp(const Quaternion<T>& a, const Quaternion<T>& b, T t) {
+    T d = dot(a, b);
+    const Quaternion<T> target = d < T{ 0 } ? Quaternion<T>{ -b } : b;
+    d = std::abs(d);
+
+    // sin(theta) vanishes as a and b line up, nlerp is exact enough there.
+    if (d > T{ 0.9995 })
+      return nlerp(a, target, t);
+
+    const T theta = std::acos(d);
+    const T s     = T{ 1 } / std::sin(theta);
+    return Quaternion<T>{ a * (std::sin((T{ 1 } - t) * theta) * s) + target * (std::sin(t * theta) * s) };
+  }
+
+  // nlerp with t corrected towards slerp's, see impl::slerpFastQuaternion.
+  // Costs about what nlerp does.
+  template <typename T>
+  Quaternion<T> slerpFast(const Quaternion<T>& a, const Quaternion<T>& b, T t) {
+    const T as[4] = { a[0], a[1], a[2], a[3] };
+    const T bs[4] = { b[0], b[1], b[2], b[3] };
+    T out[4];
+    impl::slerpFastQuaternion(as, bs, t, out);
+    return Quaternion<T>{ out[0], out[1], out[2], out[3] };
   }
 
 }
\ No newline at end of file
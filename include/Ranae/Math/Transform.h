@@ -1,13 +1,15 @@
 #pragma once
 
 #include <Ranae/Math/Vector.h>
+#include <Ranae/Math/VectorStream.h>
+#include <Ranae/Math/Matrix.h>
 #include <Ranae/Math/Quaternion.h>
 
 namespace ranae {
 
   struct Transform {
     Vector<float, 3> position{ 0.0f };
-    Quaternion orientation{}; // my orientation is gay
+    Quaternion<float> orientation{ 0.0f, 0.0f, 0.0f, 1.0f }; // my orientation is gay
     Vector<float, 3> scale{ 1.0f };
   };
 
@@ -27,10 +29,10 @@ namespace ranae {
 
   // Local = World / Parent
   inline Transform operator/(const Transform& world, const Transform& parent) {
-    const Quaternion parentConjugate{ conjugate(parent.orientation) };
+    const Quaternion<float> parentConjugate{ conjugate(parent.orientation) };
 
     return Transform {
-      .position    = (parentConjugate * (world.position - parent.position)) / parent.scale;
+      .position    = (parentConjugate * (world.position - parent.position)) / parent.scale,
       .orientation = (parentConjugate * world.orientation),
       .scale       = (parentConjugate * (world.scale / parent.scale)),
     };
@@ -46,7 +48,7 @@ namespace ranae {
   }
 
   inline Transform inverse(const Transform& t) {
-    const Quaternion invOrientation{ conjugate(t.orientation) };
+    const Quaternion<float> invOrientation{ conjugate(t.orientation) };
 
     return Transform {
       .position    = (invOrientation * -t.position) / t.scale,
@@ -56,17 +58,167 @@ namespace ranae {
   }
 
   // Returns true if a Transform does bugger all.
-  bool identity(const Transform& t) {
+  inline bool identity(const Transform& t) {
     return t.position == Vector<float, 3>{0.0f} &&
-           t.orientation == Quaternion{} &&
+           t.orientation == Quaternion<float>{ 0.0f, 0.0f, 0.0f, 1.0f } &&
            t.scale == Vector<float, 3>{1.0f};
   }
 
-  // TODO:
-  /*Matrix4 transformMatrix4(const Transform& t) {
-    return Math::translate(t.position) *
-          quaternionToMatrix4(t.orientation) *
-          Math::scale(t.scale);
-  }*/
+  namespace impl {
+
+    // Translate * Rotate * Scale straight from the (unit) quaternion, as the
+    // 12 non-constant elements in column order (x axis, y axis, z axis, position).
+    // Templated on the element type so the batched path can run it per lane.
+    template <typename E>
+    constexpr void transformColumns(E px, E py, E pz, E qx, E qy, E qz, E qw, E sx, E sy, E sz, E (&out)[12]) {
+      const E xx = qx * qx, yy = qy * qy, zz = qz * qz;
+      const E xy = qx * qy, xz = qx * qz, yz = qy * qz;
+      const E wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+      out[0]  = (E{ 1 } - E{ 2 } * (yy + zz)) * sx;
+      out[1]  = (E{ 2 } * (xy + wz)) * sx;
+      out[2]  = (E{ 2 } * (xz - wy)) * sx;
+
+      out[3]  = (E{ 2 } * (xy - wz)) * sy;
+      out[4]  = (E{ 1 } - E{ 2 } * (xx + zz)) * sy;
+      out[5]  = (E{ 2 } * (yz + wx)) * sy;
+
+      out[6]  = (E{ 2 } * (xz + wy)) * sz;
+      out[7]  = (E{ 2 } * (yz - wx)) * sz;
+      out[8]  = (E{ 1 } - E{ 2 } * (xx + yy)) * sz;
+
+      out[9]  = px;
+      out[10] = py;
+      out[11] = pz;
+    }
+
+  }
+
+  inline Matrix4x3 transformMatrix4x3(const Transform& t) {
+    float c[12];
+    impl::transformColumns(
+      t.position[0], t.position[1], t.position[2],
+      t.orientation[0], t.orientation[1], t.orientation[2], t.orientation[3],
+      t.scale[0], t.scale[1], t.scale[2], c);
+
+    return Matrix4x3 {
+      Vector<float, 3>{ c[0], c[1],  c[2]  },
+      Vector<float, 3>{ c[3], c[4],  c[5]  },
+      Vector<float, 3>{ c[6], c[7],  c[8]  },
+      Vector<float, 3>{ c[9], c[10], c[11] },
+    };
+  }
+
+  inline Matrix4 transformMatrix4(const Transform& t) {
+    const Matrix4x3 m = transformMatrix4x3(t);
+    return Matrix4 {
+      Vector<float, 4>{ m[0][0], m[0][1], m[0][2], 0.0f },
+      Vector<float, 4>{ m[1][0], m[1][1], m[1][2], 0.0f },
+      Vector<float, 4>{ m[2][0], m[2][1], m[2][2], 0.0f },
+      Vector<float, 4>{ m[3][0], m[3][1], m[3][2], 1.0f },
+    };
+  }
+
+
+  // Structure-of-arrays Transforms, for the batched paths.
+  struct TransformStreamView {
+    VectorStreamView<float, 3> position;
+    VectorStreamView<float, 4> orientation;
+    VectorStreamView<float, 3> scale;
+
+    size_t size() const { return position.size(); }
+
+    Transform get(size_t idx) const {
+      const Vector<float, 4> q = orientation.get(idx);
+      return Transform {
+        .position    = position.get(idx),
+        .orientation = Quaternion<float>{ q },
+        .scale       = scale.get(idx),
+      };
+    }
+
+    void set(size_t idx, const Transform& t) const {
+      position.set(idx, t.position);
+      orientation.set(idx, t.orientation);
+      scale.set(idx, t.scale);
+    }
+  };
+
+  struct TransformStream {
+    TransformStream() = default;
+
+    explicit TransformStream(size_t count) {
+      resize(count);
+    }
+
+    size_t size() const { return positions.size(); }
+
+    void resize(size_t count) {
+      positions.resize(count);
+      orientations.resize(count);
+      scales.resize(count);
+    }
+
+    TransformStreamView view() const {
+      return TransformStreamView{ positions, orientations, scales };
+    }
+
+    VectorStream<float, 3> positions;
+    VectorStream<float, 4> orientations;
+    VectorStream<float, 3> scales;
+  };
+
+
+  namespace impl {
+
+    // Matrices are built VectorStreamBlock at a time in SoA form (vectorizes
+    // across elements), then written out front to back with no reads so it
+    // is friendly to write-combined mapped memory.
+    template <size_t Columns, size_t Rows>
+    inline void transformMatrices(const TransformStreamView& in, float* out) {
+      constexpr size_t Stride = Columns * Rows;
+
+      forEachStreamBlock(in.size(), [&](size_t first, auto blockWidth) {
+        constexpr size_t width = decltype(blockWidth)::value;
+
+        float cols[12][width];
+        for (size_t j = 0; j < width; j++) {
+          const size_t i = first + j;
+          float c[12];
+          transformColumns(
+            in.position.lane(0)[i], in.position.lane(1)[i], in.position.lane(2)[i],
+            in.orientation.lane(0)[i], in.orientation.lane(1)[i], in.orientation.lane(2)[i], in.orientation.lane(3)[i],
+            in.scale.lane(0)[i], in.scale.lane(1)[i], in.scale.lane(2)[i], c);
+          for (size_t e = 0; e < 12; e++)
+            cols[e][j] = c[e];
+        }
+
+        for (size_t j = 0; j < width; j++) {
+          float* dst = out + (first + j) * Stride;
+          for (size_t col = 0; col < 4; col++) {
+            for (size_t row = 0; row < 3; row++)
+              dst[col * Rows + row] = cols[col * 3 + row][j];
+            if constexpr (Rows == 4)
+              dst[col * Rows + 3] = col == 3 ? 1.0f : 0.0f;
+          }
+        }
+      });
+    }
+
+  }
+
+  // Batched transformMatrix4x3/transformMatrix4. out can point straight
+  // into a mapped buffer, it is only ever written to.
+  inline void transformMatrices(const TransformStreamView& in, std::span<Matrix4x3> out) {
+    rnAssert(in.size() <= out.size());
+    static_assert(sizeof(Matrix4x3) == 12 * sizeof(float));
+    impl::transformMatrices<4, 3>(in, out.empty() ? nullptr : out[0][0].data.data());
+  }
+
+  inline void transformMatrices(const TransformStreamView& in, std::span<Matrix4> out) {
+    rnAssert(in.size() <= out.size());
+    static_assert(sizeof(Matrix4) == 16 * sizeof(float));
+    impl::transformMatrices<4, 4>(in, out.empty() ? nullptr : out[0][0].data.data());
+  }
 
 }
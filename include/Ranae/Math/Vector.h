@@ -2,6 +2,7 @@
 
 #include <Ranae/Common.h>
 #include <Ranae/Math/Basic.h>
+#include <Ranae/Core/Simd.h>
 #include <iostream>
 
 namespace ranae {
@@ -62,6 +63,12 @@ namespace ranae {
 
     template <typename BinaryOperation>
     constexpr Vector<T, Size> transform_result(const Vector<T, Size>& other, BinaryOperation op) const {
+#if RN_SIMD_SSE4
+      if constexpr (simd::HasFloat4Path<T, Size> && simd::IsMappedOp<BinaryOperation>) {
+        if (!std::is_constant_evaluated())
+          return from_simd(simd::binary<BinaryOperation>(to_simd(), other.to_simd()));
+      }
+#endif
       return transform_result(other.begin(), op);
     }
 
@@ -79,9 +86,30 @@ namespace ranae {
 
     template <typename BinaryOperation>
     constexpr Vector<T, Size>& transform_in_place(const Vector<T, Size>& other, BinaryOperation op) {
+#if RN_SIMD_SSE4
+      if constexpr (simd::HasFloat4Path<T, Size> && simd::IsMappedOp<BinaryOperation>) {
+        if (!std::is_constant_evaluated()) {
+          simd::store<Size, IsSimdAligned>(data.data(), simd::binary<BinaryOperation>(to_simd(), other.to_simd()));
+          return *this;
+        }
+      }
+#endif
       return transform_in_place(other.begin(), op);
     }
 
+#if RN_SIMD_SSE4
+    // Only valid when simd::HasFloat4Path<T, Size>.
+    __m128 to_simd() const {
+      return simd::load<Size, IsSimdAligned>(data.data());
+    }
+
+    static Vector<T, Size> from_simd(__m128 v) {
+      Vector<T, Size> result;
+      simd::store<Size, IsSimdAligned>(result.data.data(), v);
+      return result;
+    }
+#endif
+
 
     constexpr Vector<T, Size> operator-() const {
       return transform_result(std::negate());
@@ -101,6 +129,8 @@ namespace ranae {
     }
 
     constexpr Vector<T, Size> operator*(const T& scalar) const {
+      if constexpr (simd::HasFloat4Path<T, Size>)
+        return transform_result(Vector<T, Size>{ scalar }, std::multiplies());
       return transform_result([scalar](T value) { return value * scalar; });
     }
 
@@ -109,6 +139,8 @@ namespace ranae {
     }
 
     constexpr Vector<T, Size> operator/(const T& scalar) const {
+      if constexpr (simd::HasFloat4Path<T, Size>)
+        return transform_result(Vector<T, Size>{ scalar }, std::divides());
       return transform_result([scalar](T value) { return value / scalar; });
     }
 
@@ -122,31 +154,35 @@ namespace ranae {
 
 
     constexpr Vector<T, Size>& operator+=(const Vector<T, Size>& other) {
-      return transform_in_place(std::plus());
+      return transform_in_place(other, std::plus());
     }
 
     constexpr Vector<T, Size>& operator-=(const Vector<T, Size>& other) {
-      return transform_in_place(std::minus());
+      return transform_in_place(other, std::minus());
     }
 
     constexpr Vector<T, Size>& operator*=(const Vector<T, Size>& other) {
-      return transform_in_place(std::multiplies());
+      return transform_in_place(other, std::multiplies());
     }
 
     constexpr Vector<T, Size>& operator*=(const T& scalar) {
+      if constexpr (simd::HasFloat4Path<T, Size>)
+        return transform_in_place(Vector<T, Size>{ scalar }, std::multiplies());
       return transform_in_place([scalar](T value) { return value * scalar; });
     }
 
     constexpr Vector<T, Size>& operator/=(const Vector<T, Size>& other) {
-      return transform_in_place(std::divides());
+      return transform_in_place(other, std::divides());
     }
 
     constexpr Vector<T, Size>& operator/=(const T& scalar) {
+      if constexpr (simd::HasFloat4Path<T, Size>)
+        return transform_in_place(Vector<T, Size>{ scalar }, std::divides());
       return transform_in_place([scalar](T value) { return value / scalar; });
     }
 
     constexpr Vector<T, Size>& operator%=(const Vector<T, Size>& other) {
-      return transform_in_place(std::modulus());
+      return transform_in_place(other, std::modulus());
     }
 
     constexpr Vector<T, Size>& operator%=(const T& scalar) {
@@ -162,6 +198,8 @@ namespace ranae {
     // to take advantage of aligned load/stores.
     static constexpr size_t Alignment = (Size % 4u == 0 && sizeof(T) == sizeof(int32_t)) ? std::max<size_t>(16u, alignof(T)) : alignof(T);
 
+    static constexpr bool IsSimdAligned = Alignment >= 16u;
+
     alignas(Alignment) std::array<T, Size> data;
 
   };
@@ -189,9 +227,30 @@ namespace ranae {
 
   template <typename T, size_t Size>
   constexpr T dot(const Vector<T, Size>& a, const Vector<T, Size>& b) {
+#if RN_SIMD_SSE4
+    if constexpr (simd::HasFloat4Path<T, Size>) {
+      if (!std::is_constant_evaluated())
+        return _mm_cvtss_f32(simd::dot<Size>(a.to_simd(), b.to_simd()));
+    }
+#endif
     return accumulate(a * b);
   }
 
+  template <typename T>
+  constexpr Vector<T, 3> cross(const Vector<T, 3>& a, const Vector<T, 3>& b) {
+    return Vector<T, 3> {
+      a[1] * b[2] - a[2] * b[1],
+      a[2] * b[0] - a[0] * b[2],
+      a[0] * b[1] - a[1] * b[0],
+    };
+  }
+
+  // a at t = 0, b at t = 1.
+  template <typename T, size_t Size>
+  constexpr Vector<T, Size> lerp(const Vector<T, Size>& a, const Vector<T, Size>& b, T t) {
+    return a + (b - a) * t;
+  }
+
   template <typename T, size_t Size>
   constexpr T lengthSqr(const Vector<T, Size>& a) {
     return dot(a, a);
@@ -199,19 +258,66 @@ namespace ranae {
 
   template <typename T, size_t Size, typename J = Vector<T, Size>::DefaultLengthType>
   constexpr J length(const Vector<T, Size>& a) {
+#if RN_SIMD_SSE4
+    if constexpr (simd::HasFloat4Path<T, Size> && std::is_same_v<J, float>) {
+      if (!std::is_constant_evaluated()) {
+        const __m128 v = a.to_simd();
+        return _mm_cvtss_f32(_mm_sqrt_ss(simd::dot<Size>(v, v)));
+      }
+    }
+#endif
     return std::sqrt(J{ lengthSqr(a) });
   }
 
   template <typename T, size_t Size, typename J = Vector<T, Size>::DefaultLengthType>
   constexpr Vector<J, Size> normalize(const Vector<T, Size>& a) {
+#if RN_SIMD_SSE4
+    // Same rounding as the scalar path: a * (1 / sqrt(a . a)).
+    if constexpr (simd::HasFloat4Path<T, Size> && std::is_same_v<J, float>) {
+      if (!std::is_constant_evaluated()) {
+        const __m128 v = a.to_simd();
+        const __m128 r = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(simd::dot<Size>(v, v)));
+        return Vector<J, Size>::from_simd(_mm_mul_ps(v, r));
+      }
+    }
+#endif
     return a * J{ rcp( length<T, Size>(a) ) };
   }
 
   template <typename T, size_t Size, typename J = Vector<T, Size>::DefaultLengthType>
   constexpr Vector<J, Size> rcp(const Vector<T, Size>& a) {
+#if RN_SIMD_SSE4
+    if constexpr (simd::HasFloat4Path<T, Size> && std::is_same_v<J, float>) {
+      if (!std::is_constant_evaluated())
+        return Vector<J, Size>::from_simd(_mm_div_ps(_mm_set1_ps(1.0f), a.to_simd()));
+    }
+#endif
     return util::transform_result<Vector<J, Size>>(a.begin(), a.end(), [](T value){ return rcp<T, J>(value); });
   }
 
+  // Approximate versions of the above for when ~22 bits of precision is enough.
+  // On the SIMD path these are a hardware estimate plus one Newton-Raphson step,
+  // everywhere else they are just the exact versions.
+  template <typename T, size_t Size, typename J = Vector<T, Size>::DefaultLengthType>
+  Vector<J, Size> rcpFast(const Vector<T, Size>& a) {
+#if RN_SIMD_SSE4
+    if constexpr (simd::HasFloat4Path<T, Size> && std::is_same_v<J, float>)
+      return Vector<J, Size>::from_simd(simd::rcpFast(a.to_simd()));
+#endif
+    return rcp<T, Size, J>(a);
+  }
+
+  template <typename T, size_t Size, typename J = Vector<T, Size>::DefaultLengthType>
+  Vector<J, Size> normalizeFast(const Vector<T, Size>& a) {
+#if RN_SIMD_SSE4
+    if constexpr (simd::HasFloat4Path<T, Size> && std::is_same_v<J, float>) {
+      const __m128 v = a.to_simd();
+      return Vector<J, Size>::from_simd(_mm_mul_ps(v, simd::rsqrtFast(simd::dot<Size>(v, v))));
+    }
+#endif
+    return normalize<T, Size, J>(a);
+  }
+
   template <typename T, size_t Size>
   constexpr bool empty(const Vector<T, Size>& a) {
     return a == Vector<T, Size>::Zero;
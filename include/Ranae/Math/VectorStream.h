@@ -0,0 +1,449 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Math/Vector.h>
+#include <Ranae/Math/Matrix.h>
+#include <Ranae/Math/Quaternion.h>
+
+#include <new>
+#include <span>
+#include <utility>
+
+namespace ranae {
+
+  // Elements are processed in fixed blocks of this many so the inner loops
+  // have a constant trip count and get turned into full-width 8 (AVX) or
+  // 16 (AVX-512) lane vectors. Owned streams pad their storage to it.
+  constexpr size_t VectorStreamBlock = 16;
+  constexpr size_t VectorStreamAlignment = 64;
+
+  // Non-owning structure-of-arrays view: one pointer per component lane.
+  // Can wrap any external SoA memory without copying.
+  template <typename T, size_t Size>
+  struct VectorStreamView {
+    static_assert(std::is_arithmetic_v<T>);
+
+    constexpr       T* lane(size_t component)       { return lanes[component]; }
+    constexpr const T* lane(size_t component) const { return lanes[component]; }
+
+    constexpr size_t size() const { return count; }
+
+    constexpr Vector<T, Size> get(size_t idx) const {
+      Vector<T, Size> v;
+      for (size_t c = 0; c < Size; c++)
+        v[c] = lanes[c][idx];
+      return v;
+    }
+
+    constexpr void set(size_t idx, const Vector<T, Size>& v) const {
+      for (size_t c = 0; c < Size; c++)
+        lanes[c][idx] = v[c];
+    }
+
+    // AoS <-> SoA. These are transposes so they have to copy.
+    void fromVectors(std::span<const Vector<T, Size>> src) const {
+      rnAssert(src.size() <= count);
+      for (size_t c = 0; c < Size; c++) {
+        T* dst = lanes[c];
+        for (size_t i = 0; i < src.size(); i++)
+          dst[i] = src[i][c];
+      }
+    }
+
+    void toVectors(std::span<Vector<T, Size>> dst) const {
+      rnAssert(dst.size() <= count);
+      for (size_t c = 0; c < Size; c++) {
+        const T* src = lanes[c];
+        for (size_t i = 0; i < dst.size(); i++)
+          dst[i][c] = src[i];
+      }
+    }
+
+    std::array<T*, Size> lanes = {};
+    size_t count = 0;
+  };
+
+
+  // Owning SoA container, each lane is contiguous, cache-line aligned
+  // and padded to a whole VectorStreamBlock.
+  template <typename T, size_t Size>
+  class VectorStream : public VectorStreamView<T, Size> {
+  public:
+    VectorStream() = default;
+
+    explicit VectorStream(size_t count) {
+      resize(count);
+    }
+
+    explicit VectorStream(std::span<const Vector<T, Size>> vectors) {
+      resize(vectors.size());
+      this->fromVectors(vectors);
+    }
+
+    VectorStream(const VectorStream& other) {
+      *this = other;
+    }
+
+    VectorStream(VectorStream&& other) noexcept {
+      *this = std::move(other);
+    }
+
+    VectorStream& operator=(const VectorStream& other) {
+      if (this != &other) {
+        reallocate(other.m_capacity);
+        this->count = other.count;
+        std::copy(other.m_storage.get(), other.m_storage.get() + Size * m_capacity, m_storage.get());
+      }
+      return *this;
+    }
+
+    VectorStream& operator=(VectorStream&& other) noexcept {
+      m_storage  = std::move(other.m_storage);
+      m_capacity = std::exchange(other.m_capacity, 0);
+      this->lanes = std::exchange(other.lanes, {});
+      this->count = std::exchange(other.count, 0);
+      return *this;
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    // Newly exposed elements (and all padding) are zeroed.
+    void resize(size_t count) {
+      const size_t capacity = align(count, VectorStreamBlock);
+
+      if (capacity > m_capacity) {
+        VectorStream old = std::move(*this);
+        reallocate(capacity);
+        for (size_t c = 0; c < Size; c++)
+          std::copy(old.lane(c), old.lane(c) + old.count, this->lane(c));
+      } else {
+        for (size_t c = 0; c < Size; c++)
+          std::fill(this->lane(c) + count, this->lane(c) + m_capacity, T{});
+      }
+
+      this->count = count;
+    }
+
+  private:
+    struct AlignedDelete {
+      void operator()(T* ptr) const {
+        ::operator delete[](ptr, std::align_val_t{ VectorStreamAlignment });
+      }
+    };
+
+    void reallocate(size_t capacity) {
+      const size_t elements = Size * capacity;
+      m_storage.reset(static_cast<T*>(::operator new[](elements * sizeof(T), std::align_val_t{ VectorStreamAlignment })));
+      std::fill(m_storage.get(), m_storage.get() + elements, T{});
+
+      m_capacity = capacity;
+      for (size_t c = 0; c < Size; c++)
+        this->lanes[c] = m_storage.get() + c * capacity;
+      this->count = 0;
+    }
+
+    std::unique_ptr<T[], AlignedDelete> m_storage;
+    size_t m_capacity = 0;
+  };
+
+
+  namespace impl {
+
+    // Calls func(first, Width) over [0, count) with Width a compile-time
+    // VectorStreamBlock, then mops up the tail one element at a time.
+    template <typename Func>
+    inline void forEachStreamBlock(size_t count, Func&& func) {
+      size_t i = 0;
+      for (; i + VectorStreamBlock <= count; i += VectorStreamBlock)
+        func(i, std::integral_constant<size_t, VectorStreamBlock>{});
+      for (; i < count; i++)
+        func(i, std::integral_constant<size_t, 1>{});
+    }
+
+    template <typename T, size_t Size, typename BinaryOperation>
+    inline void streamBinary(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, const VectorStreamView<T, Size>& out, BinaryOperation op) {
+      rnAssert(a.size() == b.size() && a.size() <= out.size());
+      for (size_t c = 0; c < Size; c++) {
+        const T* la = a.lane(c);
+        const T* lb = b.lane(c);
+        T* lo = out.lanes[c];
+        forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+          constexpr size_t width = decltype(blockWidth)::value;
+          for (size_t j = 0; j < width; j++)
+            lo[first + j] = op(la[first + j], lb[first + j]);
+        });
+      }
+    }
+
+  }
+
+  // All kernels allow out to be the same stream as one of the inputs.
+
+  template <typename T, size_t Size>
+  void add(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, const VectorStreamView<T, Size>& out) {
+    impl::streamBinary(a, b, out, std::plus());
+  }
+
+  template <typename T, size_t Size>
+  void sub(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, const VectorStreamView<T, Size>& out) {
+    impl::streamBinary(a, b, out, std::minus());
+  }
+
+  template <typename T, size_t Size>
+  void mul(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, const VectorStreamView<T, Size>& out) {
+    impl::streamBinary(a, b, out, std::multiplies());
+  }
+
+  template <typename T, size_t Size>
+  void min(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, const VectorStreamView<T, Size>& out) {
+    impl::streamBinary(a, b, out, [](T x, T y) { return y < x ? y : x; });
+  }
+
+  template <typename T, size_t Size>
+  void max(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, const VectorStreamView<T, Size>& out) {
+    impl::streamBinary(a, b, out, [](T x, T y) { return x < y ? y : x; });
+  }
+
+  template <typename T, size_t Size>
+  void scale(const VectorStreamView<T, Size>& a, T scalar, const VectorStreamView<T, Size>& out) {
+    rnAssert(a.size() <= out.size());
+    for (size_t c = 0; c < Size; c++) {
+      const T* la = a.lane(c);
+      T* lo = out.lanes[c];
+      impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+        constexpr size_t width = decltype(blockWidth)::value;
+        for (size_t j = 0; j < width; j++)
+          lo[first + j] = la[first + j] * scalar;
+      });
+    }
+  }
+
+  // out = a * b + c
+  template <typename T, size_t Size>
+  void fma(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, const VectorStreamView<T, Size>& c, const VectorStreamView<T, Size>& out) {
+    rnAssert(a.size() == b.size() && a.size() == c.size() && a.size() <= out.size());
+    for (size_t l = 0; l < Size; l++) {
+      const T* la = a.lane(l);
+      const T* lb = b.lane(l);
+      const T* lc = c.lane(l);
+      T* lo = out.lanes[l];
+      impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+        constexpr size_t width = decltype(blockWidth)::value;
+        for (size_t j = 0; j < width; j++)
+          lo[first + j] = la[first + j] * lb[first + j] + lc[first + j];
+      });
+    }
+  }
+
+  template <typename T, size_t Size>
+  void dot(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, std::span<T> out) {
+    rnAssert(a.size() == b.size() && a.size() <= out.size());
+    impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      T acc[width] = {};
+      for (size_t c = 0; c < Size; c++) {
+        const T* la = a.lane(c) + first;
+        const T* lb = b.lane(c) + first;
+        for (size_t j = 0; j < width; j++)
+          acc[j] += la[j] * lb[j];
+      }
+      std::copy(&acc[0], &acc[width], &out[first]);
+    });
+  }
+
+  template <typename T, size_t Size>
+  void length(const VectorStreamView<T, Size>& a, std::span<T> out) {
+    static_assert(std::is_floating_point_v<T>);
+    dot(a, a, out);
+    impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      for (size_t j = 0; j < width; j++)
+        out[first + j] = std::sqrt(out[first + j]);
+    });
+  }
+
+  template <typename T, size_t Size>
+  void normalize(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& out) {
+    static_assert(std::is_floating_point_v<T>);
+    rnAssert(a.size() <= out.size());
+    impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      T scale[width] = {};
+      for (size_t c = 0; c < Size; c++) {
+        const T* la = a.lane(c) + first;
+        for (size_t j = 0; j < width; j++)
+          scale[j] += la[j] * la[j];
+      }
+      for (size_t j = 0; j < width; j++)
+        scale[j] = T{ 1 } / std::sqrt(scale[j]);
+      for (size_t c = 0; c < Size; c++) {
+        const T* la = a.lane(c) + first;
+        T* lo = out.lanes[c] + first;
+        for (size_t j = 0; j < width; j++)
+          lo[j] = la[j] * scale[j];
+      }
+    });
+  }
+
+  // out = m * a, same convention as Matrix::operator*(RowVector).
+  // out must not alias a.
+  template <typename T, size_t Size>
+  void transform(const Matrix<T, Size, Size>& m, const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& out) {
+    rnAssert(a.size() <= out.size());
+    impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      T acc[Size][width] = {};
+      for (size_t r = 0; r < Size; r++) {
+        const T* la = a.lane(r) + first;
+        for (size_t c = 0; c < Size; c++) {
+          const T k = m[r][c];
+          for (size_t j = 0; j < width; j++)
+            acc[c][j] += la[j] * k;
+        }
+      }
+      for (size_t c = 0; c < Size; c++)
+        std::copy(&acc[c][0], &acc[c][width], out.lanes[c] + first);
+    });
+  }
+
+  // Same as above but treats each element as a point with an implicit
+  // trailing 1, ie. applies the translation of a homogeneous matrix.
+  template <typename T, size_t Size>
+  void transformPoint(const Matrix<T, Size + 1, Size + 1>& m, const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& out) {
+    rnAssert(a.size() <= out.size());
+    impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      T acc[Size][width];
+      for (size_t c = 0; c < Size; c++)
+        std::fill(&acc[c][0], &acc[c][width], m[Size][c]);
+      for (size_t r = 0; r < Size; r++) {
+        const T* la = a.lane(r) + first;
+        for (size_t c = 0; c < Size; c++) {
+          const T k = m[r][c];
+          for (size_t j = 0; j < width; j++)
+            acc[c][j] += la[j] * k;
+        }
+      }
+      for (size_t c = 0; c < Size; c++)
+        std::copy(&acc[c][0], &acc[c][width], out.lanes[c] + first);
+    });
+  }
+
+
+  // Quaternion kernels. A quaternion stream is a VectorStreamView<T, 4>
+  // with (x, y, z, w) lanes.
+
+  // out[i] = q * a[i]
+  template <typename T>
+  void rotate(const Quaternion<T>& q, const VectorStreamView<T, 3>& a, const VectorStreamView<T, 3>& out) {
+    rnAssert(a.size() <= out.size());
+    T m[3][3];
+    impl::quaternionMatrix(q, m);
+    impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      T acc[3][width];
+      for (size_t j = 0; j < width; j++) {
+        const T v[3] = { a.lane(0)[first + j], a.lane(1)[first + j], a.lane(2)[first + j] };
+        T r[3];
+        impl::rotateMatrix(m, v, r);
+        for (size_t c = 0; c < 3; c++)
+          acc[c][j] = r[c];
+      }
+      for (size_t c = 0; c < 3; c++)
+        std::copy(&acc[c][0], &acc[c][width], out.lanes[c] + first);
+    });
+  }
+
+  // out[i] = q[i] * a[i]
+  template <typename T>
+  void rotate(const VectorStreamView<T, 4>& q, const VectorStreamView<T, 3>& a, const VectorStreamView<T, 3>& out) {
+    rnAssert(q.size() == a.size() && a.size() <= out.size());
+    impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      T acc[3][width];
+      for (size_t j = 0; j < width; j++) {
+        const T qs[4] = { q.lane(0)[first + j], q.lane(1)[first + j], q.lane(2)[first + j], q.lane(3)[first + j] };
+        const T v[3] = { a.lane(0)[first + j], a.lane(1)[first + j], a.lane(2)[first + j] };
+        T r[3];
+        impl::rotateQuaternion(qs, v, r);
+        for (size_t c = 0; c < 3; c++)
+          acc[c][j] = r[c];
+      }
+      for (size_t c = 0; c < 3; c++)
+        std::copy(&acc[c][0], &acc[c][width], out.lanes[c] + first);
+    });
+  }
+
+  // out[i] = a[i] * b[i] as quaternions, mul() is component-wise.
+  template <typename T>
+  void compose(const VectorStreamView<T, 4>& a, const VectorStreamView<T, 4>& b, const VectorStreamView<T, 4>& out) {
+    rnAssert(a.size() == b.size() && a.size() <= out.size());
+    impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      T acc[4][width];
+      for (size_t j = 0; j < width; j++) {
+        const T as[4] = { a.lane(0)[first + j], a.lane(1)[first + j], a.lane(2)[first + j], a.lane(3)[first + j] };
+        const T bs[4] = { b.lane(0)[first + j], b.lane(1)[first + j], b.lane(2)[first + j], b.lane(3)[first + j] };
+        T r[4];
+        impl::multiplyQuaternion(as, bs, r);
+        for (size_t c = 0; c < 4; c++)
+          acc[c][j] = r[c];
+      }
+      for (size_t c = 0; c < 4; c++)
+        std::copy(&acc[c][0], &acc[c][width], out.lanes[c] + first);
+    });
+  }
+
+
+  // out[i] = lerp(a[i], b[i], t[i])
+  template <typename T, size_t Size>
+  void lerp(const VectorStreamView<T, Size>& a, const VectorStreamView<T, Size>& b, std::span<const T> t, const VectorStreamView<T, Size>& out) {
+    rnAssert(a.size() == b.size() && a.size() <= t.size() && a.size() <= out.size());
+    for (size_t c = 0; c < Size; c++) {
+      const T* la = a.lane(c);
+      const T* lb = b.lane(c);
+      T* lo = out.lanes[c];
+      impl::forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+        constexpr size_t width = decltype(blockWidth)::value;
+        for (size_t j = 0; j < width; j++)
+          lo[first + j] = la[first + j] + (lb[first + j] - la[first + j]) * t[first + j];
+      });
+    }
+  }
+
+  namespace impl {
+
+    template <typename T, typename Interpolation>
+    inline void streamInterpolate(const VectorStreamView<T, 4>& a, const VectorStreamView<T, 4>& b, std::span<const T> t, const VectorStreamView<T, 4>& out, Interpolation interpolate) {
+      rnAssert(a.size() == b.size() && a.size() <= t.size() && a.size() <= out.size());
+      forEachStreamBlock(a.size(), [&](size_t first, auto blockWidth) {
+        constexpr size_t width = decltype(blockWidth)::value;
+        T acc[4][width];
+        for (size_t j = 0; j < width; j++) {
+          const T as[4] = { a.lane(0)[first + j], a.lane(1)[first + j], a.lane(2)[first + j], a.lane(3)[first + j] };
+          const T bs[4] = { b.lane(0)[first + j], b.lane(1)[first + j], b.lane(2)[first + j], b.lane(3)[first + j] };
+          T r[4];
+          interpolate(as, bs, t[first + j], r);
+          for (size_t c = 0; c < 4; c++)
+            acc[c][j] = r[c];
+        }
+        for (size_t c = 0; c < 4; c++)
+          std::copy(&acc[c][0], &acc[c][width], out.lanes[c] + first);
+      });
+    }
+
+  }
+
+  // out[i] = nlerp(a[i], b[i], t[i]) on quaternion streams.
+  template <typename T>
+  void nlerp(const VectorStreamView<T, 4>& a, const VectorStreamView<T, 4>& b, std::span<const T> t, const VectorStreamView<T, 4>& out) {
+    impl::streamInterpolate(a, b, t, out, [](const T (&x)[4], const T (&y)[4], T s, T (&r)[4]) { impl::nlerpQuaternion(x, y, s, r); });
+  }
+
+  // out[i] = slerpFast(a[i], b[i], t[i]) on quaternion streams.
+  template <typename T>
+  void slerpFast(const VectorStreamView<T, 4>& a, const VectorStreamView<T, 4>& b, std::span<const T> t, const VectorStreamView<T, 4>& out) {
+    impl::streamInterpolate(a, b, t, out, [](const T (&x)[4], const T (&y)[4], T s, T (&r)[4]) { impl::slerpFastQuaternion(x, y, s, r); });
+  }
+
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Core/Profiler.h>
+#include <Ranae/Math/Transform.h>
+#include <Ranae/Math/VectorStream.h>
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+namespace ranae {
+
+  // Keyframes for one component of a Transform, linearly interpolated
+  // (orientations with slerpFast). times are in seconds and increasing.
+  template <typename T>
+  struct AnimationChannel {
+    std::vector<float> times;
+    std::vector<T>     values;
+
+    bool empty() const { return times.empty(); }
+  };
+
+  // Animates pose[target]. Components with an empty channel are left as
+  // they are in the pose, so it can be seeded with the rest pose.
+  struct AnimationTrack {
+    uint32_t target = 0;
+
+    AnimationChannel<Vector<float, 3>>  position;
+    AnimationChannel<Quaternion<float>> orientation;
+    AnimationChannel<Vector<float, 3>>  scale;
+  };
+
+  struct AnimationClip {
+    std::vector<AnimationTrack> tracks;
+
+    // Time of the last key of any channel.
+    float duration() const {
+      float end = 0.0f;
+      for (const AnimationTrack& track : tracks) {
+        for (const std::vector<float>* times : { &track.position.times, &track.orientation.times, &track.scale.times }) {
+          if (!times->empty())
+            end = std::max(end, times->back());
+        }
+      }
+      return end;
+    }
+  };
+
+
+  // Evaluates every track of a clip into a pose, one sampler per playing
+  // instance of the clip. The clip must outlive the sampler.
+  //
+  // Each channel keeps a cursor to the key it last sampled, so playing
+  // forwards only ever looks at the next key or two. Jumps (seeking,
+  // looping back) fall back to a binary search. The two keys around the
+  // time are gathered per track into SoA streams, then interpolated for all
+  // tracks at once by the VectorStream kernels.
+  class AnimationSampler {
+  public:
+    AnimationSampler() = default;
+
+    explicit AnimationSampler(const AnimationClip& clip) {
+      bind(clip);
+    }
+
+    void bind(const AnimationClip& clip) {
+      m_clip = &clip;
+      m_cursors.assign(clip.tracks.size(), Cursors{});
+
+      const size_t count = clip.tracks.size();
+      for (size_t k = 0; k < 2; k++) {
+        m_positions[k].resize(count);
+        m_orientations[k].resize(count);
+        m_scales[k].resize(count);
+      }
+      for (std::vector<float>& alphas : m_alphas)
+        alphas.resize(count);
+    }
+
+    // Forgets the cursors, the next sample() searches from scratch.
+    void reset() {
+      std::fill(m_cursors.begin(), m_cursors.end(), Cursors{});
+    }
+
+    // Times outside the keys clamp to the first/last one.
+    void sample(float time, const TransformStreamView& pose) {
+      RN_ZONE("AnimationSampler::sample");
+      rnAssert(m_clip);
+
+      const std::vector<AnimationTrack>& tracks = m_clip->tracks;
+      for (size_t i = 0; i < tracks.size(); i++) {
+        const AnimationTrack& track = tracks[i];
+        rnAssert(track.target < pose.size());
+
+        gather(track.position, m_cursors[i].position, time, pose.position, track.target, m_positions, m_alphas[0], i);
+        gather(track.orientation, m_cursors[i].orientation, time, pose.orientation, track.target, m_orientations, m_alphas[1], i);
+        gather(track.scale, m_cursors[i].scale, time, pose.scale, track.target, m_scales, m_alphas[2], i);
+      }
+
+      lerp(m_positions[0], m_positions[1], std::span<const float>{ m_alphas[0] }, m_positions[0]);
+      slerpFast(m_orientations[0], m_orientations[1], std::span<const float>{ m_alphas[1] }, m_orientations[0]);
+      lerp(m_scales[0], m_scales[1], std::span<const float>{ m_alphas[2] }, m_scales[0]);
+
+      for (size_t i = 0; i < tracks.size(); i++) {
+        const uint32_t target = tracks[i].target;
+        pose.position.set(target, m_positions[0].get(i));
+        pose.orientation.set(target, m_orientations[0].get(i));
+        pose.scale.set(target, m_scales[0].get(i));
+      }
+    }
+
+    const AnimationClip* clip() const { return m_clip; }
+
+  private:
+    struct Cursors {
+      uint32_t position    = 0;
+      uint32_t orientation = 0;
+      uint32_t scale       = 0;
+    };
+
+    // Index of the last key at or before time, or 0 before the first one.
+    static uint32_t seek(const std::vector<float>& times, uint32_t cursor, float time) {
+      const size_t count = times.size();
+      if (cursor < count && times[cursor] <= time) {
+        if (cursor + 1 >= count || time < times[cursor + 1])
+          return cursor;
+        if (cursor + 2 >= count || time < times[cursor + 2])
+          return cursor + 1;
+      }
+      const auto next = std::upper_bound(times.begin(), times.end(), time);
+      return next == times.begin() ? 0 : uint32_t(next - times.begin() - 1);
+    }
+
+    template <typename T, size_t Size>
+    void gather(const AnimationChannel<T>& channel, uint32_t& cursor, float time, const VectorStreamView<float, Size>& pose, uint32_t target, VectorStream<float, Size> (&keys)[2], std::vector<float>& alphas, size_t i) {
+      if (channel.empty()) {
+        const Vector<float, Size> current = pose.get(target);
+        keys[0].set(i, current);
+        keys[1].set(i, current);
+        alphas[i] = 0.0f;
+        return;
+      }
+
+      rnAssert(channel.times.size() == channel.values.size());
+      cursor = seek(channel.times, cursor, time);
+      const uint32_t next = std::min<uint32_t>(cursor + 1, uint32_t(channel.times.size() - 1));
+
+      keys[0].set(i, channel.values[cursor]);
+      keys[1].set(i, channel.values[next]);
+
+      const float span = channel.times[next] - channel.times[cursor];
+      alphas[i] = span > 0.0f ? std::clamp((time - channel.times[cursor]) / span, 0.0f, 1.0f) : 0.0f;
+    }
+
+    const AnimationClip*   m_clip = nullptr;
+    std::vector<Cursors>   m_cursors;
+
+    // [0] the key at or before the time, [1] the one after. [0] also holds
+    // the interpolated result.
+    VectorStream<float, 3> m_positions[2];
+    VectorStream<float, 4> m_orientations[2];
+    VectorStream<float, 3> m_scales[2];
+    std::vector<float>     m_alphas[3];
+  };
+
+
+  // out = weighted sum of poses, weights don't have to add up to 1.
+  // Orientations are summed on the hemisphere of the first pose's and
+  // normalized, ie. an nlerp between any number of poses. out may be one
+  // of the poses.
+  inline void blendPoses(std::span<const TransformStreamView> poses, std::span<const float> weights, const TransformStreamView& out) {
+    RN_ZONE("blendPoses");
+    rnAssert(!poses.empty() && poses.size() == weights.size());
+
+    float total = 0.0f;
+    for (const float weight : weights)
+      total += weight;
+    rnAssert(total > 0.0f);
+    const float normalizer = 1.0f / total;
+
+    const size_t count = poses[0].size();
+    for (const TransformStreamView& pose : poses)
+      rnAssert(pose.size() == count);
+    rnAssert(count <= out.size());
+
+    impl::forEachStreamBlock(count, [&](size_t first, auto blockWidth) {
+      constexpr size_t width = decltype(blockWidth)::value;
+      float position[3][width] = {};
+      float orientation[4][width] = {};
+      float scale[3][width] = {};
+
+      const TransformStreamView& reference = poses[0];
+      for (size_t p = 0; p < poses.size(); p++) {
+        const TransformStreamView& pose = poses[p];
+        const float weight = weights[p] * normalizer;
+
+        for (size_t c = 0; c < 3; c++) {
+          const float* lp = pose.position.lane(c) + first;
+          const float* ls = pose.scale.lane(c) + first;
+          for (size_t j = 0; j < width; j++) {
+            position[c][j] += lp[j] * weight;
+            scale[c][j]    += ls[j] * weight;
+          }
+        }
+
+        float signedWeight[width];
+        for (size_t j = 0; j < width; j++) {
+          float d = 0.0f;
+          for (size_t c = 0; c < 4; c++)
+            d += pose.orientation.lane(c)[first + j] * reference.orientation.lane(c)[first + j];
+          signedWeight[j] = d < 0.0f ? -weight : weight;
+        }
+        for (size_t c = 0; c < 4; c++) {
+          const float* lq = pose.orientation.lane(c) + first;
+          for (size_t j = 0; j < width; j++)
+            orientation[c][j] += lq[j] * signedWeight[j];
+        }
+      }
+
+      float inverseLength[width] = {};
+      for (size_t c = 0; c < 4; c++) {
+        for (size_t j = 0; j < width; j++)
+          inverseLength[j] += orientation[c][j] * orientation[c][j];
+      }
+      for (size_t j = 0; j < width; j++)
+        inverseLength[j] = 1.0f / std::sqrt(inverseLength[j]);
+
+      for (size_t c = 0; c < 3; c++) {
+        std::copy(&position[c][0], &position[c][width], out.position.lanes[c] + first);
+        std::copy(&scale[c][0], &scale[c][width], out.scale.lanes[c] + first);
+      }
+      for (size_t c = 0; c < 4; c++) {
+        for (size_t j = 0; j < width; j++)
+          out.orientation.lanes[c][first + j] = orientation[c][j] * inverseLength[j];
+      }
+    });
+  }
+
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Scene/Entity.h>
+
+#include <new>
+#include <unordered_map>
+
+namespace ranae {
+
+  // What the archetype storage needs to know to move a component around
+  // without knowing its type.
+  struct ComponentInfo {
+    size_t size      = 0;
+    size_t alignment = 0;
+    void (*moveConstruct)(void* dst, void* src) = nullptr;
+    void (*destroy)(void* ptr)                  = nullptr;
+
+    template <typename T>
+    static ComponentInfo of() {
+      return ComponentInfo {
+        .size          = sizeof(T),
+        .alignment     = alignof(T),
+        .moveConstruct = [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); },
+        .destroy       = [](void* ptr) { static_cast<T*>(ptr)->~T(); },
+      };
+    }
+  };
+
+  // All entities with exactly the same ComponentSignature, stored in fixed
+  // size chunks. Inside a chunk every component type (and the entity ids)
+  // is its own contiguous column.
+  struct Archetype {
+    static constexpr size_t   ChunkSize     = 16 * 1024;
+    static constexpr size_t   ChunkAlign    = 64;
+    static constexpr uint32_t InvalidColumn = ~0u;
+    static constexpr uint32_t InvalidIndex  = ~0u;
+
+    struct ChunkDelete {
+      void operator()(std::byte* ptr) const {
+        ::operator delete[](ptr, std::align_val_t{ ChunkAlign });
+      }
+    };
+    using Chunk = std::unique_ptr<std::byte[], ChunkDelete>;
+
+    ComponentSignature signature = {};
+    uint32_t capacity = 0;  // rows per chunk
+    uint32_t count    = 0;  // rows in use across all chunks
+
+    uint32_t entityOffset = 0;
+    std::array<uint32_t, MaxComponents> columnOffsets;
+
+    // Archetype reached by adding/removing one component, filled in lazily.
+    std::array<uint32_t, MaxComponents> addEdges;
+    std::array<uint32_t, MaxComponents> removeEdges;
+
+    std::vector<Chunk> chunks;
+
+    size_t chunkRows(size_t chunk) const {
+      return std::min<size_t>(capacity, count - chunk * capacity);
+    }
+
+    EntityId* entities(size_t chunk) const {
+      return reinterpret_cast<EntityId*>(chunks[chunk].get() + entityOffset);
+    }
+
+    void* component(uint32_t componentIdx, uint32_t row) const {
+      const std::byte* base = chunks[row / capacity].get() + columnOffsets[componentIdx];
+      return const_cast<std::byte*>(base) + size_t(row % capacity) * componentSize[componentIdx];
+    }
+
+    template <typename T>
+    T* column(size_t chunk) const {
+      rnAssert(columnOffsets[T::ComponentIdx] != InvalidColumn);
+      return reinterpret_cast<T*>(chunks[chunk].get() + columnOffsets[T::ComponentIdx]);
+    }
+
+    std::array<uint32_t, MaxComponents> componentSize = {};
+  };
+
+
+  // Alternative to ComponentManager that groups entities by signature, so
+  // iterating several components together is a linear walk over the chunks
+  // of every matching archetype instead of a lookup per component per entity.
+  //
+  // Adding or removing a component moves the entity to another archetype.
+  class ArchetypeStorage {
+  public:
+    ArchetypeStorage() {
+      // Everything starts out in the empty archetype.
+      getOrCreateArchetype({});
+    }
+
+    ~ArchetypeStorage() {
+      for (Archetype& archetype : m_archetypes) {
+        for (uint32_t row = 0; row < archetype.count; row++)
+          destroyRow(archetype, row);
+      }
+    }
+
+    ArchetypeStorage(const ArchetypeStorage&) = delete;
+    ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+
+    template <typename T>
+    void registerComponent() {
+      static_assert(T::ComponentIdx < MaxComponents);
+      m_componentInfos[T::ComponentIdx] = ComponentInfo::of<T>();
+    }
+
+    template <typename... Ts>
+    void registerComponents(ComponentList<Ts...>) {
+      (registerComponent<Ts>(), ...);
+    }
+
+    void insertEntity(EntityId entityId) {
+      const uint32_t index = entityIndex(entityId);
+      if (index >= m_locations.size())
+        m_locations.resize(index + 1);
+      rnAssert(m_locations[index].archetype == Archetype::InvalidIndex);
+
+      Archetype& empty = m_archetypes[0];
+      const uint32_t row = allocateRow(empty, entityId);
+      m_locations[index] = EntityLocation{ entityId, 0, row };
+    }
+
+    void onEntityDestroyed(EntityId entityId) {
+      if (!contains(entityId))
+        return;
+
+      EntityLocation& location = m_locations[entityIndex(entityId)];
+      Archetype& archetype = m_archetypes[location.archetype];
+      destroyRow(archetype, location.row);
+      removeRow(archetype, location.row);
+      location = EntityLocation{};
+    }
+
+    bool contains(EntityId entityId) const {
+      const uint32_t index = entityIndex(entityId);
+      return index < m_locations.size() && m_locations[index].entity == entityId;
+    }
+
+    ComponentSignature getSignature(EntityId entityId) const {
+      rnAssert(contains(entityId));
+      return m_archetypes[m_locations[entityIndex(entityId)].archetype].signature;
+    }
+
+    template <typename T>
+    bool hasComponent(EntityId entityId) const {
+      return getSignature(entityId).get(T::ComponentIdx);
+    }
+
+    template <typename T>
+    void addComponent(EntityId entityId, T&& component) {
+      if (!contains(entityId))
+        insertEntity(entityId);
+
+      rnAssert(!hasComponent<T>(entityId));
+      const uint32_t row = moveEntity(entityId, T::ComponentIdx, true);
+      Archetype& archetype = m_archetypes[m_locations[entityIndex(entityId)].archetype];
+      new (archetype.component(T::ComponentIdx, row)) T(std::move(component));
+    }
+
+    template <typename T>
+    void removeComponent(EntityId entityId) {
+      rnAssert(hasComponent<T>(entityId));
+      moveEntity(entityId, T::ComponentIdx, false);
+    }
+
+    template <typename T>
+    T& getComponent(EntityId entityId) {
+      rnAssert(hasComponent<T>(entityId));
+      const EntityLocation& location = m_locations[entityIndex(entityId)];
+      return *static_cast<T*>(m_archetypes[location.archetype].component(T::ComponentIdx, location.row));
+    }
+
+    // Calls func(count, entities, Ts*...) for every chunk of every archetype
+    // that has all of Ts. The pointers are the chunk's columns.
+    template <typename... Ts, typename Func>
+    void forEachChunk(Func&& func) {
+      constexpr ComponentSignature required = componentSignature<Ts...>();
+
+      // Matched against the packed signatures rather than the archetypes
+      // themselves. Spare chunks past count are left out.
+      forEachMatchingSignature(m_signatures, required, {}, [&](uint32_t archetypeIdx) {
+        Archetype& archetype = m_archetypes[archetypeIdx];
+        for (size_t chunk = 0; chunk * archetype.capacity < archetype.count; chunk++)
+          func(archetype.chunkRows(chunk), archetype.entities(chunk), archetype.column<Ts>(chunk)...);
+      });
+    }
+
+    // Calls func(entity, Ts&...) for every entity that has all of Ts.
+    template <typename... Ts, typename Func>
+    void forEach(Func&& func) {
+      forEachChunk<Ts...>([&](size_t count, const EntityId* entities, Ts*... columns) {
+        for (size_t i = 0; i < count; i++)
+          func(entities[i], columns[i]...);
+      });
+    }
+
+    size_t archetypeCount() const { return m_archetypes.size(); }
+
+  private:
+    struct EntityLocation {
+      EntityId entity    = InvalidEntity;
+      uint32_t archetype = Archetype::InvalidIndex;
+      uint32_t row       = 0;
+    };
+
+    uint32_t getOrCreateArchetype(const ComponentSignature& signature) {
+      if (auto it = m_archetypeLookup.find(signature); it != m_archetypeLookup.end())
+        return it->second;
+
+      Archetype archetype;
+      archetype.signature = signature;
+      archetype.columnOffsets.fill(Archetype::InvalidColumn);
+      archetype.addEdges.fill(Archetype::InvalidIndex);
+      archetype.removeEdges.fill(Archetype::InvalidIndex);
+
+      // Work out how many rows fit with worst case alignment padding,
+      // then lay the columns out back to back.
+      size_t rowSize = sizeof(EntityId);
+      size_t padding = 0;
+      signature.forEachSet([&](uint32_t idx) {
+        const ComponentInfo& info = m_componentInfos[idx];
+        rnAssert(info.size != 0);
+        rowSize += info.size;
+        padding += info.alignment;
+      });
+      rnAssert(padding + rowSize <= Archetype::ChunkSize);
+      archetype.capacity = uint32_t((Archetype::ChunkSize - padding) / rowSize);
+
+      size_t offset = 0;
+      archetype.entityOffset = 0;
+      offset += sizeof(EntityId) * archetype.capacity;
+      signature.forEachSet([&](uint32_t idx) {
+        const ComponentInfo& info = m_componentInfos[idx];
+        offset = align(offset, info.alignment);
+        archetype.columnOffsets[idx] = uint32_t(offset);
+        archetype.componentSize[idx] = uint32_t(info.size);
+        offset += info.size * archetype.capacity;
+      });
+      rnAssert(offset <= Archetype::ChunkSize);
+
+      const uint32_t archetypeIdx = uint32_t(m_archetypes.size());
+      m_archetypes.push_back(std::move(archetype));
+      m_signatures.push_back(signature);
+      m_archetypeLookup[signature] = archetypeIdx;
+      return archetypeIdx;
+    }
+
+    uint32_t allocateRow(Archetype& archetype, EntityId entityId) {
+      const uint32_t row = archetype.count++;
+      if (row / archetype.capacity >= archetype.chunks.size()) {
+        archetype.chunks.emplace_back(static_cast<std::byte*>(
+          ::operator new[](Archetype::ChunkSize, std::align_val_t{ Archetype::ChunkAlign })));
+      }
+      archetype.entities(row / archetype.capacity)[row % archetype.capacity] = entityId;
+      return row;
+    }
+
+    void destroyRow(Archetype& archetype, uint32_t row) {
+      archetype.signature.forEachSet([&](uint32_t idx) {
+        m_componentInfos[idx].destroy(archetype.component(idx, row));
+      });
+    }
+
+    // Fills the (already destroyed) row with the archetype's last row.
+    void removeRow(Archetype& archetype, uint32_t row) {
+      const uint32_t last = --archetype.count;
+      if (row != last) {
+        archetype.signature.forEachSet([&](uint32_t idx) {
+          void* lastComponent = archetype.component(idx, last);
+          m_componentInfos[idx].moveConstruct(archetype.component(idx, row), lastComponent);
+          m_componentInfos[idx].destroy(lastComponent);
+        });
+
+        const EntityId moved = archetype.entities(last / archetype.capacity)[last % archetype.capacity];
+        archetype.entities(row / archetype.capacity)[row % archetype.capacity] = moved;
+        m_locations[entityIndex(moved)].row = row;
+      }
+
+      // Keep one spare chunk around so an entity bouncing across a chunk
+      // boundary does not allocate every time.
+      const size_t neededChunks = (archetype.count + archetype.capacity - 1) / archetype.capacity;
+      if (archetype.chunks.size() > neededChunks + 1)
+        archetype.chunks.pop_back();
+    }
+
+    // Moves an entity to the archetype with componentIdx added or removed.
+    // Shared components are moved across, a removed one is destroyed and an
+    // added one is left for the caller to construct. Returns the new row.
+    uint32_t moveEntity(EntityId entityId, uint32_t componentIdx, bool add) {
+      EntityLocation& location = m_locations[entityIndex(entityId)];
+      const uint32_t srcIdx = location.archetype;
+
+      uint32_t dstIdx = add
+        ? m_archetypes[srcIdx].addEdges[componentIdx]
+        : m_archetypes[srcIdx].removeEdges[componentIdx];
+      if (dstIdx == Archetype::InvalidIndex) {
+        const ComponentSignature srcSignature = m_archetypes[srcIdx].signature;
+        dstIdx = getOrCreateArchetype(srcSignature ^ ComponentSignature::single(componentIdx));
+        // m_archetypes may have grown, so index again.
+        if (add) {
+          m_archetypes[srcIdx].addEdges[componentIdx] = dstIdx;
+          m_archetypes[dstIdx].removeEdges[componentIdx] = srcIdx;
+        } else {
+          m_archetypes[srcIdx].removeEdges[componentIdx] = dstIdx;
+          m_archetypes[dstIdx].addEdges[componentIdx] = srcIdx;
+        }
+      }
+
+      Archetype& src = m_archetypes[srcIdx];
+      Archetype& dst = m_archetypes[dstIdx];
+
+      const uint32_t srcRow = location.row;
+      const uint32_t dstRow = allocateRow(dst, entityId);
+      src.signature.forEachSet([&](uint32_t idx) {
+        void* component = src.component(idx, srcRow);
+        if (idx != componentIdx)
+          m_componentInfos[idx].moveConstruct(dst.component(idx, dstRow), component);
+        m_componentInfos[idx].destroy(component);
+      });
+      removeRow(src, srcRow);
+
+      location.archetype = dstIdx;
+      location.row       = dstRow;
+      return dstRow;
+    }
+
+    std::array<ComponentInfo, MaxComponents> m_componentInfos;
+    std::vector<Archetype>                   m_archetypes;
+    std::vector<ComponentSignature>          m_signatures;  // m_archetypes[i].signature
+    std::vector<EntityLocation>              m_locations;
+
+    std::unordered_map<ComponentSignature, uint32_t, BitsetHash<MaxComponents>> m_archetypeLookup;
+  };
+
+}
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Core/Allocator.h>
+#include <Ranae/Core/JobSystem.h>
+#include <Ranae/Scene/World.h>
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ranae {
+
+  // Entity recorded for creation in a CommandBuffer. It can be used as the
+  // target of later commands in the same buffer, and becomes a real
+  // EntityId once the buffer has been played back.
+  struct PendingEntity {
+    uint32_t index;
+  };
+
+  class CommandBuffer;
+
+  namespace impl {
+    // What playback needs to apply a recorded component without knowing
+    // its type.
+    struct CommandComponentOps {
+      void (*add)(World& world, EntityId entityId, void* component);
+      void (*remove)(World& world, EntityId entityId);
+      void (*reserve)(World& world, size_t count);
+      void (*destroy)(void* component);
+    };
+
+    template <typename T>
+    inline constexpr CommandComponentOps CommandOps = {
+      // Adding a component the entity already has replaces it.
+      .add = [](World& world, EntityId entityId, void* component) {
+        world.setComponent(entityId, std::move(*static_cast<T*>(component)));
+      },
+      .remove = [](World& world, EntityId entityId) {
+        if (world.hasComponent<T>(entityId))
+          world.removeComponent<T>(entityId);
+      },
+      .reserve = [](World& world, size_t count) {
+        ComponentArray<T>& array = world.components().getComponentArray<T>();
+        if (array.size() + count > array.capacity())
+          array.reserve(std::max(array.size() + count, array.capacity() * 2));
+      },
+      .destroy = [](void* component) { static_cast<T*>(component)->~T(); },
+    };
+
+    enum class CommandType : uint8_t {
+      Remove,
+      Add,
+    };
+
+    struct Command {
+      EntityId                   target;
+      uint32_t                   componentIdx;
+      uint32_t                   order;
+      CommandType                type;
+      bool                       pending;
+      const CommandComponentOps* ops;
+      void*                      component;
+    };
+
+    // Sorting scratch for playing back a set of buffers, kept around so
+    // a warmed up flush doesn't allocate.
+    struct CommandPlayback {
+      void run(World& world, std::span<CommandBuffer> buffers);
+
+      struct Entry {
+        EntityId       entityId;
+        uint32_t       componentIdx;
+        uint32_t       buffer;
+        const Command* command;
+      };
+
+      std::vector<Entry>    entries;
+      std::vector<EntityId> destroys;
+    };
+  }
+
+  // Records structural changes to a World so they can be made from a
+  // thread that must not touch it, and applies them later in one go.
+  // Component values live in a LinearArena until playback, so recording
+  // doesn't allocate once the buffer has warmed up.
+  //
+  // A buffer is for one thread at a time, see CommandBuffers for a set of
+  // them to hand out to the threads of a JobSystem.
+  class CommandBuffer {
+  public:
+    CommandBuffer() = default;
+
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    CommandBuffer(CommandBuffer&& other)
+      : m_commands{ std::move(other.m_commands) }
+      , m_destroys{ std::move(other.m_destroys) }
+      , m_created{ std::move(other.m_created) }
+      , m_createCount{ std::exchange(other.m_createCount, 0) }
+      , m_arena{ std::move(other.m_arena) } {
+      other.m_commands.clear();
+    }
+
+    CommandBuffer& operator=(CommandBuffer&& other) {
+      if (this != &other) {
+        clear();
+        m_commands    = std::move(other.m_commands);
+        m_destroys    = std::move(other.m_destroys);
+        m_created     = std::move(other.m_created);
+        m_createCount = std::exchange(other.m_createCount, 0);
+        m_arena       = std::move(other.m_arena);
+        other.m_commands.clear();
+      }
+      return *this;
+    }
+
+    // Recorded values that were never played back are destroyed.
+    ~CommandBuffer() {
+      clear();
+    }
+
+    PendingEntity createEntity() {
+      return PendingEntity{ m_createCount++ };
+    }
+
+    void destroyEntity(EntityId entityId) {
+      m_destroys.push_back(entityId);
+    }
+
+    template <typename T>
+    void addComponent(EntityId entityId, T&& component) {
+      record(CommandType::Add, entityId, false, T::ComponentIdx, &impl::CommandOps<T>,
+        m_arena.create<T>(std::move(component)));
+    }
+
+    template <typename T>
+    void addComponent(PendingEntity entity, T&& component) {
+      rnAssert(entity.index < m_createCount);
+      record(CommandType::Add, entity.index, true, T::ComponentIdx, &impl::CommandOps<T>,
+        m_arena.create<T>(std::move(component)));
+    }
+
+    template <typename T>
+    void removeComponent(EntityId entityId) {
+      record(CommandType::Remove, entityId, false, T::ComponentIdx, &impl::CommandOps<T>, nullptr);
+    }
+
+    template <typename T>
+    void removeComponent(PendingEntity entity) {
+      rnAssert(entity.index < m_createCount);
+      record(CommandType::Remove, entity.index, true, T::ComponentIdx, &impl::CommandOps<T>, nullptr);
+    }
+
+    bool empty() const {
+      return m_createCount == 0 && m_destroys.empty() && m_commands.empty();
+    }
+
+    // Entities made by the last playback, indexed by PendingEntity::index.
+    std::span<const EntityId> created() const { return m_created; }
+
+    EntityId resolve(PendingEntity entity) const {
+      rnAssert(entity.index < m_created.size());
+      return m_created[entity.index];
+    }
+
+    // Drops everything recorded since the last playback.
+    void clear() {
+      for (const Command& command : m_commands) {
+        if (command.component)
+          command.ops->destroy(command.component);
+      }
+      m_commands.clear();
+      m_destroys.clear();
+      m_createCount = 0;
+      m_arena.reset();
+    }
+
+    void playback(World& world);
+
+  private:
+    friend struct impl::CommandPlayback;
+
+    using Command     = impl::Command;
+    using CommandType = impl::CommandType;
+
+    void record(CommandType type, uint32_t target, bool pending, uint32_t componentIdx, const impl::CommandComponentOps* ops, void* component) {
+      m_commands.push_back(Command{ target, componentIdx, uint32_t(m_commands.size()), type, pending, ops, component });
+    }
+
+    std::vector<Command>  m_commands;
+    std::vector<EntityId> m_destroys;
+    std::vector<EntityId> m_created;
+    uint32_t              m_createCount = 0;
+    LinearArena           m_arena;
+  };
+
+  // One CommandBuffer per thread of a JobSystem, played back together.
+  //
+  // Workers each get their own buffer. Every thread that isn't one of the
+  // JobSystem's workers maps to buffer 0, so between two playbacks only one
+  // such thread may call local(), which asserts it.
+  class CommandBuffers {
+  public:
+    explicit CommandBuffers(size_t count)
+      : m_buffers(count) {}
+
+    explicit CommandBuffers(const JobSystem& jobs)
+      : CommandBuffers{ jobs.threadCount() } {}
+
+    // The calling thread's buffer.
+    CommandBuffer& local(const JobSystem& jobs) {
+      const size_t index = jobs.threadIndex();
+      rnAssert(index < m_buffers.size());
+      if (index == 0) {
+        const std::thread::id self = std::this_thread::get_id();
+        std::thread::id owner{};
+        const bool claimed = m_external.compare_exchange_strong(owner, self, std::memory_order_relaxed);
+        rnAssert(claimed || owner == self);
+      }
+      return m_buffers[index];
+    }
+
+    CommandBuffer& operator[](size_t index) { return m_buffers[index]; }
+
+    size_t size() const { return m_buffers.size(); }
+
+    // Applies every buffer in one pass, at a point where nothing else is
+    // using the world:
+    //  - pending entities are created,
+    //  - component commands are sorted by component then entity, so each
+    //    ComponentArray is visited once, and only the last command for an
+    //    entity/component pair is applied,
+    //  - destroyed entities are skipped above and destroyed last.
+    // Handles that are no longer alive are ignored.
+    void playback(World& world) {
+      m_playback.run(world, m_buffers);
+      m_external.store(std::thread::id{}, std::memory_order_relaxed);
+    }
+
+  private:
+    std::vector<CommandBuffer>   m_buffers;
+    impl::CommandPlayback        m_playback;
+
+    // The non-worker thread that has used buffer 0 since the last playback.
+    std::atomic<std::thread::id> m_external{};
+  };
+
+  inline void CommandBuffer::playback(World& world) {
+    impl::CommandPlayback{}.run(world, std::span<CommandBuffer>{ this, 1 });
+  }
+
+  inline void impl::CommandPlayback::run(World& world, std::span<CommandBuffer> buffers) {
+    entries.clear();
+    destroys.clear();
+
+    for (uint32_t b = 0; b < buffers.size(); b++) {
+      CommandBuffer& buffer = buffers[b];
+
+      buffer.m_created.resize(buffer.m_createCount);
+      for (EntityId& entityId : buffer.m_created)
+        entityId = world.createEntity();
+
+      for (const auto& command : buffer.m_commands) {
+        const EntityId entityId = command.pending ? buffer.m_created[command.target] : command.target;
+        entries.push_back(Entry{ entityId, command.componentIdx, b, &command });
+      }
+      destroys.insert(destroys.end(), buffer.m_destroys.begin(), buffer.m_destroys.end());
+    }
+
+    std::sort(destroys.begin(), destroys.end());
+    destroys.erase(std::unique(destroys.begin(), destroys.end()), destroys.end());
+
+    // Within an entity/component pair the later command wins.
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+      if (a.componentIdx != b.componentIdx)
+        return a.componentIdx < b.componentIdx;
+      if (a.entityId != b.entityId)
+        return a.entityId < b.entityId;
+      if (a.buffer != b.buffer)
+        return a.buffer < b.buffer;
+      return a.command->order < b.command->order;
+    });
+
+    for (size_t begin = 0; begin < entries.size();) {
+      const uint32_t componentIdx = entries[begin].componentIdx;
+      size_t end  = begin;
+      size_t adds = 0;
+      for (; end < entries.size() && entries[end].componentIdx == componentIdx; end++)
+        adds += entries[end].command->type == CommandType::Add;
+      if (adds)
+        entries[begin].command->ops->reserve(world, adds);
+
+      for (size_t i = begin; i < end; i++) {
+        const Entry& entry = entries[i];
+        const bool last = i + 1 == end || entries[i + 1].entityId != entry.entityId;
+        if (!last || !world.alive(entry.entityId) || std::binary_search(destroys.begin(), destroys.end(), entry.entityId))
+          continue;
+
+        const Command& command = *entry.command;
+        if (command.type == CommandType::Add)
+          command.ops->add(world, entry.entityId, command.component);
+        else
+          command.ops->remove(world, entry.entityId);
+      }
+      begin = end;
+    }
+
+    for (const EntityId entityId : destroys) {
+      if (world.alive(entityId))
+        world.destroyEntity(entityId);
+    }
+
+    // Runs the destructors of the (moved from) component values.
+    for (CommandBuffer& buffer : buffers)
+      buffer.clear();
+  }
+
+}
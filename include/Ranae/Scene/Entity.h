@@ -1,61 +1,323 @@
 #pragma once
 
 #include <Ranae/Common.h>
+#include <Ranae/Core/Bitset.h>
 
 #include <vector>
-#include <deque>
 #include <array>
-#include <unordered_map>
+#include <atomic>
+#include <bit>
+#include <span>
 #include <cstring>
 
 namespace ranae {
 
+  // Entity handles are an index into the entity slots plus the generation
+  // of that slot when the handle was made. Destroying an entity bumps its
+  // slot's generation, so stale handles to a reused slot can be detected.
   using EntityId = uint32_t;
-  constexpr size_t MaxEntities = 1024;
 
+  constexpr uint32_t EntityIndexBits      = 22;
+  constexpr uint32_t EntityGenerationBits = 32 - EntityIndexBits;
+  constexpr uint32_t EntityIndexMask      = (1u << EntityIndexBits) - 1;
+  constexpr uint32_t EntityGenerationMask = (1u << EntityGenerationBits) - 1;
+
+  // The all ones index is never handed out, it is InvalidEntity's.
+  constexpr size_t   MaxEntities   = EntityIndexMask;
+  constexpr EntityId InvalidEntity = ~0u;
+
+  constexpr uint32_t entityIndex(EntityId id) {
+    return id & EntityIndexMask;
+  }
+
+  constexpr uint32_t entityGeneration(EntityId id) {
+    return id >> EntityIndexBits;
+  }
+
+  constexpr EntityId makeEntityId(uint32_t index, uint32_t generation) {
+    return (generation & EntityGenerationMask) << EntityIndexBits | (index & EntityIndexMask);
+  }
+
+  // Component types declare their index as a compile-time constant,
+  //   struct Velocity { static constexpr uint32_t ComponentIdx = 5; ... };
+  // which is also their bit in a ComponentSignature. A game lists all of
+  // its components in a ComponentList (below), which rejects two types
+  // sharing an index at compile time.
   using ComponentType = uint32_t;
-  constexpr ComponentType MaxComponents = 32;
+  constexpr ComponentType MaxComponents = 128;
 
-  using ComponentSignature = uint32_t;
+  using ComponentSignature = Bitset<MaxComponents>;
+
+  template <typename... Ts>
+  constexpr ComponentSignature componentSignature() {
+    static_assert(((Ts::ComponentIdx < MaxComponents) && ...));
+    return (ComponentSignature{} | ... | ComponentSignature::single(Ts::ComponentIdx));
+  }
+
+  // False if two of the types have the same index (or a type is repeated).
+  template <typename... Ts>
+  constexpr bool componentIndicesUnique() {
+    return componentSignature<Ts...>().count() == sizeof...(Ts);
+  }
+
+  // Every component type of a game, registered together:
+  //   using GameComponents = EngineComponents::Append<Position, Velocity>;
+  //   world.registerComponents(GameComponents{});
+  template <typename... Ts>
+  struct ComponentList {
+    static_assert(componentIndicesUnique<Ts...>(), "Two components in a ComponentList share a ComponentIdx");
+
+    static constexpr ComponentSignature Signature = componentSignature<Ts...>();
+
+    template <typename... Us>
+    using Append = ComponentList<Ts..., Us...>;
+  };
+
+  // Whether an entity or archetype with this signature matches a query.
+  inline bool signatureMatches(const ComponentSignature& signature, const ComponentSignature& required, const ComponentSignature& excluded) {
+    return signature.contains(required) && !signature.intersects(excluded);
+  }
+
+  // Calls func(i) for every signatures[i] that matches. Both tests are a
+  // single instruction over the whole signature with SSE4.1/AVX2, so this
+  // stays cheap over a lot of archetypes.
+  template <typename Func>
+  void forEachMatchingSignature(std::span<const ComponentSignature> signatures, const ComponentSignature& required, const ComponentSignature& excluded, Func&& func) {
+    for (size_t i = 0; i < signatures.size(); i++) {
+      if (signatureMatches(signatures[i], required, excluded))
+        func(uint32_t(i));
+    }
+  }
 
   class EntityManager {
   public:
-    EntityManager() {
-      for (EntityId i = 0; i < MaxEntities; i++)
-        m_availableEntities.push_back(i);
-    }
+    // Slots are allocated this many at a time and never move.
+    static constexpr uint32_t SlotChunkSize = 4096;
 
     inline EntityId createEntity() {
-      rnAssert(!m_availableEntities.empty());
+      uint32_t index = m_freeHead;
+      if (index != NoSlot) {
+        EntitySlot& entry = slot(index);
+        m_freeHead = entry.nextFree;
+        if (m_freeHead == NoSlot)
+          m_freeTail = NoSlot;
+        entry.nextFree = Alive;
+      } else {
+        rnAssert(m_slotCount < MaxEntities);
+        index = m_slotCount++;
+        if (index % SlotChunkSize == 0)
+          m_slotChunks.push_back(std::make_unique<EntitySlot[]>(SlotChunkSize));
+        slot(index).nextFree = Alive;
+      }
+
+      m_aliveCount++;
+      return makeEntityId(index, slot(index).generation);
+    }
 
-      EntityId id = m_availableEntities.front();
-      m_availableEntities.pop_front();
-      return id;
+    // Fills ids with new entities. Free slots are reused first like
+    // createEntity does, the rest are fresh slots allocated in one go.
+    void createEntities(std::span<EntityId> ids) {
+      size_t i = 0;
+      for (; i < ids.size() && m_freeHead != NoSlot; i++)
+        ids[i] = createEntity();
+
+      const uint32_t first     = m_slotCount;
+      const uint32_t remaining = uint32_t(ids.size() - i);
+      rnAssert(size_t(m_slotCount) + remaining <= MaxEntities);
+
+      m_slotCount += remaining;
+      while (m_slotChunks.size() * SlotChunkSize < m_slotCount)
+        m_slotChunks.push_back(std::make_unique<EntitySlot[]>(SlotChunkSize));
+
+      for (uint32_t k = 0; k < remaining; k++) {
+        EntitySlot& entry = slot(first + k);
+        entry.nextFree = Alive;
+        ids[i + k]     = makeEntityId(first + k, entry.generation);
+      }
+      m_aliveCount += remaining;
     }
 
+    // The slot goes on the back of the free list, so it takes as long as
+    // possible to be reused.
     inline void destroyEntity(EntityId id) {
-      rnAssert(id < MaxEntities);
-      m_availableEntities.push_back(id);
-      m_entitySignatures[id] = 0;
+      rnAssert(alive(id));
+
+      const uint32_t index = entityIndex(id);
+      EntitySlot& entry = slot(index);
+      entry.signature  = {};
+      entry.generation = (entry.generation + 1) & EntityGenerationMask;
+      entry.nextFree   = NoSlot;
+
+      if (m_freeTail != NoSlot)
+        slot(m_freeTail).nextFree = index;
+      else
+        m_freeHead = index;
+      m_freeTail = index;
+
+      m_aliveCount--;
+    }
+
+    bool alive(EntityId id) const {
+      const uint32_t index = entityIndex(id);
+      if (index >= m_slotCount)
+        return false;
+
+      const EntitySlot& entry = slot(index);
+      return entry.nextFree == Alive && entry.generation == entityGeneration(id);
     }
 
     void setSignature(EntityId id, ComponentSignature signature) {
-      rnAssert(id < MaxEntities);
-      m_entitySignatures[id] = signature;
+      rnAssert(alive(id));
+      slot(entityIndex(id)).signature = signature;
     }
 
-    ComponentSignature getSignature(EntityId id) {
-      rnAssert(id < MaxEntities);
-      return m_entitySignatures[id];
+    ComponentSignature getSignature(EntityId id) const {
+      rnAssert(alive(id));
+      return slot(entityIndex(id)).signature;
     }
+
+    size_t aliveCount() const { return m_aliveCount; }
+
+    // Calls func(EntityId) for every alive entity, in slot order.
+    template <typename Func>
+    void forEachEntity(Func&& func) const {
+      for (uint32_t index = 0; index < m_slotCount; index++) {
+        const EntitySlot& entry = slot(index);
+        if (entry.nextFree == Alive)
+          func(makeEntityId(index, entry.generation));
+      }
+    }
+
   private:
-    std::deque<EntityId> m_availableEntities;
-    std::array<ComponentSignature, MaxEntities> m_entitySignatures = {};
+    static constexpr uint32_t NoSlot = ~0u;
+    static constexpr uint32_t Alive  = ~0u - 1;
+
+    // Free slots are an intrusive FIFO list threaded through nextFree.
+    struct EntitySlot {
+      ComponentSignature signature  = {};
+      uint32_t           generation = 0;
+      uint32_t           nextFree   = NoSlot;
+    };
+
+    EntitySlot& slot(uint32_t index) {
+      return m_slotChunks[index / SlotChunkSize][index % SlotChunkSize];
+    }
+
+    const EntitySlot& slot(uint32_t index) const {
+      return m_slotChunks[index / SlotChunkSize][index % SlotChunkSize];
+    }
+
+    std::vector<std::unique_ptr<EntitySlot[]>> m_slotChunks;
+    uint32_t m_slotCount  = 0;
+    uint32_t m_aliveCount = 0;
+    uint32_t m_freeHead   = NoSlot;
+    uint32_t m_freeTail   = NoSlot;
   };
   
+  // Sparse set of entity handles: a paged sparse array maps entity index ->
+  // dense index, and the dense array maps back to the full handle. Lookups
+  // are two loads, and the dense array can be walked linearly.
+  class EntitySet {
+  public:
+    static constexpr size_t   SparsePageSize = 1024;
+    static constexpr uint32_t InvalidIndex   = ~0u;
+
+    // False for stale handles whose slot has since been reused.
+    bool contains(EntityId entityId) const {
+      const uint32_t idx = denseIndex(entityId);
+      return idx != InvalidIndex && m_dense[idx] == entityId;
+    }
+
+    // For entities known to be present, no checks outside of asserts.
+    uint32_t indexOf(EntityId entityId) const {
+      rnAssert(contains(entityId));
+      const uint32_t index = entityIndex(entityId);
+      return (*m_sparsePages[index / SparsePageSize])[index % SparsePageSize];
+    }
+
+    // Appends to the dense array and returns the new dense index.
+    uint32_t insert(EntityId entityId) {
+      uint32_t& slot = allocateSparseSlot(entityId);
+      rnAssert(slot == InvalidIndex);
+
+      slot = uint32_t(m_dense.size());
+      m_dense.push_back(entityId);
+      return slot;
+    }
+
+    // Removes by moving the last entity into the hole and returns the dense
+    // index the removed entity had. Anything kept in parallel with the dense
+    // array has to do the same move.
+    uint32_t erase(EntityId entityId) {
+      const uint32_t removedIdx = indexOf(entityId);
+      const uint32_t lastIdx    = uint32_t(m_dense.size() - 1);
+      if (removedIdx != lastIdx) {
+        const EntityId lastEntityId = m_dense[lastIdx];
+        sparseSlot(lastEntityId) = removedIdx;
+        m_dense[removedIdx]      = lastEntityId;
+      }
+
+      sparseSlot(entityId) = InvalidIndex;
+      m_dense.pop_back();
+      return removedIdx;
+    }
+
+    size_t size() const { return m_dense.size(); }
+
+    void reserve(size_t count) { m_dense.reserve(count); }
+
+    std::span<const EntityId> entities() const { return m_dense; }
+
+  private:
+    using SparsePage = std::array<uint32_t, SparsePageSize>;
+
+    uint32_t denseIndex(EntityId entityId) const {
+      const uint32_t index = entityIndex(entityId);
+      const size_t   page  = index / SparsePageSize;
+      if (page >= m_sparsePages.size() || !m_sparsePages[page])
+        return InvalidIndex;
+      return (*m_sparsePages[page])[index % SparsePageSize];
+    }
+
+    uint32_t& sparseSlot(EntityId entityId) {
+      const uint32_t index = entityIndex(entityId);
+      rnAssert(index / SparsePageSize < m_sparsePages.size() && m_sparsePages[index / SparsePageSize]);
+      return (*m_sparsePages[index / SparsePageSize])[index % SparsePageSize];
+    }
+
+    uint32_t& allocateSparseSlot(EntityId entityId) {
+      const uint32_t index = entityIndex(entityId);
+      const size_t   page  = index / SparsePageSize;
+      if (page >= m_sparsePages.size())
+        m_sparsePages.resize(page + 1);
+      if (!m_sparsePages[page]) {
+        m_sparsePages[page] = std::make_unique<SparsePage>();
+        m_sparsePages[page]->fill(InvalidIndex);
+      }
+      return (*m_sparsePages[page])[index % SparsePageSize];
+    }
+
+    std::vector<std::unique_ptr<SparsePage>> m_sparsePages;
+    std::vector<EntityId>                    m_dense;
+  };
+
+  // Change ticks only ever go up, wrapping around after 2^32. A tick is
+  // newer than another if it is less than 2^31 ahead of it.
+  constexpr bool isNewerTick(uint32_t tick, uint32_t since) {
+    return int32_t(tick - since) > 0;
+  }
+
+  // An entity gaining or losing a component, and the tick it happened at.
+  struct ComponentEvent {
+    EntityId entity;
+    uint32_t tick;
+  };
+
   template <typename T>
   class ComponentArray;
 
+  // What every ComponentArray has in common, so arrays of different types
+  // can be destroyed and cleaned up through one pointer.
   class GenericComponentArray {
   public:
     virtual ~GenericComponentArray() = default;
@@ -63,58 +325,139 @@ namespace ranae {
     virtual void removeData(EntityId entityId) = 0;
 
     void onEntityDestroyed(EntityId entityId) {
-      if (m_entityToIndexMap.find(entityId) != m_entityToIndexMap.end())
+      if (contains(entityId))
         removeData(entityId);
     }
+
+    bool contains(EntityId entityId) const { return m_entities.contains(entityId); }
+
+    size_t size() const { return m_entities.size(); }
+
+    // Entities in the same order as the component data.
+    std::span<const EntityId> entities() const { return m_entities.entities(); }
+
+    // Where the tick stamped on writes and events comes from, the
+    // ComponentManager's tick once registered.
+    void setClock(const std::atomic<uint32_t>* clock) { m_clock = clock; }
+
+    uint32_t tick() const { return m_clock ? m_clock->load(std::memory_order_relaxed) : 0; }
+
+    // Additions and removals in the order they happened, kept until
+    // clearEvents(). The ticks are in order too.
+    std::span<const ComponentEvent> added()   const { return m_added; }
+    std::span<const ComponentEvent> removed() const { return m_removed; }
+
+    std::span<const ComponentEvent> addedSince(uint32_t since) const   { return eventsSince(m_added, since); }
+    std::span<const ComponentEvent> removedSince(uint32_t since) const { return eventsSince(m_removed, since); }
+
+    void clearEvents() {
+      m_added.clear();
+      m_removed.clear();
+    }
+
   protected:
-    std::unordered_map<EntityId, size_t> m_entityToIndexMap;
-    std::unordered_map<size_t, EntityId> m_indexToEntityMap;
+    static std::span<const ComponentEvent> eventsSince(std::span<const ComponentEvent> events, uint32_t since) {
+      const auto first = std::partition_point(events.begin(), events.end(), [since](const ComponentEvent& event) {
+        return !isNewerTick(event.tick, since);
+      });
+      return events.subspan(size_t(first - events.begin()));
+    }
 
-    size_t m_size = 0;
+    EntitySet                    m_entities;
+    const std::atomic<uint32_t>* m_clock = nullptr;
+    std::vector<ComponentEvent>  m_added;
+    std::vector<ComponentEvent>  m_removed;
   };
   
+  // Besides the components themselves, keeps the tick each one was last
+  // written at. Mutable access (getData, at, mutableData) stamps the current
+  // tick, the const overloads and data() don't, so readers should go
+  // through those.
   template <typename T>
   class ComponentArray final : public GenericComponentArray {
   public:
     void insertData(EntityId entityId, T&& component) {
-      rnAssert(m_entityToIndexMap.find(entityId) == m_entityToIndexMap.end());
-      
-      const size_t idx = m_size++;
-      m_entityToIndexMap[entityId] = idx;
-      m_indexToEntityMap[idx]      = entityId;
-      m_componentArray  [idx]      = component;
+      const uint32_t now = tick();
+      m_entities.insert(entityId);
+      m_componentArray.push_back(std::move(component));
+      m_changeTicks.push_back(now);
+      m_added.push_back(ComponentEvent{ entityId, now });
     }
     
+    // Gives every entity a copy of component, copy constructed into one
+    // contiguous run at the end of the array.
+    void insertData(std::span<const EntityId> entityIds, const T& component) {
+      const uint32_t now    = tick();
+      const size_t   needed = m_componentArray.size() + entityIds.size();
+      if (needed > capacity())
+        reserve(std::max(needed, capacity() * 2));
+
+      for (const EntityId entityId : entityIds) {
+        m_entities.insert(entityId);
+        m_added.push_back(ComponentEvent{ entityId, now });
+      }
+      m_componentArray.insert(m_componentArray.end(), entityIds.size(), component);
+      m_changeTicks.insert(m_changeTicks.end(), entityIds.size(), now);
+    }
+
     void removeData(EntityId entityId) {
-      rnAssert(m_entityToIndexMap.find(entityId) != m_entityToIndexMap.end());
-      
       // Remove element by packing the last to keep contiguous.
-      const size_t removedIdx     = m_entityToIndexMap[entityId];
-      const size_t endElementIdx  = --m_size;
-      const EntityId endEntityId  = m_indexToEntityMap[endElementIdx];
+      const uint32_t removedIdx    = m_entities.erase(entityId);
+      const uint32_t endElementIdx = uint32_t(m_componentArray.size() - 1);
       if (removedIdx != endElementIdx) {
-        // Explicitly call destructor on what we are removing.
-        // and copy data of last element over without calling a constructor/destructor.
-        // More efficient than std::move.
-        m_componentArray[removedIdx].~T();
-        std::memcpy(&m_componentArray[removedIdx], &m_componentArray[endElementIdx], sizeof(T));
-
-        m_entityToIndexMap[endEntityId] = removedIdx;
-        m_indexToEntityMap[removedIdx]  = endEntityId;
+        m_componentArray[removedIdx] = std::move(m_componentArray[endElementIdx]);
+        m_changeTicks[removedIdx]    = m_changeTicks[endElementIdx];
       }
-      
-      m_entityToIndexMap.erase(entityId);
-      m_indexToEntityMap.erase(endElementIdx);
+
+      m_componentArray.pop_back();
+      m_changeTicks.pop_back();
+      m_removed.push_back(ComponentEvent{ entityId, tick() });
     }
     
+    void reserve(size_t count) {
+      m_entities.reserve(count);
+      m_componentArray.reserve(count);
+      m_changeTicks.reserve(count);
+    }
+
+    size_t capacity() const { return m_componentArray.capacity(); }
+
     T* getData(EntityId entityId) {
-      rnAssert(m_entityToIndexMap.find(entityId) != m_entityToIndexMap.end());
-      
-      return &m_componentArray[m_entityToIndexMap[entityId]];
+      return &at(m_entities.indexOf(entityId));
+    }
+
+    const T* getData(EntityId entityId) const {
+      return &at(m_entities.indexOf(entityId));
     }
+
+    // By dense index, see entities().
+    T& at(uint32_t index) {
+      m_changeTicks[index] = tick();
+      return m_componentArray[index];
+    }
+
+    const T& at(uint32_t index) const { return m_componentArray[index]; }
+
+    uint32_t indexOf(EntityId entityId) const { return m_entities.indexOf(entityId); }
+
+    uint32_t changeTick(EntityId entityId) const { return m_changeTicks[m_entities.indexOf(entityId)]; }
+
+    bool changedSince(EntityId entityId, uint32_t since) const { return isNewerTick(changeTick(entityId), since); }
+
+    // Dense component data, lines up with entities().
+    std::span<const T> data() const { return m_componentArray; }
+
+    // Counts as a write to every component, O(n) to stamp them all.
+    std::span<T> mutableData() {
+      std::fill(m_changeTicks.begin(), m_changeTicks.end(), tick());
+      return m_componentArray;
+    }
+
+    std::span<const uint32_t> changeTicks() const { return m_changeTicks; }
     
   private:
-    std::array<T, MaxEntities> m_componentArray;
+    std::vector<T>        m_componentArray;
+    std::vector<uint32_t> m_changeTicks;
   };
 
   namespace Component {
@@ -126,21 +469,42 @@ namespace ranae {
 
   struct NameComponent {
     static constexpr uint32_t ComponentIdx = Component::Name;
-    static constexpr ComponentType Type = 1u << ComponentIdx;
 
     const char* name;
   };
 
+  using EngineComponents = ComponentList<NameComponent>;
+
   class ComponentManager {
   public:
+    template <typename T>
+    void registerComponent() {
+      static_assert(T::ComponentIdx < MaxComponents);
+      rnAssert(!m_componentArrays[T::ComponentIdx]);
+      m_componentArrays[T::ComponentIdx] = std::make_unique<ComponentArray<T>>();
+      m_componentArrays[T::ComponentIdx]->setClock(&m_tick);
+    }
+
+    template <typename... Ts>
+    void registerComponents(ComponentList<Ts...>) {
+      (registerComponent<Ts>(), ...);
+    }
+
     template <typename T>
     ComponentArray<T>& getComponentArray() {
+      rnAssert(m_componentArrays[T::ComponentIdx]);
       return *static_cast<ComponentArray<T>*>(m_componentArrays[T::ComponentIdx].get());
     }
 
+    template <typename T>
+    const ComponentArray<T>& getComponentArray() const {
+      rnAssert(m_componentArrays[T::ComponentIdx]);
+      return *static_cast<const ComponentArray<T>*>(m_componentArrays[T::ComponentIdx].get());
+    }
+
     template <typename T>
     ComponentType getComponentType() {
-      return T::Type;
+      return T::ComponentIdx;
     }
 
     template <typename T>
@@ -155,22 +519,47 @@ namespace ranae {
 
     template <typename T>
     T& getComponent(EntityId entityId) {
-      return getComponentArray<T>().getData(entityId);
+      return *getComponentArray<T>().getData(entityId);
+    }
+
+    template <typename T>
+    const T& getComponent(EntityId entityId) const {
+      return *getComponentArray<T>().getData(entityId);
     }
 
     void onEntityDestroyed(EntityId entityId) {
-      for (const auto& componentArray : m_componentArrays)
-        componentArray->onEntityDestroyed(entityId);
+      for (const auto& componentArray : m_componentArrays) {
+        if (componentArray)
+          componentArray->onEntityDestroyed(entityId);
+      }
+    }
+
+    // Only touches the arrays the entity actually has a component in.
+    void onEntityDestroyed(EntityId entityId, const ComponentSignature& signature) {
+      signature.forEachSet([&](uint32_t idx) { m_componentArrays[idx]->removeData(entityId); });
+    }
+
+    // Stamped on every component write and add/remove event. A consumer
+    // takes advanceTick() once it is done and next time looks for changes
+    // newer than that, which leaves out its own writes even if someone else
+    // advanced the tick meanwhile. Whatever runs after it has to advance
+    // the tick before writing (SystemScheduler does so for every system),
+    // or its writes look as old as the consumer's run.
+    uint32_t tick() const { return m_tick.load(std::memory_order_relaxed); }
+
+    uint32_t advanceTick() { return m_tick.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+    void clearEvents() {
+      for (const auto& componentArray : m_componentArrays) {
+        if (componentArray)
+          componentArray->clearEvents();
+      }
     }
 
   private:
-    std::array<std::unique_ptr<GenericComponentArray>, Component::Count> m_componentArrays;
+    std::array<std::unique_ptr<GenericComponentArray>, MaxComponents> m_componentArrays;
+    std::atomic<uint32_t> m_tick{ 1 };
   };
 
-  /*class System {
-  protected:
-    std::set<EntityId> m_entities;
-  }*/
-
 }
 
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Core/Profiler.h>
+#include <Ranae/Math/Transform.h>
+#include <Ranae/Scene/Entity.h>
+
+#include <vector>
+
+namespace ranae {
+
+  // Parent/child relationships between entities and the World = Parent * Local
+  // propagation pass over them.
+  //
+  // Nodes are kept in breadth-first order: sorted by depth, with the children
+  // of any node contiguous. Changing a local transform queues that node, and
+  // propagate() only walks queued nodes and their descendants, level by level,
+  // so the cost is proportional to what moved rather than to the scene size.
+  class TransformHierarchy {
+  public:
+    static constexpr uint32_t InvalidNode = ~0u;
+
+    static constexpr size_t DefaultGrain = 256;
+
+    void addNode(EntityId entity, EntityId parent = InvalidEntity, const Transform& local = {}) {
+      rnAssert(!contains(entity));
+      rnAssert(parent == InvalidEntity || contains(parent));
+
+      const uint32_t index = entityIndex(entity);
+      if (index >= m_entityToNode.size())
+        m_entityToNode.resize(index + 1, InvalidNode);
+
+      const uint32_t node = uint32_t(m_entities.size());
+      m_entityToNode[index] = node;
+
+      m_entities.push_back(entity);
+      m_parents .push_back(parent == InvalidEntity ? InvalidNode : m_entityToNode[entityIndex(parent)]);
+      m_locals  .push_back(local);
+      m_worlds  .push_back(local);
+      m_queued  .push_back(1);
+
+      m_structureDirty = true;
+    }
+
+    // Children of a removed node become roots. The node is only marked
+    // here, the next rebuild() drops it and detaches its children, so
+    // removing k nodes costs O(k) plus the one O(n) rebuild.
+    void removeNode(EntityId entity) {
+      rnAssert(contains(entity));
+
+      const uint32_t node = m_entityToNode[entityIndex(entity)];
+      m_entities[node] = InvalidEntity;
+      m_parents [node] = InvalidNode;
+      m_entityToNode[entityIndex(entity)] = InvalidNode;
+      m_removedCount++;
+
+      m_structureDirty = true;
+    }
+
+    void setParent(EntityId entity, EntityId parent) {
+      rnAssert(contains(entity));
+      rnAssert(parent == InvalidEntity || contains(parent));
+
+      const uint32_t node      = m_entityToNode[entityIndex(entity)];
+      const uint32_t newParent = parent == InvalidEntity ? InvalidNode : m_entityToNode[entityIndex(parent)];
+
+      // No cycles.
+      for (uint32_t p = newParent; p != InvalidNode; p = m_parents[p])
+        rnAssert(p != node);
+
+      m_parents[node] = newParent;
+      queue(node);
+      m_structureDirty = true;
+    }
+
+    void setLocal(EntityId entity, const Transform& local) {
+      rnAssert(contains(entity));
+
+      const uint32_t node = m_entityToNode[entityIndex(entity)];
+      m_locals[node] = local;
+      queue(node);
+    }
+
+    void onEntityDestroyed(EntityId entity) {
+      if (contains(entity))
+        removeNode(entity);
+    }
+
+    bool contains(EntityId entity) const {
+      const uint32_t index = entityIndex(entity);
+      return index < m_entityToNode.size()
+          && m_entityToNode[index] != InvalidNode
+          && m_entities[m_entityToNode[index]] == entity;
+    }
+
+    EntityId parent(EntityId entity) const {
+      rnAssert(contains(entity));
+      const uint32_t p = m_parents[m_entityToNode[entityIndex(entity)]];
+      return p == InvalidNode ? InvalidEntity : m_entities[p];
+    }
+
+    const Transform& local(EntityId entity) const {
+      rnAssert(contains(entity));
+      return m_locals[m_entityToNode[entityIndex(entity)]];
+    }
+
+    // Valid as of the last propagate().
+    const Transform& world(EntityId entity) const {
+      rnAssert(contains(entity));
+      return m_worlds[m_entityToNode[entityIndex(entity)]];
+    }
+
+    size_t size() const { return m_entities.size() - m_removedCount; }
+
+    size_t levelCount() const { return m_structureDirty || m_levelStart.empty() ? 0 : m_levelStart.size() - 1; }
+
+    // Number of nodes whose world transform was recomputed by the last propagate().
+    size_t lastUpdateCount() const { return m_lastUpdateCount; }
+
+    // Recomputes the world transform of every queued node and everything
+    // below it. Each depth level is split into chunks of grain nodes that
+    // go through executor(count, grain, func(begin, end)) and may run
+    // concurrently; levels run one after another.
+    //
+    // Does not allocate unless the structure changed (or the worklists
+    // need to grow past their previous high water mark).
+    template <typename Executor = SerialExecutor>
+    void propagate(Executor&& executor = {}, size_t grain = DefaultGrain) {
+      RN_ZONE("TransformHierarchy::propagate");
+      if (m_structureDirty)
+        rebuild();
+
+      // Node order is depth order, so sorting the queue sorts it by level.
+      std::sort(m_pending.begin(), m_pending.end());
+
+      m_work.clear();
+      m_lastUpdateCount = 0;
+
+      size_t pending = 0;
+      for (size_t level = 0; level + 1 < m_levelStart.size(); level++) {
+        const uint32_t levelEnd = m_levelStart[level + 1];
+        while (pending < m_pending.size() && m_pending[pending] < levelEnd)
+          m_work.push_back(m_pending[pending++]);
+
+        if (m_work.empty()) {
+          if (pending == m_pending.size())
+            break;
+          continue;
+        }
+
+        executor(m_work.size(), grain, [this](size_t begin, size_t end) {
+          updateWorlds(begin, end);
+        });
+        m_lastUpdateCount += m_work.size();
+
+        // Everything below a node that moved has moved too.
+        m_next.clear();
+        for (const uint32_t node : m_work) {
+          m_queued[node] = 0;
+
+          const uint32_t first = m_firstChild[node];
+          for (uint32_t child = first; child < first + m_childCount[node]; child++) {
+            if (!m_queued[child]) {
+              m_queued[child] = 1;
+              m_next.push_back(child);
+            }
+          }
+        }
+        std::swap(m_work, m_next);
+      }
+
+      m_pending.clear();
+    }
+
+  private:
+
+    void queue(uint32_t node) {
+      if (!m_queued[node]) {
+        m_queued[node] = 1;
+        if (!m_structureDirty)
+          m_pending.push_back(node);
+      }
+    }
+
+    void updateWorlds(size_t begin, size_t end) {
+      const uint32_t*  work    = m_work.data();
+      const uint32_t*  parents = m_parents.data();
+      const Transform* locals  = m_locals.data();
+      Transform*       worlds  = m_worlds.data();
+
+      for (size_t k = begin; k < end; k++) {
+        const uint32_t node   = work[k];
+        const uint32_t parent = parents[node];
+        worlds[node] = parent == InvalidNode
+          ? locals[node]
+          : worlds[parent] * locals[node];
+      }
+    }
+
+    bool removed(uint32_t node) const {
+      return m_entities[node] == InvalidEntity;
+    }
+
+    // Re-sorts the nodes breadth-first, drops removed ones, and rebuilds the
+    // child ranges and level offsets. O(n), only done after structural
+    // changes.
+    void rebuild() {
+      const uint32_t total = uint32_t(m_entities.size());
+      const uint32_t count = total - m_removedCount;
+
+      // Children of removed nodes are roots now.
+      if (m_removedCount != 0) {
+        for (uint32_t i = 0; i < total; i++) {
+          if (m_parents[i] != InvalidNode && removed(m_parents[i])) {
+            m_parents[i] = InvalidNode;
+            m_queued [i] = 1;
+          }
+        }
+      }
+
+      // Bucket children by parent.
+      std::vector<uint32_t> childStart(total + 1, 0);
+      for (uint32_t i = 0; i < total; i++) {
+        if (m_parents[i] != InvalidNode)
+          childStart[m_parents[i] + 1]++;
+      }
+      for (uint32_t i = 0; i < total; i++)
+        childStart[i + 1] += childStart[i];
+
+      std::vector<uint32_t> children(childStart[total]);
+      {
+        std::vector<uint32_t> cursor(childStart.begin(), childStart.end() - 1);
+        for (uint32_t i = 0; i < total; i++) {
+          if (m_parents[i] != InvalidNode)
+            children[cursor[m_parents[i]]++] = i;
+        }
+      }
+
+      // Breadth-first from the roots gives depth order with siblings adjacent.
+      std::vector<uint32_t> order;
+      order.reserve(count);
+      for (uint32_t i = 0; i < total; i++) {
+        if (m_parents[i] == InvalidNode && !removed(i))
+          order.push_back(i);
+      }
+
+      std::vector<uint32_t> depth(total, 0);
+      for (size_t q = 0; q < order.size(); q++) {
+        const uint32_t node = order[q];
+        for (uint32_t c = childStart[node]; c < childStart[node + 1]; c++) {
+          depth[children[c]] = depth[node] + 1;
+          order.push_back(children[c]);
+        }
+      }
+      rnAssert(order.size() == count);
+
+      std::vector<uint32_t> remap(total);
+      for (uint32_t i = 0; i < count; i++)
+        remap[order[i]] = i;
+
+      std::vector<EntityId>  entities(count);
+      std::vector<uint32_t>  parents (count);
+      std::vector<Transform> locals  (count);
+      std::vector<Transform> worlds  (count);
+      std::vector<uint8_t>   queued  (count);
+      for (uint32_t i = 0; i < count; i++) {
+        const uint32_t old = order[i];
+        entities[i] = m_entities[old];
+        parents [i] = m_parents[old] == InvalidNode ? InvalidNode : remap[m_parents[old]];
+        locals  [i] = m_locals[old];
+        worlds  [i] = m_worlds[old];
+        queued  [i] = m_queued[old];
+        m_entityToNode[entityIndex(entities[i])] = i;
+      }
+      m_entities = std::move(entities);
+      m_parents  = std::move(parents);
+      m_locals   = std::move(locals);
+      m_worlds   = std::move(worlds);
+      m_queued   = std::move(queued);
+      m_removedCount = 0;
+
+      m_firstChild.assign(count, 0);
+      m_childCount.assign(count, 0);
+      for (uint32_t i = 0; i < count; i++) {
+        const uint32_t p = m_parents[i];
+        if (p != InvalidNode) {
+          if (m_childCount[p]++ == 0)
+            m_firstChild[p] = i;
+        }
+      }
+
+      m_levelStart.clear();
+      for (uint32_t i = 0; i < count; i++) {
+        while (m_levelStart.size() <= depth[order[i]])
+          m_levelStart.push_back(i);
+      }
+      m_levelStart.push_back(count);
+
+      m_pending.clear();
+      for (uint32_t i = 0; i < count; i++) {
+        if (m_queued[i])
+          m_pending.push_back(i);
+      }
+
+      m_structureDirty = false;
+    }
+
+    // Node data, breadth-first order once rebuilt.
+    std::vector<EntityId>  m_entities;
+    std::vector<uint32_t>  m_parents;
+    std::vector<Transform> m_locals;
+    std::vector<Transform> m_worlds;
+    std::vector<uint8_t>   m_queued;
+
+    std::vector<uint32_t>  m_firstChild;
+    std::vector<uint32_t>  m_childCount;
+    std::vector<uint32_t>  m_levelStart;
+
+    std::vector<uint32_t>  m_entityToNode;
+
+    std::vector<uint32_t>  m_pending;
+    std::vector<uint32_t>  m_work;
+    std::vector<uint32_t>  m_next;
+
+    // Nodes removed since the last rebuild(), still taking up their slots.
+    uint32_t m_removedCount    = 0;
+    size_t   m_lastUpdateCount = 0;
+    bool     m_structureDirty  = false;
+  };
+
+}
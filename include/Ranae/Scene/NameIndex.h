@@ -0,0 +1,149 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Core/StringInterner.h>
+#include <Ranae/Scene/Entity.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ranae {
+
+  // Name -> entities lookup. Names go through a StringInterner (an open
+  // addressing table), and each NameId owns a dense list of the entities
+  // using it, so a lookup is one probe plus an index and duplicates are
+  // fine. Removing an entity is O(1), every entity remembers where it is
+  // in its list.
+  //
+  // World keeps one of these in sync with NameComponent.
+  class NameIndex {
+  public:
+    void insert(EntityId entityId, std::string_view name) {
+      const uint32_t index = entityIndex(entityId);
+      if (index >= m_entityNames.size())
+        m_entityNames.resize(index + 1);
+      rnAssert(m_entityNames[index].name == InvalidNameId);
+
+      const NameId nameId = m_names.intern(name);
+      if (nameId >= m_entities.size())
+        m_entities.resize(nameId + 1);
+
+      std::vector<EntityId>& entities = m_entities[nameId];
+      m_entityNames[index] = EntityName{ nameId, uint32_t(entities.size()) };
+      entities.push_back(entityId);
+      m_count++;
+    }
+
+    void erase(EntityId entityId) {
+      const uint32_t index = entityIndex(entityId);
+      rnAssert(contains(entityId));
+
+      // Swap remove, the moved entity's position follows it.
+      const EntityName entry = m_entityNames[index];
+      std::vector<EntityId>& entities = m_entities[entry.name];
+      entities[entry.position] = entities.back();
+      m_entityNames[entityIndex(entities.back())].position = entry.position;
+      entities.pop_back();
+
+      m_entityNames[index] = EntityName{};
+      m_count--;
+    }
+
+    bool contains(EntityId entityId) const {
+      const uint32_t index = entityIndex(entityId);
+      if (index >= m_entityNames.size() || m_entityNames[index].name == InvalidNameId)
+        return false;
+
+      const EntityName& entry = m_entityNames[index];
+      return m_entities[entry.name][entry.position] == entityId;
+    }
+
+    // Some entity with that name, InvalidEntity if there is none.
+    EntityId find(std::string_view name) const {
+      const std::span<const EntityId> entities = findAll(name);
+      return entities.empty() ? InvalidEntity : entities.front();
+    }
+
+    // Every entity with that name, in no particular order.
+    std::span<const EntityId> findAll(std::string_view name) const {
+      return findAll(m_names.find(name));
+    }
+
+    std::span<const EntityId> findAll(NameId nameId) const {
+      if (nameId == InvalidNameId || nameId >= m_entities.size())
+        return {};
+      return m_entities[nameId];
+    }
+
+    NameId nameOf(EntityId entityId) const {
+      return contains(entityId) ? m_entityNames[entityIndex(entityId)].name : InvalidNameId;
+    }
+
+    // Calls func(EntityId, std::string_view name) for every entity whose
+    // name starts with prefix, grouped by name in sorted order. Names are
+    // kept sorted lazily, the first call after new names were added merges
+    // them in. Safe to call concurrently, as long as nothing is inserted.
+    template <typename Func>
+    void forEachWithPrefix(std::string_view prefix, Func&& func) const {
+      sortNames();
+
+      auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), prefix,
+        [](const SortedName& entry, std::string_view key) { return entry.name < key; });
+      for (; it != m_sorted.end() && it->name.starts_with(prefix); ++it) {
+        for (const EntityId entityId : m_entities[it->id])
+          func(entityId, it->name);
+      }
+    }
+
+    // Named entities.
+    size_t size() const { return m_count; }
+
+    const StringInterner& names() const { return m_names; }
+
+  private:
+    struct EntityName {
+      NameId   name     = InvalidNameId;
+      uint32_t position = 0;
+    };
+
+    struct SortedName {
+      std::string_view name;
+      NameId           id;
+
+      bool operator < (const SortedName& other) const { return name < other.name; }
+    };
+
+    // Names only ever get added to the interner, with increasing ids, so
+    // the ones past m_sortedCount are the new ones.
+    void sortNames() const {
+      if (m_sortedCount.load(std::memory_order_acquire) == m_names.size())
+        return;
+
+      std::lock_guard lock{ m_sortMutex };
+      const size_t sorted = m_sorted.size();
+      const size_t total  = m_names.size();
+      if (sorted == total)
+        return;
+
+      for (NameId id = NameId(sorted + 1); id <= total; id++)
+        m_sorted.push_back(SortedName{ m_names.name(id), id });
+      std::sort(m_sorted.begin() + sorted, m_sorted.end());
+      std::inplace_merge(m_sorted.begin(), m_sorted.begin() + sorted, m_sorted.end());
+      m_sortedCount.store(total, std::memory_order_release);
+    }
+
+    StringInterner                     m_names;
+    std::vector<std::vector<EntityId>> m_entities;     // by NameId
+    std::vector<EntityName>            m_entityNames;  // by entity index
+    size_t                             m_count = 0;
+
+    mutable std::vector<SortedName> m_sorted;
+    mutable std::atomic<size_t>     m_sortedCount{ 0 };
+    mutable std::mutex              m_sortMutex;
+  };
+
+}
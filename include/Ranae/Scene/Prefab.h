@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Scene/Entity.h>
+
+#include <vector>
+
+namespace ranae {
+
+  // One component value of a Prefab, stamped out through the typed
+  // ComponentArray without the Prefab knowing the type.
+  class GenericPrefabComponent {
+  public:
+    virtual ~GenericPrefabComponent() = default;
+
+    virtual void instantiate(ComponentManager& components, std::span<const EntityId> entityIds) const = 0;
+
+    virtual std::unique_ptr<GenericPrefabComponent> clone() const = 0;
+  };
+
+  template <typename T>
+  class PrefabComponent final : public GenericPrefabComponent {
+  public:
+    explicit PrefabComponent(T&& component)
+      : value{ std::move(component) } {}
+
+    void instantiate(ComponentManager& components, std::span<const EntityId> entityIds) const {
+      components.getComponentArray<T>().insertData(entityIds, value);
+    }
+
+    std::unique_ptr<GenericPrefabComponent> clone() const {
+      return std::make_unique<PrefabComponent<T>>(T{ value });
+    }
+
+    T value;
+  };
+
+  // A set of component values that World::instantiate copies onto any
+  // number of new entities at once.
+  class Prefab {
+  public:
+    Prefab() = default;
+
+    Prefab(const Prefab& other)
+      : m_signature{ other.m_signature } {
+      for (size_t i = 0; i < MaxComponents; i++) {
+        if (other.m_components[i])
+          m_components[i] = other.m_components[i]->clone();
+      }
+    }
+
+    Prefab& operator=(const Prefab& other) {
+      if (this != &other)
+        *this = Prefab{ other };
+      return *this;
+    }
+
+    Prefab(Prefab&&) = default;
+    Prefab& operator=(Prefab&&) = default;
+
+    // Replaces the value if the prefab already has a T.
+    template <typename T>
+    Prefab& add(T&& component) {
+      static_assert(T::ComponentIdx < MaxComponents);
+      m_components[T::ComponentIdx] = std::make_unique<PrefabComponent<T>>(std::move(component));
+      m_signature.set(T::ComponentIdx, true);
+      return *this;
+    }
+
+    template <typename T>
+    Prefab& remove() {
+      m_components[T::ComponentIdx].reset();
+      m_signature.set(T::ComponentIdx, false);
+      return *this;
+    }
+
+    template <typename T>
+    bool has() const { return m_signature.get(T::ComponentIdx); }
+
+    template <typename T>
+    T& get() {
+      rnAssert(has<T>());
+      return static_cast<PrefabComponent<T>*>(m_components[T::ComponentIdx].get())->value;
+    }
+
+    template <typename T>
+    const T& get() const {
+      rnAssert(has<T>());
+      return static_cast<const PrefabComponent<T>*>(m_components[T::ComponentIdx].get())->value;
+    }
+
+    ComponentSignature signature() const { return m_signature; }
+
+    // Gives every entity a copy of each component, one array at a time.
+    void instantiate(ComponentManager& components, std::span<const EntityId> entityIds) const {
+      m_signature.forEachSet([&](uint32_t idx) { m_components[idx]->instantiate(components, entityIds); });
+    }
+
+  private:
+    std::array<std::unique_ptr<GenericPrefabComponent>, MaxComponents> m_components;
+    ComponentSignature m_signature = {};
+  };
+
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Scene/Entity.h>
+
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ranae {
+
+  // Marks component types a Query<...> entity must not have:
+  //   Query<Position, Velocity, Without<Frozen>>
+  template <typename... Ts>
+  struct Without {};
+
+  // Required component types of which at least one must have been written
+  // since the tick given to Query::since():
+  //   Query<Changed<const Transform>, const Mesh>
+  template <typename... Ts>
+  struct Changed {};
+
+  namespace impl {
+    template <typename T>
+    struct QueryTerm {
+      static constexpr ComponentSignature Required = componentSignature<std::remove_const_t<T>>();
+      static constexpr ComponentSignature Excluded = {};
+      using Fetched = std::tuple<T>;
+      using Watched = std::tuple<>;
+    };
+
+    template <typename... Ts>
+    struct QueryTerm<Without<Ts...>> {
+      static constexpr ComponentSignature Required = {};
+      static constexpr ComponentSignature Excluded = componentSignature<std::remove_const_t<Ts>...>();
+      using Fetched = std::tuple<>;
+      using Watched = std::tuple<>;
+    };
+
+    template <typename... Ts>
+    struct QueryTerm<Changed<Ts...>> {
+      static constexpr ComponentSignature Required = componentSignature<std::remove_const_t<Ts>...>();
+      static constexpr ComponentSignature Excluded = {};
+      using Fetched = std::tuple<Ts...>;
+      using Watched = std::tuple<Ts...>;
+    };
+
+    template <typename T>
+    using QueryArray = ComponentArray<std::remove_const_t<T>>;
+
+    // Const components are fetched without stamping a change.
+    template <typename T>
+    T& queryFetch(QueryArray<T>& array, uint32_t index) {
+      if constexpr (std::is_const_v<T>)
+        return std::as_const(array).at(index);
+      else
+        return array.at(index);
+    }
+  }
+
+  // The set of entities whose signature has every required and none of the
+  // excluded components. It is kept up to date as signatures change, so a
+  // query never rescans the entities, and only two mask tests are paid per
+  // query on each change.
+  class QueryState {
+  public:
+    QueryState(const ComponentSignature& required, const ComponentSignature& excluded)
+      : m_required{ required }
+      , m_excluded{ excluded } {
+      rnAssert(!required.intersects(excluded));
+    }
+
+    bool matches(const ComponentSignature& signature) const {
+      return signatureMatches(signature, m_required, m_excluded);
+    }
+
+    void onEntityCreated(EntityId entityId, const ComponentSignature& signature = {}) {
+      if (matches(signature))
+        m_entities.insert(entityId);
+    }
+
+    void onEntitiesCreated(std::span<const EntityId> entityIds, const ComponentSignature& signature = {}) {
+      if (!matches(signature))
+        return;
+
+      for (const EntityId entityId : entityIds)
+        m_entities.insert(entityId);
+    }
+
+    void onSignatureChanged(EntityId entityId, const ComponentSignature& oldSignature, const ComponentSignature& newSignature) {
+      const bool was = matches(oldSignature);
+      const bool is  = matches(newSignature);
+      if (was != is) {
+        if (is)
+          m_entities.insert(entityId);
+        else
+          m_entities.erase(entityId);
+      }
+    }
+
+    void onEntityDestroyed(EntityId entityId, const ComponentSignature& signature) {
+      if (matches(signature))
+        m_entities.erase(entityId);
+    }
+
+    const ComponentSignature& required() const { return m_required; }
+    const ComponentSignature& excluded() const { return m_excluded; }
+
+    bool contains(EntityId entityId) const { return m_entities.contains(entityId); }
+
+    size_t size() const { return m_entities.size(); }
+
+    std::span<const EntityId> entities() const { return m_entities.entities(); }
+
+  private:
+    ComponentSignature m_required;
+    ComponentSignature m_excluded;
+    EntitySet          m_entities;
+  };
+
+  // Typed view over a QueryState. The masks are worked out from the
+  // component types at compile time; forEach hands out references to the
+  // required components (Without<...> ones are not fetched). Components
+  // asked for as const are read without counting as a change.
+  //
+  // Adding or removing components or entities while iterating is not
+  // allowed, it can reorder the matched set underneath the loop.
+  template <typename... Terms>
+  class Query {
+  public:
+    static constexpr ComponentSignature Required = (ComponentSignature{} | ... | impl::QueryTerm<Terms>::Required);
+    static constexpr ComponentSignature Excluded = (ComponentSignature{} | ... | impl::QueryTerm<Terms>::Excluded);
+    static_assert(!Required.intersects(Excluded), "A component can't be both required and excluded.");
+
+    Query(QueryState& state, ComponentManager& components)
+      : m_state{ &state }
+      , m_components{ &components } {
+      rnAssert(state.required() == Required && state.excluded() == Excluded);
+    }
+
+    size_t size() const { return m_state->size(); }
+    bool   empty() const { return m_state->size() == 0; }
+
+    bool contains(EntityId entityId) const { return m_state->contains(entityId); }
+
+    std::span<const EntityId> entities() const { return m_state->entities(); }
+
+    // Changed<...> terms only let through entities written after this tick.
+    // The default of 0 lets everything through.
+    Query& since(uint32_t tick) {
+      m_since = tick;
+      return *this;
+    }
+
+    // func(EntityId, Required&...), in the order the types were listed.
+    template <typename Func>
+    void forEach(Func&& func) {
+      forEach(SerialExecutor{}, std::numeric_limits<size_t>::max(), func);
+    }
+
+    // Same as forEach, with the matched set split into chunks of grain
+    // entities through executor(count, grain, func(begin, end)), so the
+    // chunks may run concurrently.
+    template <typename Executor, typename Func>
+    void forEach(Executor&& executor, size_t grain, Func&& func) {
+      forEachImpl(executor, grain, func, static_cast<Fetched*>(nullptr), static_cast<Watched*>(nullptr));
+    }
+
+  private:
+    using Fetched = decltype(std::tuple_cat(std::declval<typename impl::QueryTerm<Terms>::Fetched>()...));
+    using Watched = decltype(std::tuple_cat(std::declval<typename impl::QueryTerm<Terms>::Watched>()...));
+
+    template <typename Executor, typename Func, typename... Ts, typename... Ws>
+    void forEachImpl(Executor& executor, size_t grain, Func& func, std::tuple<Ts...>*, std::tuple<Ws...>*) {
+      // Arrays are looked up once, the loop itself is plain sparse set
+      // lookups without any virtual calls.
+      const std::tuple<impl::QueryArray<Ts>&...> arrays{ m_components->getComponentArray<std::remove_const_t<Ts>>()... };
+      const std::span<const EntityId>            entities = m_state->entities();
+      const uint32_t                             since    = m_since;
+
+      executor(entities.size(), grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          const EntityId entityId = entities[i];
+          if constexpr (sizeof...(Ws) != 0) {
+            if (!(... || std::get<impl::QueryArray<Ws>&>(arrays).changedSince(entityId, since)))
+              continue;
+          }
+          func(entityId, impl::queryFetch<Ts>(std::get<impl::QueryArray<Ts>&>(arrays), std::get<impl::QueryArray<Ts>&>(arrays).indexOf(entityId))...);
+        }
+      });
+    }
+
+    QueryState*       m_state;
+    ComponentManager* m_components;
+    uint32_t          m_since = 0;
+  };
+
+}
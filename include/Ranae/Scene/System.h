@@ -0,0 +1,246 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Core/JobSystem.h>
+#include <Ranae/Core/Profiler.h>
+#include <Ranae/Scene/World.h>
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ranae {
+
+  // Component access a system declares when it is added:
+  //   scheduler.addSystem<Read<Velocity>, Write<Position>>("move", func);
+  template <typename... Ts>
+  struct Read {};
+
+  template <typename... Ts>
+  struct Write {};
+
+  struct SystemAccess {
+    ComponentSignature reads  = {};
+    ComponentSignature writes = {};
+
+    // Two systems can run at the same time unless one writes something the
+    // other touches.
+    bool conflicts(const SystemAccess& other) const {
+      return writes.intersects(other.reads | other.writes)
+          || other.writes.intersects(reads);
+    }
+  };
+
+  namespace impl {
+    template <typename T>
+    struct SystemAccessTerm;
+
+    template <typename... Ts>
+    struct SystemAccessTerm<Read<Ts...>> {
+      static constexpr SystemAccess Access = { .reads = componentSignature<Ts...>() };
+    };
+
+    template <typename... Ts>
+    struct SystemAccessTerm<Write<Ts...>> {
+      static constexpr SystemAccess Access = { .writes = componentSignature<Ts...>() };
+    };
+  }
+
+  // Runs a frame's worth of systems on a JobSystem. Systems that conflict
+  // keep the order they were added in, everything else is free to run
+  // concurrently. A system gets the World and the JobSystem, so it can
+  // split its own queries into parallel chunks too, and optionally the
+  // change tick of its previous run to pass to Query::since().
+  //
+  // Systems must not make structural changes (create/destroy entities or
+  // add/remove components) while the scheduler runs, the World is shared.
+  class SystemScheduler {
+  public:
+    using SystemFunc = std::function<void(World&, JobSystem&, uint32_t lastRun)>;
+
+    static constexpr uint32_t InvalidSystem = ~0u;
+
+    template <typename... Access, typename Func>
+    uint32_t addSystem(const char* name, Func&& func) {
+      SystemAccess access;
+      ((access.reads  |= impl::SystemAccessTerm<Access>::Access.reads), ...);
+      ((access.writes |= impl::SystemAccessTerm<Access>::Access.writes), ...);
+      return addSystem(name, access, std::forward<Func>(func));
+    }
+
+    template <typename Func>
+    uint32_t addSystem(const char* name, SystemAccess access, Func&& func) {
+      SystemFunc wrapped;
+      if constexpr (std::is_invocable_v<Func&, World&, JobSystem&, uint32_t>) {
+        wrapped = std::forward<Func>(func);
+      } else {
+        wrapped = [func = std::forward<Func>(func)](World& world, JobSystem& jobs, uint32_t) mutable {
+          func(world, jobs);
+        };
+      }
+      m_systems.push_back(SystemEntry{ name, access, std::move(wrapped), true, 0 });
+      return uint32_t(m_systems.size() - 1);
+    }
+
+    uint32_t findSystem(const char* name) const {
+      for (uint32_t i = 0; i < m_systems.size(); i++) {
+        if (std::strcmp(m_systems[i].name, name) == 0)
+          return i;
+      }
+      return InvalidSystem;
+    }
+
+    // Disabled systems are left out of the graph, nothing waits on them.
+    void setEnabled(uint32_t system, bool enabled) {
+      rnAssert(system < m_systems.size());
+      m_systems[system].enabled = enabled;
+    }
+
+    bool enabled(uint32_t system) const {
+      rnAssert(system < m_systems.size());
+      return m_systems[system].enabled;
+    }
+
+    const SystemAccess& access(uint32_t system) const {
+      rnAssert(system < m_systems.size());
+      return m_systems[system].access;
+    }
+
+    size_t systemCount() const { return m_systems.size(); }
+
+    // Systems the given one waits on in the last run(), for debugging.
+    // Empty before the first run() and for systems added since.
+    std::vector<uint32_t> dependencies(uint32_t system) const {
+      std::vector<uint32_t> result;
+      if (size_t(system) + 1 >= m_edgeStart.size())
+        return result;
+      for (uint32_t i = 0; i < system; i++) {
+        for (uint32_t e = m_edgeStart[i]; e < m_edgeStart[i + 1]; e++) {
+          if (m_edges[e] == system)
+            result.push_back(i);
+        }
+      }
+      return result;
+    }
+
+    // Builds the dependency graph of the enabled systems and runs them,
+    // returning once all of them have finished. The calling thread helps.
+    //
+    // Each system takes a fresh change tick as it starts, and remembers one
+    // taken after it finishes as its lastRun. Its own writes are older than
+    // that, and anything touching the same components either finished
+    // before it started or starts after it finished, under a newer tick. So
+    // comparing against lastRun finds exactly the changes made since,
+    // minus its own.
+    void run(World& world, JobSystem& jobs) {
+      RN_ZONE("SystemScheduler::run");
+      buildGraph();
+
+      const uint32_t count = uint32_t(m_systems.size());
+      for (uint32_t i = 0; i < count; i++)
+        m_remaining[i].store(m_dependencyCount[i], std::memory_order_relaxed);
+
+      JobCounter counter;
+      for (uint32_t i = 0; i < count; i++) {
+        if (m_systems[i].enabled && m_dependencyCount[i] == 0)
+          launch(i, world, jobs, counter);
+      }
+      jobs.wait(counter);
+
+      // Changes made between frames are newer than any system's last run.
+      world.advanceTick();
+    }
+
+  private:
+    struct SystemEntry {
+      const char*  name;
+      SystemAccess access;
+      SystemFunc   func;
+      bool         enabled;
+      uint32_t     lastRun;
+    };
+
+    void launch(uint32_t system, World& world, JobSystem& jobs, JobCounter& counter) {
+      jobs.run(counter, [this, system, &world, &jobs, &counter] {
+        // The tick taken on the way in orders this system's writes after
+        // everything that ran before it. lastRun is taken on the way out,
+        // so it is newer than all of them even if a concurrent system
+        // advanced the tick in between.
+        SystemEntry& entry = m_systems[system];
+        world.advanceTick();
+        entry.func(world, jobs, entry.lastRun);
+        entry.lastRun = world.advanceTick();
+
+        // Dependents go on the queue before this job is counted as done,
+        // so the counter can't reach zero early.
+        for (uint32_t e = m_edgeStart[system]; e < m_edgeStart[system + 1]; e++) {
+          const uint32_t next = m_edges[e];
+          if (m_remaining[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            launch(next, world, jobs, counter);
+        }
+      });
+    }
+
+    // Edge i -> j for i < j when they conflict. Edges implied by a path
+    // through a third system are left out, they would only add atomics.
+    void buildGraph() {
+      const uint32_t count = uint32_t(m_systems.size());
+
+      m_edges.clear();
+      m_edgeStart.assign(count + 1, 0);
+      m_dependencyCount.assign(count, 0);
+      if (m_remaining.size() != count)
+        m_remaining = std::vector<std::atomic<uint32_t>>(count);
+
+      // reach[j * count + i] is set once i is known to run before j.
+      m_reach.assign(size_t(count) * count, 0);
+      for (uint32_t j = 0; j < count; j++) {
+        if (!m_systems[j].enabled)
+          continue;
+
+        // Walking back from the closest system means a conflict that is
+        // already reachable is implied and can be skipped.
+        for (uint32_t i = j; i-- > 0;) {
+          if (!m_systems[i].enabled || m_reach[size_t(j) * count + i])
+            continue;
+          if (!m_systems[i].access.conflicts(m_systems[j].access))
+            continue;
+
+          m_pending.push_back({ i, j });
+          m_dependencyCount[j]++;
+          m_reach[size_t(j) * count + i] = 1;
+          for (uint32_t k = 0; k < i; k++)
+            m_reach[size_t(j) * count + k] |= m_reach[size_t(i) * count + k];
+        }
+      }
+
+      // Pack the edges by source system.
+      for (const auto& [from, to] : m_pending)
+        m_edgeStart[from + 1]++;
+      for (uint32_t i = 0; i < count; i++)
+        m_edgeStart[i + 1] += m_edgeStart[i];
+      m_edges.resize(m_pending.size());
+      {
+        std::vector<uint32_t> cursor(m_edgeStart.begin(), m_edgeStart.end() - 1);
+        for (const auto& [from, to] : m_pending)
+          m_edges[cursor[from]++] = to;
+      }
+      m_pending.clear();
+    }
+
+    std::vector<SystemEntry> m_systems;
+
+    // The graph of the last run(), edges packed by source system.
+    std::vector<uint32_t>              m_edgeStart;
+    std::vector<uint32_t>              m_edges;
+    std::vector<uint32_t>              m_dependencyCount;
+    std::vector<std::atomic<uint32_t>> m_remaining;
+
+    // Scratch for buildGraph().
+    std::vector<uint8_t>                       m_reach;
+    std::vector<std::pair<uint32_t, uint32_t>> m_pending;
+  };
+
+}
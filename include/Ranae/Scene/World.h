@@ -0,0 +1,214 @@
+#pragma once
+
+#include <Ranae/Common.h>
+#include <Ranae/Scene/Entity.h>
+#include <Ranae/Scene/NameIndex.h>
+#include <Ranae/Scene/Prefab.h>
+#include <Ranae/Scene/Query.h>
+
+#include <mutex>
+#include <vector>
+
+namespace ranae {
+
+  // Ties the entity and component managers together and keeps every query
+  // in sync with the signature changes that go through it. Going around the
+  // World (straight to the managers) leaves the queries and the name index
+  // stale. That includes renaming an entity by writing to its
+  // NameComponent, use setComponent for that.
+  class World {
+  public:
+    template <typename T>
+    void registerComponent() {
+      m_components.registerComponent<T>();
+    }
+
+    template <typename... Ts>
+    void registerComponents(ComponentList<Ts...> components) {
+      m_components.registerComponents(components);
+    }
+
+    EntityId createEntity() {
+      const EntityId entityId = m_entities.createEntity();
+      for (const auto& query : m_queries)
+        query->onEntityCreated(entityId);
+      return entityId;
+    }
+
+    // Fills entityIds with new entities, in one pass over the slots and
+    // one per query.
+    void createEntities(std::span<EntityId> entityIds) {
+      m_entities.createEntities(entityIds);
+      for (const auto& query : m_queries)
+        query->onEntitiesCreated(entityIds);
+    }
+
+    std::vector<EntityId> createEntities(size_t count) {
+      std::vector<EntityId> entityIds(count);
+      createEntities(entityIds);
+      return entityIds;
+    }
+
+    // Fills entityIds with new entities that each get a copy of the
+    // prefab's components. Every component array grows once and gets its
+    // copies in one contiguous run.
+    void instantiate(const Prefab& prefab, std::span<EntityId> entityIds) {
+      const ComponentSignature signature = prefab.signature();
+
+      m_entities.createEntities(entityIds);
+      for (const EntityId entityId : entityIds)
+        m_entities.setSignature(entityId, signature);
+
+      prefab.instantiate(m_components, entityIds);
+      if (prefab.has<NameComponent>()) {
+        for (const EntityId entityId : entityIds)
+          m_names.insert(entityId, nameOf(prefab.get<NameComponent>()));
+      }
+
+      for (const auto& query : m_queries)
+        query->onEntitiesCreated(entityIds, signature);
+    }
+
+    std::vector<EntityId> instantiate(const Prefab& prefab, size_t count) {
+      std::vector<EntityId> entityIds(count);
+      instantiate(prefab, entityIds);
+      return entityIds;
+    }
+
+    void destroyEntity(EntityId entityId) {
+      const ComponentSignature signature = m_entities.getSignature(entityId);
+      for (const auto& query : m_queries)
+        query->onEntityDestroyed(entityId, signature);
+
+      if (signature.get(NameComponent::ComponentIdx))
+        m_names.erase(entityId);
+
+      m_components.onEntityDestroyed(entityId, signature);
+      m_entities.destroyEntity(entityId);
+    }
+
+    bool alive(EntityId entityId) const { return m_entities.alive(entityId); }
+
+    template <typename T>
+    void addComponent(EntityId entityId, T&& component) {
+      const ComponentSignature signature = m_entities.getSignature(entityId);
+      rnAssert(!signature.get(T::ComponentIdx));
+
+      if constexpr (std::is_same_v<T, NameComponent>)
+        m_names.insert(entityId, nameOf(component));
+
+      m_components.addComponent(entityId, std::move(component));
+      setSignature(entityId, signature, signature | componentSignature<T>());
+    }
+
+    template <typename T>
+    void removeComponent(EntityId entityId) {
+      const ComponentSignature signature = m_entities.getSignature(entityId);
+      rnAssert(signature.get(T::ComponentIdx));
+
+      if constexpr (std::is_same_v<T, NameComponent>)
+        m_names.erase(entityId);
+
+      m_components.removeComponent<T>(entityId);
+      setSignature(entityId, signature, signature & ~componentSignature<T>());
+    }
+
+    // Adds the component, or replaces the one the entity already has.
+    template <typename T>
+    void setComponent(EntityId entityId, T&& component) {
+      if (!hasComponent<T>(entityId)) {
+        addComponent(entityId, std::move(component));
+        return;
+      }
+
+      if constexpr (std::is_same_v<T, NameComponent>) {
+        m_names.erase(entityId);
+        m_names.insert(entityId, nameOf(component));
+      }
+      getComponent<T>(entityId) = std::move(component);
+    }
+
+    // Counts as a write for change detection, the const overload doesn't.
+    template <typename T>
+    T& getComponent(EntityId entityId) {
+      return m_components.getComponent<T>(entityId);
+    }
+
+    template <typename T>
+    const T& getComponent(EntityId entityId) const {
+      return m_components.getComponent<T>(entityId);
+    }
+
+    template <typename T>
+    bool hasComponent(EntityId entityId) const {
+      return m_entities.getSignature(entityId).get(T::ComponentIdx);
+    }
+
+    ComponentSignature getSignature(EntityId entityId) const {
+      return m_entities.getSignature(entityId);
+    }
+
+    // Some entity named name, InvalidEntity if there is none. See
+    // names() for duplicates and prefix lookups.
+    EntityId findEntity(std::string_view name) const { return m_names.find(name); }
+
+    const NameIndex& names() const { return m_names; }
+
+    // Queries with the same masks share one matched set. The first call
+    // for a set of masks scans the alive entities once, after that it is
+    // only kept up to date. Finding the state is a walk over the existing
+    // queries, so hold on to the returned Query in hot code. Safe to call
+    // from concurrently running systems.
+    template <typename... Terms>
+    Query<Terms...> query() {
+      return Query<Terms...>{ queryState(Query<Terms...>::Required, Query<Terms...>::Excluded), m_components };
+    }
+
+    size_t queryCount() const { return m_queries.size(); }
+
+    // Change ticks, see ComponentManager::tick().
+    uint32_t tick() const   { return m_components.tick(); }
+    uint32_t advanceTick()  { return m_components.advanceTick(); }
+
+    // Drops the added/removed events of every component type, once
+    // everything interested in them has had a look.
+    void clearEvents() { m_components.clearEvents(); }
+
+    EntityManager&    entities()   { return m_entities; }
+    ComponentManager& components() { return m_components; }
+
+  private:
+    static std::string_view nameOf(const NameComponent& component) {
+      return component.name ? std::string_view{ component.name } : std::string_view{};
+    }
+
+    void setSignature(EntityId entityId, const ComponentSignature& oldSignature, const ComponentSignature& newSignature) {
+      m_entities.setSignature(entityId, newSignature);
+      for (const auto& query : m_queries)
+        query->onSignatureChanged(entityId, oldSignature, newSignature);
+    }
+
+    QueryState& queryState(const ComponentSignature& required, const ComponentSignature& excluded) {
+      std::lock_guard lock{ m_queryMutex };
+      for (const auto& query : m_queries) {
+        if (query->required() == required && query->excluded() == excluded)
+          return *query;
+      }
+
+      QueryState& query = *m_queries.emplace_back(std::make_unique<QueryState>(required, excluded));
+      m_entities.forEachEntity([&](EntityId entityId) {
+        query.onEntityCreated(entityId, m_entities.getSignature(entityId));
+      });
+      return query;
+    }
+
+    EntityManager    m_entities;
+    ComponentManager m_components;
+    NameIndex        m_names;
+
+    // Boxed so Query views stay valid as more queries are added.
+    std::vector<std::unique_ptr<QueryState>> m_queries;
+    std::mutex                               m_queryMutex;
+  };
+
+}
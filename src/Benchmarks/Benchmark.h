@@ -0,0 +1,219 @@
+#pragma once
+
+#include <Ranae/Common.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#endif
+
+namespace ranae::bench {
+
+  // Keeps value (and everything it was computed from) alive, without
+  // storing it anywhere.
+  template <typename T>
+  inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+    const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+    (void)*sink;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+  }
+
+  // Forces pending writes to memory to happen, as if someone read them.
+  inline void clobberMemory() {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : : "memory");
+#endif
+  }
+
+  // Reference cycles where there is a TSC (constant rate, not the core
+  // clock under turbo), nanoseconds otherwise.
+  inline uint64_t cycles() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+  }
+
+  struct Options {
+    size_t warmup      = 2;     // repetitions thrown away
+    size_t repetitions = 15;
+    double minTimeMs   = 5.0;   // per repetition, the iteration count is picked to reach it
+    std::string filter;         // only benchmarks whose name contains it
+    std::string output;         // JSON goes here, stdout if empty
+  };
+
+  struct Result {
+    std::string name;
+    size_t      elements;    // per iteration
+    size_t      iterations;  // per repetition
+    double      median;      // ns per element, over the repetitions
+    double      p10;
+    double      p90;
+    double      min;
+    double      max;
+    double      cyclesPerElement;  // median
+  };
+
+  // Runs benchmarks and collects their results. Each repetition times a
+  // batch of iterations, so cheap bodies aren't drowned out by the clock.
+  class Runner {
+  public:
+    Runner(int argc, char** argv) {
+      for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        const auto value = [&]() { return i + 1 < argc ? std::string{ argv[++i] } : std::string{}; };
+        if (arg == "--filter")
+          m_options.filter = value();
+        else if (arg == "--out")
+          m_options.output = value();
+        else if (arg == "--repetitions")
+          m_options.repetitions = std::max<size_t>(1, std::stoul(value()));
+        else if (arg == "--min-time-ms")
+          m_options.minTimeMs = std::stod(value());
+        else if (arg == "--quick") {
+          m_options.warmup      = 1;
+          m_options.repetitions = 3;
+          m_options.minTimeMs   = 0.5;
+        }
+      }
+    }
+
+    const Options& options() const { return m_options; }
+
+    // func() runs one iteration, over elements items.
+    template <typename Func>
+    void run(std::string_view name, size_t elements, Func&& func) {
+      if (!m_options.filter.empty() && name.find(m_options.filter) == std::string_view::npos)
+        return;
+
+      // Double the batch until it takes long enough to time.
+      size_t iterations = 1;
+      for (;;) {
+        const double ns = measure(iterations, func).first;
+        if (ns >= m_options.minTimeMs * 1e6 || iterations >= (size_t(1) << 30))
+          break;
+        iterations *= ns > 0.0 ? std::clamp<size_t>(size_t(m_options.minTimeMs * 1e6 / ns * 1.2), 2, 64) : 64;
+      }
+
+      for (size_t i = 0; i < m_options.warmup; i++)
+        measure(iterations, func);
+
+      const double perElement = double(iterations) * double(std::max<size_t>(elements, 1));
+      std::vector<double> times, cycleCounts;
+      for (size_t i = 0; i < m_options.repetitions; i++) {
+        const auto [ns, ticks] = measure(iterations, func);
+        times.push_back(ns / perElement);
+        cycleCounts.push_back(double(ticks) / perElement);
+      }
+      std::sort(times.begin(), times.end());
+      std::sort(cycleCounts.begin(), cycleCounts.end());
+
+      const Result& result = m_results.emplace_back(Result{
+        std::string{ name }, elements, iterations,
+        percentile(times, 0.5), percentile(times, 0.1), percentile(times, 0.9),
+        times.front(), times.back(), percentile(cycleCounts, 0.5) });
+
+      char line[256];
+      std::snprintf(line, sizeof(line), "%-48s %10.3f ns/elem  [p10 %8.3f, p90 %8.3f]  %8.2f cycles/elem\n",
+        result.name.c_str(), result.median, result.p10, result.p90, result.cyclesPerElement);
+      std::cerr << line;
+    }
+
+    // Writes the JSON report, returns false if the file couldn't be written.
+    bool finish() const {
+      if (m_options.output.empty()) {
+        writeJson(std::cout);
+        return bool(std::cout);
+      }
+
+      std::ofstream file{ m_options.output };
+      writeJson(file);
+      return bool(file);
+    }
+
+    const std::vector<Result>& results() const { return m_results; }
+
+  private:
+    template <typename Func>
+    static std::pair<double, uint64_t> measure(size_t iterations, Func& func) {
+      const auto     start      = std::chrono::steady_clock::now();
+      const uint64_t startTicks = cycles();
+      for (size_t i = 0; i < iterations; i++) {
+        func();
+        clobberMemory();
+      }
+      const uint64_t ticks = cycles() - startTicks;
+      const auto     end   = std::chrono::steady_clock::now();
+      return { double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()), ticks };
+    }
+
+    // Linear interpolation between the closest ranks, sorted must be sorted.
+    static double percentile(const std::vector<double>& sorted, double p) {
+      const double rank  = p * double(sorted.size() - 1);
+      const size_t lower = size_t(rank);
+      const size_t upper = std::min(lower + 1, sorted.size() - 1);
+      return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - double(lower));
+    }
+
+    void writeJson(std::ostream& out) const {
+      char number[64];
+      const auto num = [&](double value) {
+        std::snprintf(number, sizeof(number), "%.6g", value);
+        return number;
+      };
+
+      out << "{\n  \"context\": {\n";
+      out << "    \"repetitions\": " << m_options.repetitions << ",\n";
+      out << "    \"warmup\": " << m_options.warmup << ",\n";
+      out << "    \"min_time_ms\": " << num(m_options.minTimeMs) << ",\n";
+      out << "    \"simd\": \"" << simdLevel() << "\"\n";
+      out << "  },\n  \"benchmarks\": [";
+      for (size_t i = 0; i < m_results.size(); i++) {
+        const Result& r = m_results[i];
+        out << (i ? ",\n" : "\n");
+        out << "    { \"name\": \"" << r.name << "\"";
+        out << ", \"elements\": " << r.elements;
+        out << ", \"iterations\": " << r.iterations;
+        out << ", \"ns_per_element\": { \"median\": " << num(r.median);
+        out << ", \"p10\": " << num(r.p10);
+        out << ", \"p90\": " << num(r.p90);
+        out << ", \"min\": " << num(r.min);
+        out << ", \"max\": " << num(r.max) << " }";
+        out << ", \"cycles_per_element\": " << num(r.cyclesPerElement) << " }";
+      }
+      out << "\n  ]\n}\n";
+    }
+
+    static const char* simdLevel() {
+#if defined(__AVX2__)
+      return "avx2";
+#elif defined(__SSE4_1__)
+      return "sse4.1";
+#else
+      return "scalar";
+#endif
+    }
+
+    Options             m_options;
+    std::vector<Result> m_results;
+  };
+
+}
@@ -0,0 +1,485 @@
+#include "Benchmark.h"
+
+#include <Ranae/Core/Bitset.h>
+#include <Ranae/Core/Hash.h>
+#include <Ranae/Core/JobSystem.h>
+#include <Ranae/Math/Matrix.h>
+#include <Ranae/Math/Quaternion.h>
+#include <Ranae/Math/Transform.h>
+#include <Ranae/Math/Vector.h>
+#include <Ranae/Math/VectorStream.h>
+#include <Ranae/Scene/Animation.h>
+#include <Ranae/Scene/Entity.h>
+
+#include <algorithm>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace ranae;
+using namespace ranae::bench;
+
+namespace {
+
+  // Big enough to get past call overhead, small enough to stay in L1/L2.
+  constexpr size_t BatchSize = 1024;
+
+  std::mt19937 rng{ 1234 };
+
+  float randomFloat(float lo = -1.0f, float hi = 1.0f) {
+    return std::uniform_real_distribution<float>{ lo, hi }(rng);
+  }
+
+  template <size_t Size>
+  std::vector<Vector<float, Size>> randomVectors(size_t count) {
+    std::vector<Vector<float, Size>> vectors(count);
+    for (auto& v : vectors) {
+      for (size_t i = 0; i < Size; i++)
+        v[i] = randomFloat();
+    }
+    return vectors;
+  }
+
+  Quaternion<float> randomRotation() {
+    return Quaternion<float>{ normalize(Vector<float, 4>{ randomFloat(), randomFloat(), randomFloat(), randomFloat() }) };
+  }
+
+  Matrix4 randomMatrix() {
+    Matrix4 m;
+    for (size_t c = 0; c < 4; c++) {
+      for (size_t r = 0; r < 4; r++)
+        m[c][r] = randomFloat();
+    }
+    return m;
+  }
+
+  Transform randomTransform() {
+    return Transform{
+      .position    = Vector<float, 3>{ randomFloat(), randomFloat(), randomFloat() },
+      .orientation = randomRotation(),
+      .scale       = Vector<float, 3>{ randomFloat(0.5f, 2.0f), randomFloat(0.5f, 2.0f), randomFloat(0.5f, 2.0f) },
+    };
+  }
+
+  template <size_t Size>
+  void vectorBenchmarks(Runner& runner) {
+    const std::string prefix = "Vector<float, " + std::to_string(Size) + ">/";
+    const auto a = randomVectors<Size>(BatchSize);
+    const auto b = randomVectors<Size>(BatchSize);
+    std::vector<Vector<float, Size>> out(BatchSize);
+
+    runner.run(prefix + "add", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = a[i] + b[i];
+      doNotOptimize(out.data());
+    });
+    runner.run(prefix + "mul_add", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = a[i] * b[i] + a[i];
+      doNotOptimize(out.data());
+    });
+    runner.run(prefix + "dot", BatchSize, [&] {
+      float sum = 0.0f;
+      for (size_t i = 0; i < BatchSize; i++)
+        sum += dot(a[i], b[i]);
+      doNotOptimize(sum);
+    });
+    runner.run(prefix + "normalize", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = normalize(a[i]);
+      doNotOptimize(out.data());
+    });
+    if constexpr (Size == 3) {
+      runner.run(prefix + "cross", BatchSize, [&] {
+        for (size_t i = 0; i < BatchSize; i++)
+          out[i] = cross(a[i], b[i]);
+        doNotOptimize(out.data());
+      });
+    }
+  }
+
+  void matrixBenchmarks(Runner& runner) {
+    std::vector<Matrix4> a(BatchSize), b(BatchSize), out(BatchSize);
+    for (size_t i = 0; i < BatchSize; i++) {
+      a[i] = randomMatrix();
+      b[i] = randomMatrix();
+    }
+    std::vector<float> determinants(BatchSize);
+
+    runner.run("Matrix4/determinant", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        determinants[i] = determinant(a[i]);
+      doNotOptimize(determinants.data());
+    });
+    runner.run("Matrix4/multiply", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = a[i] * b[i];
+      doNotOptimize(out.data());
+    });
+    runner.run("Matrix4/multiply_batched", BatchSize, [&] {
+      multiply(std::span<const Matrix4>{ a }, std::span<const Matrix4>{ b }, std::span<Matrix4>{ out });
+      doNotOptimize(out.data());
+    });
+    runner.run("Matrix4/inverse", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = inverse(a[i]);
+      doNotOptimize(out.data());
+    });
+    runner.run("Matrix4/inverse_batched", BatchSize, [&] {
+      inverse(std::span<const Matrix4>{ a }, std::span<Matrix4>{ out });
+      doNotOptimize(out.data());
+    });
+
+    const auto vectors = randomVectors<4>(BatchSize);
+    std::vector<Vector<float, 4>> transformed(BatchSize);
+    runner.run("Matrix4/transform_vector", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        transformed[i] = a[0] * vectors[i];
+      doNotOptimize(transformed.data());
+    });
+  }
+
+  void quaternionBenchmarks(Runner& runner) {
+    std::vector<Quaternion<float>> rotations(BatchSize), products(BatchSize);
+    for (auto& q : rotations)
+      q = randomRotation();
+    const auto vectors = randomVectors<3>(BatchSize);
+    std::vector<Vector<float, 3>> out(BatchSize);
+
+    runner.run("Quaternion/rotate", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = rotations[i] * vectors[i];
+      doNotOptimize(out.data());
+    });
+    runner.run("Quaternion/multiply", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        products[i] = rotations[i] * rotations[BatchSize - 1 - i];
+      doNotOptimize(products.data());
+    });
+    runner.run("Quaternion/rotate_batched", BatchSize, [&] {
+      rotate(std::span<const Quaternion<float>>{ rotations }, std::span<const Vector<float, 3>>{ vectors }, std::span<Vector<float, 3>>{ out });
+      doNotOptimize(out.data());
+    });
+    runner.run("Quaternion/rotate_one_batched", BatchSize, [&] {
+      rotate(rotations[0], std::span<const Vector<float, 3>>{ vectors }, std::span<Vector<float, 3>>{ out });
+      doNotOptimize(out.data());
+    });
+    runner.run("Quaternion/multiply_batched", BatchSize, [&] {
+      multiply(std::span<const Quaternion<float>>{ rotations }, std::span<const Quaternion<float>>{ rotations }, std::span<Quaternion<float>>{ products });
+      doNotOptimize(products.data());
+    });
+    runner.run("Quaternion/normalize_batched", BatchSize, [&] {
+      normalize(std::span<const Quaternion<float>>{ rotations }, std::span<Quaternion<float>>{ products });
+      doNotOptimize(products.data());
+    });
+
+    std::vector<Vector<float, 4>> rotationVectors(BatchSize);
+    for (size_t i = 0; i < BatchSize; i++)
+      rotationVectors[i] = rotations[i];
+    const VectorStream<float, 4> rotationStream{ std::span<const Vector<float, 4>>{ rotationVectors } };
+    const VectorStream<float, 3> vectorStream{ std::span<const Vector<float, 3>>{ vectors } };
+    VectorStream<float, 3> outStream{ BatchSize };
+    VectorStream<float, 4> productStream{ BatchSize };
+    runner.run("QuaternionStream/rotate", BatchSize, [&] {
+      rotate(rotationStream, vectorStream, outStream);
+      doNotOptimize(outStream.lane(0));
+    });
+    runner.run("QuaternionStream/rotate_one", BatchSize, [&] {
+      rotate(rotations[0], vectorStream, outStream);
+      doNotOptimize(outStream.lane(0));
+    });
+    runner.run("QuaternionStream/compose", BatchSize, [&] {
+      compose(rotationStream, rotationStream, productStream);
+      doNotOptimize(productStream.lane(0));
+    });
+  }
+
+  void animationBenchmarks(Runner& runner) {
+    std::vector<Quaternion<float>> from(BatchSize), to(BatchSize), out(BatchSize);
+    std::vector<float> alphas(BatchSize);
+    for (size_t i = 0; i < BatchSize; i++) {
+      from[i]   = randomRotation();
+      to[i]     = randomRotation();
+      alphas[i] = randomFloat(0.0f, 1.0f);
+    }
+
+    runner.run("Quaternion/nlerp", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = nlerp(from[i], to[i], alphas[i]);
+      doNotOptimize(out.data());
+    });
+    runner.run("Quaternion/slerp", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = slerp(from[i], to[i], alphas[i]);
+      doNotOptimize(out.data());
+    });
+    runner.run("Quaternion/slerp_fast", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = slerpFast(from[i], to[i], alphas[i]);
+      doNotOptimize(out.data());
+    });
+
+    std::vector<Vector<float, 4>> fromVectors(BatchSize), toVectors(BatchSize);
+    for (size_t i = 0; i < BatchSize; i++) {
+      fromVectors[i] = from[i];
+      toVectors[i]   = to[i];
+    }
+    const VectorStream<float, 4> fromStream{ std::span<const Vector<float, 4>>{ fromVectors } };
+    const VectorStream<float, 4> toStream{ std::span<const Vector<float, 4>>{ toVectors } };
+    VectorStream<float, 4> outStream{ BatchSize };
+    runner.run("QuaternionStream/slerp_fast", BatchSize, [&] {
+      slerpFast(fromStream, toStream, std::span<const float>{ alphas }, outStream);
+      doNotOptimize(outStream.lane(0));
+    });
+
+    // A 64 joint skeleton with 30 keys per channel, sampled at 60 Hz.
+    // Per joint.
+    constexpr size_t Joints = 64;
+    AnimationClip clip;
+    for (uint32_t j = 0; j < Joints; j++) {
+      AnimationTrack track;
+      track.target = j;
+      for (size_t k = 0; k < 30; k++) {
+        const float time = float(k) / 10.0f;
+        track.position.times.push_back(time);
+        track.position.values.push_back(randomVectors<3>(1)[0]);
+        track.orientation.times.push_back(time);
+        track.orientation.values.push_back(randomRotation());
+      }
+      clip.tracks.push_back(std::move(track));
+    }
+    AnimationSampler sampler{ clip };
+    TransformStream pose{ Joints };
+    float time = 0.0f;
+    runner.run("AnimationSampler/sample", Joints, [&] {
+      sampler.sample(time, pose.view());
+      time = time + 1.0f / 60.0f < clip.duration() ? time + 1.0f / 60.0f : 0.0f;
+      doNotOptimize(pose.positions.lane(0));
+    });
+
+    TransformStream other{ Joints };
+    sampler.sample(1.0f, other.view());
+    const TransformStreamView poses[] = { pose.view(), other.view() };
+    const float weights[] = { 0.7f, 0.3f };
+    TransformStream blended{ Joints };
+    runner.run("AnimationSampler/blend_two", Joints, [&] {
+      blendPoses(poses, weights, blended.view());
+      doNotOptimize(blended.positions.lane(0));
+    });
+  }
+
+  void transformBenchmarks(Runner& runner) {
+    std::vector<Transform> parents(BatchSize), locals(BatchSize), out(BatchSize);
+    for (size_t i = 0; i < BatchSize; i++) {
+      parents[i] = randomTransform();
+      locals[i]  = randomTransform();
+    }
+    std::vector<Matrix4x3> matrices(BatchSize);
+
+    runner.run("Transform/compose", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = parents[i] * locals[i];
+      doNotOptimize(out.data());
+    });
+    runner.run("Transform/relative", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        out[i] = parents[i] / locals[i];
+      doNotOptimize(out.data());
+    });
+    runner.run("Transform/to_matrix4x3", BatchSize, [&] {
+      for (size_t i = 0; i < BatchSize; i++)
+        matrices[i] = transformMatrix4x3(parents[i]);
+      doNotOptimize(matrices.data());
+    });
+  }
+
+  template <size_t Bits>
+  void bitsetBenchmarks(Runner& runner) {
+    const std::string prefix = "Bitset<" + std::to_string(Bits) + ">/";
+    std::vector<Bitset<Bits>> sets(BatchSize);
+    for (auto& set : sets) {
+      for (size_t bit = 0; bit < Bits; bit++)
+        set.set(bit, rng() % 4 == 0);
+    }
+    Bitset<Bits> required, excluded;
+    required.set(1, true);
+    required.set(Bits / 2, true);
+    excluded.set(Bits - 1, true);
+
+    runner.run(prefix + "match", BatchSize, [&] {
+      size_t matches = 0;
+      for (size_t i = 0; i < BatchSize; i++)
+        matches += sets[i].contains(required) && !sets[i].intersects(excluded);
+      doNotOptimize(matches);
+    });
+    runner.run(prefix + "and_or", BatchSize, [&] {
+      Bitset<Bits> acc;
+      for (size_t i = 0; i < BatchSize; i++)
+        acc |= sets[i] & required;
+      doNotOptimize(acc);
+    });
+    runner.run(prefix + "count", BatchSize, [&] {
+      size_t total = 0;
+      for (size_t i = 0; i < BatchSize; i++)
+        total += sets[i].count();
+      doNotOptimize(total);
+    });
+    runner.run(prefix + "for_each_set", BatchSize, [&] {
+      size_t total = 0;
+      for (size_t i = 0; i < BatchSize; i++)
+        sets[i].forEachSet([&](size_t bit) { total += bit; });
+      doNotOptimize(total);
+    });
+  }
+
+  void dynamicBitsetBenchmarks(Runner& runner) {
+    constexpr size_t Bits = 1 << 20;
+    DynamicBitset a{ Bits }, b{ Bits };
+    for (size_t i = 0; i < Bits; i += 3)
+      a.set(i, true);
+    for (size_t i = 0; i < Bits; i += 5)
+      b.set(i, true);
+
+    // Per 64-bit word.
+    runner.run("DynamicBitset/and", Bits / 64, [&] {
+      DynamicBitset c = a;
+      c &= b;
+      doNotOptimize(c.words().data());
+    });
+    runner.run("DynamicBitset/count", Bits / 64, [&] {
+      doNotOptimize(a.count());
+    });
+  }
+
+  void hashBenchmarks(Runner& runner) {
+    for (const size_t length : { 8, 32, 128 }) {
+      std::vector<std::string> strings(256);
+      for (auto& s : strings) {
+        s.resize(length);
+        for (char& c : s)
+          c = char('a' + rng() % 26);
+      }
+
+      // Per byte.
+      const std::string suffix = "/" + std::to_string(length);
+      runner.run("hash_string" + suffix, strings.size() * length, [&] {
+        uint32_t h = 0;
+        for (const std::string& s : strings)
+          h ^= hash_string(s.c_str(), s.size());
+        doNotOptimize(h);
+      });
+      runner.run("hash64" + suffix, strings.size() * length, [&] {
+        uint64_t h = 0;
+        for (const std::string& s : strings)
+          h ^= hash64(s);
+        doNotOptimize(h);
+      });
+    }
+  }
+
+  struct BenchComponent {
+    static constexpr uint32_t ComponentIdx = 1;
+
+    Vector<float, 3> position;
+    Vector<float, 3> velocity;
+  };
+
+  void componentArrayBenchmarks(Runner& runner) {
+    for (const size_t count : { 1000, 10000, 100000 }) {
+      const std::string suffix = "/" + std::to_string(count);
+
+      std::vector<EntityId> ids(count);
+      for (size_t i = 0; i < count; i++)
+        ids[i] = EntityId(i);
+      std::vector<EntityId> shuffled = ids;
+      std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+      // An insert and a remove per element, removal in random order.
+      ComponentArray<BenchComponent> churn;
+      churn.reserve(count);
+      runner.run("ComponentArray/insert_remove" + suffix, count, [&] {
+        for (const EntityId id : ids)
+          churn.insertData(id, BenchComponent{});
+        for (const EntityId id : shuffled)
+          churn.removeData(id);
+        churn.clearEvents();
+      });
+
+      ComponentArray<BenchComponent> array;
+      for (const EntityId id : ids)
+        array.insertData(id, BenchComponent{});
+      const ComponentArray<BenchComponent>& constArray = array;
+
+      runner.run("ComponentArray/get_random" + suffix, count, [&] {
+        float sum = 0.0f;
+        for (const EntityId id : shuffled)
+          sum += constArray.getData(id)->position[0];
+        doNotOptimize(sum);
+      });
+      // The mutable span is taken once: getting it stamps every change
+      // tick, which would otherwise be most of what this measures.
+      const std::span<BenchComponent> components = array.mutableData();
+      runner.run("ComponentArray/iterate" + suffix, count, [&] {
+        for (BenchComponent& c : components)
+          c.position += c.velocity;
+        doNotOptimize(constArray.data().data());
+      });
+    }
+  }
+
+  void jobSystemBenchmarks(Runner& runner) {
+    JobSystem jobs;
+
+    // Per job, started from outside the pool and from inside a worker.
+    constexpr size_t Jobs = 4096;
+    std::atomic<size_t> ran{ 0 };
+    runner.run("JobSystem/run_external", Jobs, [&] {
+      JobCounter counter;
+      for (size_t i = 0; i < Jobs; i++)
+        jobs.run(counter, [&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+      jobs.wait(counter);
+    });
+    runner.run("JobSystem/run_nested", Jobs, [&] {
+      JobCounter counter;
+      jobs.run(counter, [&] {
+        for (size_t i = 0; i < Jobs; i++)
+          jobs.run(counter, [&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+      });
+      jobs.wait(counter);
+    });
+    doNotOptimize(ran.load());
+
+    // Per item, with a small grain so the splitting shows.
+    std::vector<float> values(1 << 18, 1.0f);
+    runner.run("JobSystem/parallel_reduce", values.size(), [&] {
+      const float sum = jobs.parallelReduce(values.size(), 256, 0.0f, [&](size_t begin, size_t end) {
+        float partial = 0.0f;
+        for (size_t i = begin; i < end; i++)
+          partial += values[i];
+        return partial;
+      }, [](float a, float b) { return a + b; });
+      doNotOptimize(sum);
+    });
+  }
+
+}
+
+int main(int argc, char** argv) {
+  Runner runner{ argc, argv };
+
+  vectorBenchmarks<3>(runner);
+  vectorBenchmarks<4>(runner);
+  matrixBenchmarks(runner);
+  quaternionBenchmarks(runner);
+  transformBenchmarks(runner);
+  animationBenchmarks(runner);
+  bitsetBenchmarks<128>(runner);
+  bitsetBenchmarks<1024>(runner);
+  dynamicBitsetBenchmarks(runner);
+  hashBenchmarks(runner);
+  componentArrayBenchmarks(runner);
+  jobSystemBenchmarks(runner);
+
+  return runner.finish() ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 #include <Ranae/Common.h>
+#include <Ranae/Core/Profiler.h>
 #include <iostream>
 #include <vulkan/vulkan.h>
 #include <SDL2/SDL.h>
@@ -235,11 +236,18 @@ namespace ranae {
     uint32_t frame_id = 0;
     bool shouldQuit = false;
     while (!shouldQuit) {
+      RN_FRAME();
+
       SDL_Event event;
       while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) shouldQuit = true;
+#if defined(RN_PROFILE) && RN_PROFILE
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F12)
+          Profiler::writeChromeTrace("ranae_trace.json");
+#endif
       }
 
+      RN_ZONE("Acquire and present");
       if ((result = vkWaitForFences(device, 1, &wsi_fences[frame_id], VK_TRUE, ~0u)) != VK_SUCCESS) {
         std::cerr << "Failed to wait for WSI fences.\n";
         return false;
@@ -0,0 +1,263 @@
+#include <Ranae/Core/Allocator.h>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+using namespace ranae;
+
+void test_linear_arena() {
+  LinearArena arena{ 1024 };
+
+  // Alignment is respected and allocations don't overlap.
+  char* a = static_cast<char*>(arena.allocate(3, 1));
+  double* b = arena.allocate<double>(4);
+  rnAssert(reinterpret_cast<uintptr_t>(b) % alignof(double) == 0);
+  void* c = arena.allocate(16, 64);
+  rnAssert(reinterpret_cast<uintptr_t>(c) % 64 == 0);
+  rnAssert(a + 3 <= reinterpret_cast<char*>(b));
+  rnAssert(reinterpret_cast<char*>(b + 4) <= static_cast<char*>(c));
+  rnAssert(arena.used() == 3 + 4 * sizeof(double) + 16);
+
+  struct Pair { int x, y; };
+  const Pair* p = arena.create<Pair>(Pair{ 1, 2 });
+  rnAssert(p->x == 1 && p->y == 2);
+
+  // Spills into more blocks, and oversized requests get their own.
+  for (size_t i = 0; i < 100; i++)
+    arena.allocate(100);
+  arena.allocate(4096);
+  const size_t capacity = arena.capacity();
+  rnAssert(capacity >= 100 * 100 + 4096);
+
+  // Reset reuses the blocks without allocating more.
+  arena.reset();
+  rnAssert(arena.used() == 0);
+  for (size_t i = 0; i < 100; i++)
+    arena.allocate(100);
+  arena.allocate(4096);
+  rnAssert(arena.capacity() == capacity);
+
+  arena.release();
+  rnAssert(arena.capacity() == 0);
+}
+
+void test_frame_arena() {
+  FrameArena frame{ 4096 };
+
+  // Each thread gets its own arena, and a warmed up frame doesn't go to
+  // the heap.
+  auto run_frame = [&]() {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; t++) {
+      threads.emplace_back([&frame, t]() {
+        LinearArena& local = frame.local();
+        rnAssert(&local == &frame.local());
+        for (size_t i = 0; i < 1000; i++) {
+          uint32_t* values = frame.allocate<uint32_t>(16);
+          for (uint32_t j = 0; j < 16; j++)
+            values[j] = uint32_t(t);
+          rnAssert(values[15] == t);
+        }
+      });
+    }
+    for (std::thread& thread : threads)
+      thread.join();
+  };
+
+  run_frame();
+  rnAssert(frame.used() == 4 * 1000 * 16 * sizeof(uint32_t));
+  frame.reset();
+  rnAssert(frame.used() == 0);
+
+  // New threads may reuse a finished thread's id, and with it its arena,
+  // so only the total is known.
+  const AllocatorStats warm = frame.stats();
+  rnAssert(warm.allocations == 4000);
+  rnAssert(frame.threadCount() >= 1 && frame.threadCount() <= 4);
+  for (size_t i = 0; i < 3; i++) {
+    run_frame();
+    frame.reset();
+  }
+  rnAssert(frame.stats().allocations == 4 * 4000);
+
+  // The same thread keeps its arena across frames.
+  LinearArena& main = frame.local();
+  frame.allocate(100);
+  const size_t heap = frame.stats().heapAllocations;
+  for (size_t i = 0; i < 10; i++) {
+    frame.reset();
+    frame.allocate(100);
+    rnAssert(&frame.local() == &main);
+  }
+  rnAssert(frame.stats().heapAllocations == heap);
+
+  // Several frame arenas on the same thread don't mix.
+  FrameArena other;
+  rnAssert(&other.local() != &frame.local());
+  rnAssert(&frame.local() == &main);
+}
+
+void test_pool_allocator() {
+  struct Node {
+    Node*    next;
+    uint64_t value[3];
+  };
+
+  PoolAllocator pool{ sizeof(Node), alignof(Node), 64 };
+  rnAssert(pool.blockSize() >= sizeof(Node));
+
+  std::vector<Node*> nodes;
+  for (uint64_t i = 0; i < 1000; i++) {
+    Node* node = pool.create<Node>(Node{ nullptr, { i, i, i } });
+    rnAssert(reinterpret_cast<uintptr_t>(node) % alignof(Node) == 0);
+    nodes.push_back(node);
+  }
+  rnAssert(pool.live() == 1000);
+  rnAssert(pool.stats().heapAllocations == (1000 + 63) / 64);
+
+  for (uint64_t i = 0; i < nodes.size(); i++)
+    rnAssert(nodes[i]->value[0] == i && nodes[i]->value[2] == i);
+
+  // Freed blocks are reused before growing again.
+  const size_t capacity = pool.capacity();
+  for (size_t i = 0; i < nodes.size(); i += 2)
+    pool.destroy(nodes[i]);
+  rnAssert(pool.live() == 500);
+  for (size_t i = 0; i < nodes.size(); i += 2)
+    nodes[i] = pool.create<Node>();
+  rnAssert(pool.capacity() == capacity);
+  rnAssert(pool.stats().allocations == 1500 && pool.stats().deallocations == 500);
+
+  for (Node* node : nodes)
+    pool.destroy(node);
+  rnAssert(pool.live() == 0);
+  pool.release();
+  rnAssert(pool.capacity() == 0 && pool.stats().bytesReserved == 0);
+
+  // Over-aligned blocks.
+  PoolAllocator aligned{ 24, 64 };
+  rnAssert(aligned.blockSize() == 64);
+  for (size_t i = 0; i < 10; i++)
+    rnAssert(reinterpret_cast<uintptr_t>(aligned.allocate()) % 64 == 0);
+}
+
+void test_virtual_buffer() {
+  VirtualBuffer buffer{ 64 * 1024 * 1024 };
+  rnAssert(buffer.reserved() == 64 * 1024 * 1024);
+  rnAssert(buffer.capacity() == 0);
+
+  // Growing never moves the buffer.
+  std::byte* data = buffer.data();
+  uint32_t* first = buffer.allocate<uint32_t>(1);
+  *first = 42;
+  for (size_t i = 0; i < 100; i++) {
+    uint64_t* values = buffer.allocate<uint64_t>(10000);
+    rnAssert(reinterpret_cast<uintptr_t>(values) % alignof(uint64_t) == 0);
+    values[0] = i;
+    values[9999] = i;
+  }
+  rnAssert(buffer.data() == data && *first == 42);
+  rnAssert(buffer.size() >= 100 * 10000 * sizeof(uint64_t));
+  rnAssert(buffer.capacity() >= buffer.size());
+
+  // Pages stay committed across reset.
+  const size_t commits = buffer.stats().heapAllocations;
+  buffer.reset();
+  buffer.resize(1000000);
+  std::memset(buffer.data(), 0xff, buffer.size());
+  rnAssert(buffer.stats().heapAllocations == commits);
+
+  // Shrinking gives pages back, and they come back zeroed.
+  buffer.resize(10);
+  buffer.shrinkToFit();
+  rnAssert(buffer.capacity() < 1000000);
+  buffer.resize(1000000);
+  rnAssert(buffer.data()[999999] == std::byte{ 0 });
+  rnAssert(buffer.data()[5] == std::byte{ 0xff });
+
+  // Out of address space.
+  bool thrown = false;
+  try {
+    buffer.resize(buffer.reserved() + 1);
+  } catch (const std::bad_alloc&) {
+    thrown = true;
+  }
+  rnAssert(thrown);
+
+  VirtualBuffer moved{ std::move(buffer) };
+  rnAssert(moved.data() == data && moved.size() == 1000000);
+  rnAssert(buffer.data() == nullptr);
+}
+
+void test_pmr() {
+  LinearArena arena;
+  LinearArenaResource arenaResource{ arena };
+  {
+    std::pmr::vector<uint32_t> values{ &arenaResource };
+    for (uint32_t i = 0; i < 1000; i++)
+      values.push_back(i);
+    rnAssert(values[999] == 999);
+  }
+  rnAssert(arena.stats().allocations > 0 && arena.stats().allocations == arena.stats().deallocations);
+
+  // A warmed up frame of pmr containers stays off the heap.
+  FrameArena frame;
+  FrameArenaResource frameResource{ frame };
+  for (size_t f = 0; f < 4; f++) {
+    const size_t heap = frame.stats().heapAllocations;
+    {
+      std::pmr::vector<std::pmr::vector<float>> lists{ &frameResource };
+      for (size_t i = 0; i < 100; i++)
+        lists.emplace_back(i, float(i));
+      rnAssert(lists[99].size() == 99 && lists[99][0] == 99.0f);
+      rnAssert(lists[50].get_allocator().resource() == &frameResource);
+    }
+    if (f > 0)
+      rnAssert(frame.stats().heapAllocations == heap);
+    frame.reset();
+  }
+
+  // Pools serve what fits and pass the rest upstream.
+  PoolAllocator pool{ 32 };
+  PoolResource poolResource{ pool };
+  {
+    std::pmr::list<uint64_t> list{ &poolResource };
+    for (uint64_t i = 0; i < 500; i++)
+      list.push_back(i);
+    rnAssert(pool.live() == 500);
+
+    void* big = poolResource.allocate(1024);
+    rnAssert(pool.live() == 500);
+    poolResource.deallocate(big, 1024);
+  }
+  rnAssert(pool.live() == 0);
+
+  VirtualBuffer buffer{ 1 << 20 };
+  VirtualBufferResource bufferResource{ buffer };
+  std::pmr::vector<uint64_t> values{ &bufferResource };
+  values.resize(1000, 7);
+  rnAssert(reinterpret_cast<std::byte*>(values.data()) >= buffer.data());
+  rnAssert(reinterpret_cast<std::byte*>(values.data() + values.size()) <= buffer.data() + buffer.size());
+
+  rnAssert(poolResource.is_equal(poolResource));
+  rnAssert(!poolResource.is_equal(arenaResource));
+}
+
+void run_tests() {
+  test_linear_arena();
+  test_frame_arena();
+  test_pool_allocator();
+  test_virtual_buffer();
+  test_pmr();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
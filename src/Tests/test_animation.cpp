@@ -0,0 +1,274 @@
+#include <Ranae/Scene/Animation.h>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace ranae;
+
+bool near(float a, float b, float eps = 1e-5f) {
+  return std::abs(a - b) <= eps;
+}
+
+template <size_t Size>
+bool near(const Vector<float, Size>& a, const Vector<float, Size>& b, float eps = 1e-5f) {
+  for (size_t c = 0; c < Size; c++) {
+    if (!near(a[c], b[c], eps))
+      return false;
+  }
+  return true;
+}
+
+// Same rotation, either sign.
+bool same_rotation(const Quaternion<float>& a, const Quaternion<float>& b, float eps = 1e-5f) {
+  return near(std::abs(dot(a, b)), 1.0f, eps);
+}
+
+// Angle of the rotation taking a to b.
+float angle_between(const Quaternion<float>& a, const Quaternion<float>& b) {
+  return 2.0f * std::acos(std::min(1.0f, std::abs(dot(a, b))));
+}
+
+Quaternion<float> axis_angle(const Vector<float, 3>& axis, float angle) {
+  return Quaternion<float>{ normalize(axis) * std::sin(angle * 0.5f), std::cos(angle * 0.5f) };
+}
+
+void test_interpolation() {
+  const Quaternion<float> a = axis_angle(Vector<float, 3>{ 0.0f, 0.0f, 1.0f }, 0.0f);
+  const Quaternion<float> b = axis_angle(Vector<float, 3>{ 0.0f, 0.0f, 1.0f }, 2.0f);
+
+  // Test the ends are exact for all of them.
+  for (const float t : { 0.0f, 1.0f }) {
+    const Quaternion<float>& end = t == 0.0f ? a : b;
+    rnAssert(same_rotation(nlerp(a, b, t), end));
+    rnAssert(same_rotation(slerp(a, b, t), end));
+    rnAssert(same_rotation(slerpFast(a, b, t), end));
+  }
+
+  // Test slerp has constant angular speed, nlerp doesn't.
+  for (const float t : { 0.1f, 0.25f, 0.5f, 0.9f })
+    rnAssert(near(angle_between(a, slerp(a, b, t)), 2.0f * t, 1e-4f));
+  rnAssert(!near(angle_between(a, nlerp(a, b, 0.25f)), 0.5f, 1e-2f));
+
+  // Test the shortest path is taken when b is in the other hemisphere.
+  const Quaternion<float> negated{ -b };
+  for (const float t : { 0.25f, 0.5f, 0.75f }) {
+    rnAssert(same_rotation(slerp(a, negated, t), slerp(a, b, t)));
+    rnAssert(same_rotation(nlerp(a, negated, t), nlerp(a, b, t)));
+    rnAssert(same_rotation(slerpFast(a, negated, t), slerpFast(a, b, t)));
+  }
+
+  // Test nearly identical quaternions don't blow up.
+  const Quaternion<float> c = axis_angle(Vector<float, 3>{ 1.0f, 0.0f, 0.0f }, 1e-4f);
+  rnAssert(same_rotation(slerp(a, c, 0.5f), axis_angle(Vector<float, 3>{ 1.0f, 0.0f, 0.0f }, 0.5e-4f)));
+
+  // Test slerpFast stays close to slerp over random pairs.
+  std::mt19937 rng{ 42 };
+  std::normal_distribution<float> normal;
+  std::uniform_real_distribution<float> unit{ 0.0f, 1.0f };
+  float worst = 0.0f;
+  for (size_t i = 0; i < 10000; i++) {
+    const Quaternion<float> p{ normalize(Vector<float, 4>{ normal(rng), normal(rng), normal(rng), normal(rng) }) };
+    const Quaternion<float> q{ normalize(Vector<float, 4>{ normal(rng), normal(rng), normal(rng), normal(rng) }) };
+    const float t = unit(rng);
+    worst = std::max(worst, angle_between(slerpFast(p, q, t), slerp(p, q, t)));
+  }
+  rnAssert(worst < 2e-3f);
+}
+
+void test_interpolation_streams() {
+  constexpr size_t Count = 37;
+  std::vector<Vector<float, 4>> as(Count), bs(Count);
+  std::vector<float> ts(Count);
+  for (size_t i = 0; i < Count; i++) {
+    as[i] = axis_angle(Vector<float, 3>{ 1.0f, float(i % 3), 0.5f }, 0.1f * float(i));
+    bs[i] = axis_angle(Vector<float, 3>{ 0.0f, 1.0f, float(i % 5) }, -0.2f * float(i));
+    ts[i] = float(i) / float(Count - 1);
+  }
+  const VectorStream<float, 4> a{ std::span<const Vector<float, 4>>{ as } };
+  const VectorStream<float, 4> b{ std::span<const Vector<float, 4>>{ bs } };
+  const std::span<const float> t{ ts };
+  VectorStream<float, 4> out{ Count };
+
+  nlerp(a, b, t, out);
+  for (size_t i = 0; i < Count; i++)
+    rnAssert(near(out.get(i), nlerp(Quaternion<float>{ as[i] }, Quaternion<float>{ bs[i] }, ts[i])));
+
+  slerpFast(a, b, t, out);
+  for (size_t i = 0; i < Count; i++)
+    rnAssert(near(out.get(i), slerpFast(Quaternion<float>{ as[i] }, Quaternion<float>{ bs[i] }, ts[i])));
+
+  VectorStream<float, 3> positions{ Count }, ends{ Count };
+  for (size_t i = 0; i < Count; i++) {
+    positions.set(i, Vector<float, 3>{ float(i), 0.0f, -1.0f });
+    ends.set(i, Vector<float, 3>{ 0.0f, float(i), 1.0f });
+  }
+  lerp(positions, ends, t, positions);
+  for (size_t i = 0; i < Count; i++)
+    rnAssert(near(positions.get(i), Vector<float, 3>{ float(i) * (1.0f - ts[i]), float(i) * ts[i], 2.0f * ts[i] - 1.0f }));
+}
+
+// Track i animates joint i + 1 so the sampler has to scatter, joint 0 is
+// left alone.
+AnimationClip make_clip(size_t trackCount) {
+  AnimationClip clip;
+  for (size_t i = 0; i < trackCount; i++) {
+    AnimationTrack track;
+    track.target = uint32_t(i + 1);
+
+    const size_t keys = 2 + i % 7;
+    for (size_t k = 0; k < keys; k++) {
+      const float time = float(k) * (0.5f + 0.1f * float(i % 3));
+      track.position.times.push_back(time);
+      track.position.values.push_back(Vector<float, 3>{ float(k), float(i), -float(k) });
+      track.orientation.times.push_back(time);
+      track.orientation.values.push_back(axis_angle(Vector<float, 3>{ 0.0f, 1.0f, float(i % 2) }, 0.4f * float(k)));
+    }
+    // Scale only on every other track, the rest keep the pose's.
+    if (i % 2 == 0) {
+      track.scale.times  = { 0.0f, 1.0f };
+      track.scale.values = { Vector<float, 3>{ 1.0f }, Vector<float, 3>{ 3.0f } };
+    }
+    clip.tracks.push_back(std::move(track));
+  }
+  return clip;
+}
+
+// Straightforward evaluation of one channel, for checking the sampler.
+template <typename T, typename Interpolate>
+T reference_sample(const AnimationChannel<T>& channel, float time, Interpolate interpolate) {
+  if (time <= channel.times.front())
+    return channel.values.front();
+  if (time >= channel.times.back())
+    return channel.values.back();
+  size_t k = 0;
+  while (channel.times[k + 1] <= time)
+    k++;
+  const float alpha = (time - channel.times[k]) / (channel.times[k + 1] - channel.times[k]);
+  return interpolate(channel.values[k], channel.values[k + 1], alpha);
+}
+
+void check_pose(const AnimationClip& clip, float time, const TransformStream& pose, const Transform& rest) {
+  const TransformStreamView view = pose.view();
+  rnAssert(view.get(0).position == rest.position && view.get(0).scale == rest.scale);
+
+  for (const AnimationTrack& track : clip.tracks) {
+    const Transform t = view.get(track.target);
+    const auto lerpVector = [](const Vector<float, 3>& a, const Vector<float, 3>& b, float alpha) { return lerp(a, b, alpha); };
+    const auto slerpQuaternion = [](const Quaternion<float>& a, const Quaternion<float>& b, float alpha) { return slerpFast(a, b, alpha); };
+    rnAssert(near(t.position, reference_sample(track.position, time, lerpVector), 1e-4f));
+    rnAssert(same_rotation(t.orientation, reference_sample(track.orientation, time, slerpQuaternion), 1e-4f));
+    if (track.scale.empty())
+      rnAssert(t.scale == rest.scale);
+    else
+      rnAssert(near(t.scale, reference_sample(track.scale, time, lerpVector), 1e-4f));
+  }
+}
+
+void test_sampler() {
+  const AnimationClip clip = make_clip(40);
+  rnAssert(near(clip.duration(), 7.0f * 0.7f));
+
+  const Transform rest{ .position = Vector<float, 3>{ 7.0f, 8.0f, 9.0f }, .scale = Vector<float, 3>{ 2.0f } };
+  TransformStream pose{ clip.tracks.size() + 1 };
+  for (size_t i = 0; i < pose.size(); i++)
+    pose.view().set(i, rest);
+
+  // Test monotonic playback, including before the first and past the last key.
+  AnimationSampler sampler{ clip };
+  for (float time = -0.5f; time < clip.duration() + 0.5f; time += 1.0f / 60.0f) {
+    sampler.sample(time, pose.view());
+    check_pose(clip, time, pose, rest);
+  }
+
+  // Test seeking backwards, big jumps forwards and landing exactly on keys.
+  for (const float time : { 0.25f, 4.0f, 1.0f, 0.0f, 3.5f, 3.5f, 1.2f, 2.4f, 0.6f }) {
+    sampler.sample(time, pose.view());
+    check_pose(clip, time, pose, rest);
+  }
+
+  // Test a fresh sampler agrees with one that has been playing.
+  AnimationSampler fresh{ clip };
+  TransformStream other{ pose.size() };
+  for (size_t i = 0; i < other.size(); i++)
+    other.view().set(i, rest);
+  fresh.sample(0.6f, other.view());
+  for (size_t i = 0; i < pose.size(); i++) {
+    rnAssert(pose.view().get(i).position == other.view().get(i).position);
+    rnAssert(pose.view().get(i).orientation == other.view().get(i).orientation);
+  }
+
+  sampler.reset();
+  sampler.sample(2.0f, pose.view());
+  check_pose(clip, 2.0f, pose, rest);
+}
+
+void test_blend() {
+  constexpr size_t Count = 21;
+  TransformStream a{ Count }, b{ Count }, c{ Count }, out{ Count };
+  for (size_t i = 0; i < Count; i++) {
+    a.view().set(i, Transform{
+      .position    = Vector<float, 3>{ float(i), 0.0f, 0.0f },
+      .orientation = axis_angle(Vector<float, 3>{ 0.0f, 1.0f, 0.0f }, 0.0f),
+      .scale       = Vector<float, 3>{ 1.0f },
+    });
+    b.view().set(i, Transform{
+      .position    = Vector<float, 3>{ 0.0f, float(i), 0.0f },
+      .orientation = axis_angle(Vector<float, 3>{ 0.0f, 1.0f, 0.0f }, 1.0f),
+      .scale       = Vector<float, 3>{ 3.0f },
+    });
+    // Same rotation as b with the opposite sign.
+    c.view().set(i, Transform{
+      .position    = Vector<float, 3>{ 0.0f, float(i), 0.0f },
+      .orientation = Quaternion<float>{ -axis_angle(Vector<float, 3>{ 0.0f, 1.0f, 0.0f }, 1.0f) },
+      .scale       = Vector<float, 3>{ 3.0f },
+    });
+  }
+
+  // Test a single pose comes through untouched.
+  {
+    const TransformStreamView poses[] = { b.view() };
+    const float weights[] = { 2.0f };
+    blendPoses(poses, weights, out.view());
+    for (size_t i = 0; i < Count; i++) {
+      rnAssert(near(out.view().get(i).position, b.view().get(i).position));
+      rnAssert(same_rotation(out.view().get(i).orientation, b.view().get(i).orientation));
+    }
+  }
+
+  // Test weights are normalized and the orientation sign doesn't matter.
+  for (const TransformStream* other : { &b, &c }) {
+    const TransformStreamView poses[] = { a.view(), other->view() };
+    const float weights[] = { 3.0f, 1.0f };
+    blendPoses(poses, weights, out.view());
+    for (size_t i = 0; i < Count; i++) {
+      const Transform t = out.view().get(i);
+      rnAssert(near(t.position, Vector<float, 3>{ 0.75f * float(i), 0.25f * float(i), 0.0f }));
+      rnAssert(near(t.scale, Vector<float, 3>{ 1.5f }));
+      rnAssert(same_rotation(t.orientation, nlerp(a.view().get(i).orientation, b.view().get(i).orientation, 0.25f)));
+    }
+  }
+
+  // Test blending into one of the inputs.
+  {
+    const TransformStreamView poses[] = { a.view(), b.view() };
+    const float weights[] = { 1.0f, 1.0f };
+    blendPoses(poses, weights, a.view());
+    for (size_t i = 0; i < Count; i++)
+      rnAssert(near(a.view().get(i).position, Vector<float, 3>{ 0.5f * float(i), 0.5f * float(i), 0.0f }));
+  }
+}
+
+void run_tests() {
+  test_interpolation();
+  test_interpolation_streams();
+  test_sampler();
+  test_blend();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include <Ranae/Scene/Archetype.h>
+#include <Ranae/Math/Vector.h>
+#include <iostream>
+#include <string>
+
+using namespace ranae;
+
+struct PositionComponent {
+  static constexpr uint32_t ComponentIdx = 1;
+
+  Vector<float, 3> value;
+};
+
+struct VelocityComponent {
+  static constexpr uint32_t ComponentIdx = 2;
+
+  Vector<float, 3> value;
+};
+
+// Non-trivial, to check components are moved/destroyed properly.
+struct LabelComponent {
+  static constexpr uint32_t ComponentIdx = 3;
+
+  std::string value;
+};
+
+void test_archetype_storage() {
+  EntityManager entities;
+  ArchetypeStorage storage;
+  storage.registerComponent<NameComponent>();
+  storage.registerComponent<PositionComponent>();
+  storage.registerComponent<VelocityComponent>();
+  storage.registerComponent<LabelComponent>();
+
+  constexpr size_t Count = 3000;
+
+  std::vector<EntityId> ids;
+  for (size_t i = 0; i < Count; i++) {
+    const EntityId id = entities.createEntity();
+    ids.push_back(id);
+
+    storage.addComponent(id, PositionComponent{ Vector<float, 3>{ float(i), 0.0f, 0.0f } });
+    if (i % 2 == 0)
+      storage.addComponent(id, VelocityComponent{ Vector<float, 3>{ 1.0f, 2.0f, 3.0f } });
+    if (i % 3 == 0)
+      storage.addComponent(id, LabelComponent{ "entity with a label long enough to allocate " + std::to_string(i) });
+  }
+
+  // {P}, {P, V}, {P, L}, {P, V, L} plus the empty one and the transitions.
+  rnAssert(storage.getSignature(ids[0]) == componentSignature<PositionComponent, VelocityComponent, LabelComponent>());
+  rnAssert(storage.getSignature(ids[1]) == componentSignature<PositionComponent>());
+
+  // Join over position + velocity only sees the even entities.
+  size_t visited = 0;
+  storage.forEach<PositionComponent, VelocityComponent>([&](EntityId, PositionComponent& p, VelocityComponent& v) {
+    p.value += v.value;
+    visited++;
+  });
+  rnAssert(visited == (Count + 1) / 2);
+
+  size_t chunks = 0;
+  storage.forEachChunk<PositionComponent>([&](size_t count, const EntityId* entityIds, PositionComponent* positions) {
+    rnAssert(count > 0);
+    rnAssert(reinterpret_cast<uintptr_t>(positions) % alignof(PositionComponent) == 0);
+    for (size_t i = 0; i < count; i++)
+      rnAssert(&storage.getComponent<PositionComponent>(entityIds[i]) == &positions[i]);
+    chunks++;
+  });
+  rnAssert(chunks > 1);
+
+  for (size_t i = 0; i < Count; i++) {
+    const float x = float(i) + (i % 2 == 0 ? 1.0f : 0.0f);
+    rnAssert(storage.getComponent<PositionComponent>(ids[i]).value[0] == x);
+    if (i % 3 == 0)
+      rnAssert(storage.getComponent<LabelComponent>(ids[i]).value == "entity with a label long enough to allocate " + std::to_string(i));
+  }
+
+  // Moving between archetypes keeps the other components intact.
+  for (size_t i = 0; i < Count; i += 2)
+    storage.removeComponent<VelocityComponent>(ids[i]);
+  for (size_t i = 0; i < Count; i += 3) {
+    rnAssert(!storage.hasComponent<VelocityComponent>(ids[i]));
+    rnAssert(storage.getComponent<LabelComponent>(ids[i]).value == "entity with a label long enough to allocate " + std::to_string(i));
+  }
+
+  visited = 0;
+  storage.forEach<VelocityComponent>([&](EntityId, VelocityComponent&) { visited++; });
+  rnAssert(visited == 0);
+
+  // Destroying keeps the rest addressable.
+  for (size_t i = 0; i < Count; i += 5) {
+    storage.onEntityDestroyed(ids[i]);
+    entities.destroyEntity(ids[i]);
+    rnAssert(!storage.contains(ids[i]));
+  }
+  for (size_t i = 1; i < Count; i++) {
+    if (i % 5 != 0)
+      rnAssert(storage.getComponent<PositionComponent>(ids[i]).value[0] == float(i) + (i % 2 == 0 ? 1.0f : 0.0f));
+  }
+
+  const EntityId reused = entities.createEntity();
+  storage.addComponent(reused, NameComponent{ "reused" });
+  rnAssert(storage.contains(reused));
+  rnAssert(!storage.contains(ids[0]));
+}
+
+void run_tests() {
+  test_archetype_storage();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
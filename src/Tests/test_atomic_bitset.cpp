@@ -0,0 +1,135 @@
+#include <Ranae/Core/AtomicBitset.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace ranae;
+
+constexpr size_t ThreadCount = 8;
+
+template <typename Func>
+void run_threads(Func&& func) {
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < ThreadCount; t++)
+    threads.emplace_back(func, t);
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
+void test_atomic_bitset() {
+  AtomicBitset bits{ 130 };
+  rnAssert(bits.size() == 130 && bits.count() == 0);
+
+  rnAssert(!bits.testAndSet(5));
+  rnAssert(bits.testAndSet(5));
+  rnAssert(bits.test(5));
+  rnAssert(bits.testAndClear(5));
+  rnAssert(!bits.testAndClear(5));
+
+  // Claims go low to high from the hint, wrap around, and never hand out
+  // the padding past size().
+  rnAssert(bits.findFirstClearAndSet() == 0);
+  rnAssert(bits.findFirstClearAndSet() == 1);
+  rnAssert(bits.findFirstClearAndSet(128) == 128);
+  rnAssert(bits.findFirstClearAndSet(128) == 129);
+  rnAssert(bits.findFirstClearAndSet(128) == 2);
+  for (size_t i = 5; i < 130; i++)
+    bits.findFirstClearAndSet();
+  rnAssert(bits.count() == 130);
+  rnAssert(bits.findFirstClearAndSet() == AtomicBitset::InvalidIndex);
+
+  bits.clearAll();
+  rnAssert(bits.count() == 0);
+
+  // Bits below the hint in its own word only come after wrapping around.
+  AtomicBitset hinted{ 128 };
+  rnAssert(hinted.findFirstClearAndSet(10) == 10);
+  rnAssert(hinted.findFirstClearAndSet(10) == 11);
+  rnAssert(hinted.findFirstClearAndSet(70) == 70);
+  for (size_t i = 12; i < 128; i++) {
+    if (i != 70)
+      rnAssert(hinted.findFirstClearAndSet(10) == i);
+  }
+  rnAssert(hinted.findFirstClearAndSet(10) == 0);
+  for (size_t i = 1; i < 10; i++)
+    rnAssert(hinted.findFirstClearAndSet(64) == i);
+  rnAssert(hinted.findFirstClearAndSet(10) == AtomicBitset::InvalidIndex);
+}
+
+void test_concurrent_claims() {
+  constexpr size_t Count = 100000;
+  AtomicBitset slots{ Count };
+
+  // Everything is claimed exactly once, then the set is full.
+  std::vector<std::vector<size_t>> claimed(ThreadCount);
+  run_threads([&](size_t t) {
+    for (;;) {
+      const size_t slot = slots.findFirstClearAndSet(t * Count / ThreadCount);
+      if (slot == AtomicBitset::InvalidIndex)
+        break;
+      claimed[t].push_back(slot);
+    }
+  });
+
+  std::vector<uint8_t> seen(Count);
+  for (const auto& list : claimed) {
+    for (const size_t slot : list) {
+      rnAssert(slot < Count && !seen[slot]);
+      seen[slot] = 1;
+    }
+  }
+  rnAssert(slots.count() == Count);
+
+  // Release and reclaim under contention, with a small set so threads keep
+  // running into each other. A slot must never have two owners.
+  constexpr size_t Small = 200;
+  AtomicBitset pool{ Small };
+  std::vector<std::atomic<uint32_t>> owners(Small);
+  run_threads([&](size_t t) {
+    std::vector<size_t> held;
+    for (size_t i = 0; i < 20000; i++) {
+      if (held.size() < 40) {
+        const size_t slot = pool.findFirstClearAndSet(t * Small / ThreadCount);
+        if (slot != AtomicBitset::InvalidIndex) {
+          rnAssert(owners[slot].exchange(uint32_t(t + 1), std::memory_order_relaxed) == 0);
+          held.push_back(slot);
+        }
+      }
+      if (held.size() >= 40 || (i % 3 == 0 && !held.empty())) {
+        const size_t slot = held.back();
+        held.pop_back();
+        rnAssert(owners[slot].exchange(0, std::memory_order_relaxed) == t + 1);
+        rnAssert(pool.testAndClear(slot));
+      }
+    }
+    for (const size_t slot : held) {
+      owners[slot].store(0, std::memory_order_relaxed);
+      pool.testAndClear(slot);
+    }
+  });
+  rnAssert(pool.count() == 0);
+
+  // Racing on the same bits, exactly one thread wins each.
+  AtomicBitset race{ 1000 };
+  std::atomic<size_t> wins{ 0 };
+  run_threads([&](size_t) {
+    size_t won = 0;
+    for (size_t i = 0; i < race.size(); i++)
+      won += !race.testAndSet(i);
+    wins.fetch_add(won);
+  });
+  rnAssert(wins.load() == race.size());
+}
+
+void run_tests() {
+  test_atomic_bitset();
+  test_concurrent_claims();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
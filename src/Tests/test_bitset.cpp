@@ -0,0 +1,155 @@
+#include <Ranae/Core/Bitset.h>
+#include <iostream>
+#include <vector>
+
+using namespace ranae;
+
+static_assert(Bitset<128>::WordCount == 2);
+static_assert(Bitset<129>::WordCount == 3);
+static_assert((Bitset<100>::single(3) | Bitset<100>::single(70)).count() == 2);
+static_assert((~Bitset<100>{}).count() == 100);
+static_assert(Bitset<256>::single(200).findFirst() == 200);
+
+// Cheap deterministic bits to fill the sets with.
+static bool pattern(size_t seed, size_t idx) {
+  return ((idx * 2654435761u + seed * 40503u) >> 7) % 3 == 0;
+}
+
+template <size_t BitCount>
+void test_fixed() {
+  using Set = Bitset<BitCount>;
+
+  Set a, b;
+  std::vector<bool> ra(BitCount), rb(BitCount);
+  for (size_t i = 0; i < BitCount; i++) {
+    a.set(i, ra[i] = pattern(1, i));
+    b.set(i, rb[i] = pattern(2, i));
+  }
+
+  auto check = [](const Set& set, auto&& expected) {
+    size_t count = 0, first = Set::InvalidIndex;
+    for (size_t i = 0; i < BitCount; i++) {
+      rnAssert(set.get(i) == expected(i));
+      if (expected(i)) {
+        count++;
+        if (first == Set::InvalidIndex)
+          first = i;
+      }
+    }
+    rnAssert(set.count() == count);
+    rnAssert(set.findFirst() == first);
+    rnAssert(set.any() == (count != 0));
+
+    std::vector<uint32_t> visited;
+    set.forEachSet([&](uint32_t idx) { visited.push_back(idx); });
+    rnAssert(visited.size() == count);
+    for (size_t i = 0; i < visited.size(); i++) {
+      rnAssert(expected(visited[i]));
+      rnAssert(i == 0 || visited[i - 1] < visited[i]);
+      rnAssert(set.findNext(visited[i]) == visited[i]);
+      rnAssert(i == 0 || set.findNext(visited[i - 1] + 1) == visited[i]);
+    }
+  };
+
+  check(a & b, [&](size_t i) { return ra[i] && rb[i]; });
+  check(a | b, [&](size_t i) { return ra[i] || rb[i]; });
+  check(a ^ b, [&](size_t i) { return ra[i] != rb[i]; });
+  check(Set{ a }.andNot(b), [&](size_t i) { return ra[i] && !rb[i]; });
+  check(~a, [&](size_t i) { return !ra[i]; });
+
+  rnAssert(a.contains(a & b));
+  rnAssert((a & b).contains(a) == ((a & b) == a));
+  rnAssert(a.intersects(b) == (a & b).any());
+  rnAssert(!Set{ a }.andNot(b).intersects(b));
+  rnAssert((a | b).hash() == (b | a).hash());
+
+  Set all;
+  all.setAll();
+  rnAssert(all == ~Set{});
+  rnAssert(all.count() == BitCount);
+  all.clearAll();
+  rnAssert(all.none());
+  rnAssert(all.findFirst() == Set::InvalidIndex);
+
+  Set last = Set::single(BitCount - 1);
+  rnAssert(last.findFirst() == BitCount - 1);
+  rnAssert(last.findNext(BitCount - 1) == BitCount - 1);
+  rnAssert(last.exchange(BitCount - 1, false));
+  rnAssert(last.none());
+  last.flip(0);
+  rnAssert(last == Set::single(0));
+}
+
+void test_bitset() {
+  test_fixed<7>();
+  test_fixed<64>();
+  test_fixed<100>();
+  test_fixed<128>();
+  test_fixed<256>();
+  test_fixed<1000>();
+}
+
+void test_dynamic_bitset() {
+  // Big and sparse, like an entity mask.
+  constexpr size_t Count = 1000003;
+  DynamicBitset alive{ Count };
+  DynamicBitset dirty{ Count };
+  rnAssert(alive.size() == Count && alive.none());
+
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < Count; i += 997) {
+    alive.set(i, true);
+    if (i % 2 == 0) {
+      dirty.set(i, true);
+      expected.push_back(i);
+    }
+  }
+  dirty.set(Count - 1, true);
+
+  DynamicBitset both = alive;
+  both &= dirty;
+  rnAssert(both.count() == expected.size());
+  rnAssert(alive.contains(both) && !both.contains(dirty));
+  std::vector<uint32_t> visited;
+  both.forEachSet([&](uint32_t idx) { visited.push_back(idx); });
+  rnAssert(visited == expected);
+  rnAssert(both.findNext(1) == 1994);
+
+  DynamicBitset clean = alive;
+  clean.andNot(dirty);
+  rnAssert(clean.count() == alive.count() - expected.size());
+  rnAssert(!clean.intersects(dirty));
+  clean |= both;
+  rnAssert(clean == alive);
+  clean ^= alive;
+  rnAssert(clean.none());
+
+  const DynamicBitset dead = ~alive;
+  rnAssert(dead.count() == Count - alive.count());
+  rnAssert(dead.findFirst() == 1);
+
+  // Growing fills the new bits, shrinking drops the tail.
+  DynamicBitset grown{ 70, true };
+  rnAssert(grown.count() == 70);
+  grown.resize(200, true);
+  rnAssert(grown.count() == 200);
+  grown.resize(130);
+  rnAssert(grown.count() == 130);
+  grown.resize(300);
+  rnAssert(grown.count() == 130 && !grown[299]);
+  grown.setAll();
+  rnAssert(grown.count() == 300);
+}
+
+void run_tests() {
+  test_bitset();
+  test_dynamic_bitset();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
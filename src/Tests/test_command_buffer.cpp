@@ -0,0 +1,208 @@
+#include <Ranae/Scene/CommandBuffer.h>
+#include <Ranae/Math/Vector.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ranae;
+
+struct PositionComponent {
+  static constexpr uint32_t ComponentIdx = 1;
+
+  Vector<float, 3> value;
+};
+
+// Non-trivial, to check recorded values are moved and destroyed properly.
+struct LabelComponent {
+  static constexpr uint32_t ComponentIdx = 2;
+
+  std::string value;
+};
+
+void register_components(World& world) {
+  world.registerComponent<NameComponent>();
+  world.registerComponent<PositionComponent>();
+  world.registerComponent<LabelComponent>();
+}
+
+void test_command_buffer() {
+  World world;
+  register_components(world);
+
+  const EntityId a = world.createEntity();
+  const EntityId b = world.createEntity();
+  world.addComponent(a, PositionComponent{});
+  world.addComponent(b, LabelComponent{ "b" });
+
+  auto labelled = world.query<LabelComponent>();
+  rnAssert(labelled.size() == 1);
+
+  CommandBuffer commands;
+  const PendingEntity c = commands.createEntity();
+  commands.addComponent(c, PositionComponent{ Vector<float, 3>{ 1.0f, 2.0f, 3.0f } });
+  commands.addComponent(c, LabelComponent{ std::string(100, 'c') });
+  commands.addComponent(a, LabelComponent{ "first" });
+  commands.addComponent(a, LabelComponent{ "second" });
+  commands.removeComponent<PositionComponent>(a);
+  // Last command wins: removed then added back.
+  commands.removeComponent<LabelComponent>(b);
+  commands.addComponent(b, LabelComponent{ "b again" });
+  // Everything for a destroyed entity is dropped.
+  const PendingEntity d = commands.createEntity();
+  commands.addComponent(d, NameComponent{ "d" });
+  rnAssert(!commands.empty());
+
+  // Nothing happens until playback.
+  rnAssert(world.hasComponent<PositionComponent>(a));
+  rnAssert(!world.hasComponent<LabelComponent>(a));
+
+  commands.playback(world);
+  rnAssert(commands.empty());
+
+  const EntityId cId = commands.resolve(c);
+  const EntityId dId = commands.resolve(d);
+  rnAssert(world.alive(cId));
+  rnAssert(world.getComponent<PositionComponent>(cId).value == (Vector<float, 3>{ 1.0f, 2.0f, 3.0f }));
+  rnAssert(world.getComponent<LabelComponent>(cId).value == std::string(100, 'c'));
+  rnAssert(world.getComponent<LabelComponent>(a).value == "second");
+  rnAssert(!world.hasComponent<PositionComponent>(a));
+  rnAssert(world.getComponent<LabelComponent>(b).value == "b again");
+  rnAssert(world.getComponent<NameComponent>(dId).name == std::string{ "d" });
+
+  // Queries see the changes.
+  rnAssert(labelled.size() == 3);
+  rnAssert(labelled.contains(a) && labelled.contains(b) && labelled.contains(cId));
+
+  commands.destroyEntity(dId);
+  commands.destroyEntity(dId);
+  commands.addComponent(dId, PositionComponent{});
+  commands.removeComponent<LabelComponent>(cId);
+  commands.playback(world);
+  rnAssert(!world.alive(dId));
+  rnAssert(!world.hasComponent<LabelComponent>(cId));
+  rnAssert(world.query<NameComponent>().empty());
+
+  // Stale handles are ignored.
+  commands.addComponent(dId, PositionComponent{});
+  commands.destroyEntity(dId);
+  commands.playback(world);
+
+  // Clearing drops the recorded commands.
+  commands.addComponent(a, LabelComponent{ "dropped" });
+  commands.createEntity();
+  commands.clear();
+  commands.playback(world);
+  rnAssert(commands.created().empty());
+  rnAssert(world.getComponent<LabelComponent>(a).value == "second");
+}
+
+void test_parallel_recording() {
+  World world;
+  register_components(world);
+
+  std::vector<EntityId> ids;
+  for (size_t i = 0; i < 1000; i++) {
+    ids.push_back(world.createEntity());
+    world.addComponent(ids.back(), PositionComponent{ Vector<float, 3>{ float(i), 0.0f, 0.0f } });
+  }
+
+  JobSystem      jobs{ 3 };
+  CommandBuffers commands{ jobs };
+  rnAssert(commands.size() == jobs.threadCount());
+
+  // Spawn a labelled child for every even entity, despawn the odd ones.
+  for (size_t frame = 0; frame < 2; frame++) {
+    jobs(ids.size(), 50, [&](size_t begin, size_t end) {
+      CommandBuffer& local = commands.local(jobs);
+      for (size_t i = begin; i < end; i++) {
+        if (!world.alive(ids[i]))
+          continue;
+        if (i % 2 == 0) {
+          const PendingEntity child = local.createEntity();
+          local.addComponent(child, LabelComponent{ std::to_string(i) });
+        } else {
+          local.destroyEntity(ids[i]);
+        }
+      }
+    });
+    commands.playback(world);
+  }
+
+  // Once played back, buffer 0 can be handed to another non-worker thread.
+  std::thread{ [&] {
+    commands.local(jobs).addComponent(ids[0], LabelComponent{ "external" });
+  } }.join();
+  commands.playback(world);
+  rnAssert(world.getComponent<LabelComponent>(ids[0]).value == "external");
+  commands.local(jobs).removeComponent<LabelComponent>(ids[0]);
+  commands.playback(world);
+
+  rnAssert(world.query<LabelComponent>().size() == 1000);
+  rnAssert(world.query<PositionComponent>().size() == 500);
+  world.query<PositionComponent>().forEach([&](EntityId, PositionComponent& position) {
+    rnAssert(int(position.value[0]) % 2 == 0);
+  });
+  rnAssert(world.entities().aliveCount() == 1500);
+}
+
+// Counts live instances, to check recorded values are destroyed when a
+// buffer goes away without being played back.
+struct CountedComponent {
+  static constexpr uint32_t ComponentIdx = 3;
+
+  static inline int live = 0;
+
+  CountedComponent() { live++; }
+  CountedComponent(const CountedComponent&) { live++; }
+  CountedComponent(CountedComponent&&) { live++; }
+  CountedComponent& operator=(const CountedComponent&) = default;
+  CountedComponent& operator=(CountedComponent&&) = default;
+  ~CountedComponent() { live--; }
+};
+
+void test_discarded_buffer() {
+  {
+    CommandBuffer commands;
+    commands.addComponent(EntityId{ 0 }, CountedComponent{});
+    commands.addComponent(commands.createEntity(), CountedComponent{});
+    commands.addComponent(EntityId{ 1 }, LabelComponent{ std::string(200, 'x') });
+    rnAssert(CountedComponent::live == 2);
+  }
+  rnAssert(CountedComponent::live == 0);
+
+  // Test moves hand the values over exactly once.
+  {
+    CommandBuffer a;
+    a.addComponent(EntityId{ 0 }, CountedComponent{});
+    CommandBuffer b{ std::move(a) };
+    rnAssert(a.empty() && !b.empty());
+    rnAssert(CountedComponent::live == 1);
+
+    CommandBuffer c;
+    c.addComponent(EntityId{ 1 }, CountedComponent{});
+    c = std::move(b);
+    rnAssert(CountedComponent::live == 1);
+  }
+  rnAssert(CountedComponent::live == 0);
+
+  {
+    CommandBuffers commands{ 2 };
+    commands[1].addComponent(EntityId{ 0 }, CountedComponent{});
+  }
+  rnAssert(CountedComponent::live == 0);
+}
+
+void run_tests() {
+  test_command_buffer();
+  test_parallel_recording();
+  test_discarded_buffer();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include <Ranae/Scene/Entity.h>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+using namespace ranae;
+
+void test_component_array() {
+  ComponentArray<NameComponent> names;
+
+  const char* labels[] = { "a", "b", "c", "d" };
+  const EntityId ids[] = { 5, 900, 3, 17 };
+  for (size_t i = 0; i < 4; i++)
+    names.insertData(ids[i], NameComponent{ labels[i] });
+
+  rnAssert(names.size() == 4);
+  for (size_t i = 0; i < 4; i++) {
+    rnAssert(names.contains(ids[i]));
+    rnAssert(names.getData(ids[i])->name == labels[i]);
+  }
+  rnAssert(!names.contains(4));
+  rnAssert(!names.contains(MaxEntities - 1));
+
+  // Removal keeps the dense arrays packed and in sync.
+  names.removeData(900);
+  rnAssert(names.size() == 3);
+  rnAssert(!names.contains(900));
+  for (size_t i = 0; i < names.size(); i++)
+    rnAssert(names.getData(names.entities()[i]) == &names.data()[i]);
+  rnAssert(names.getData(17)->name == labels[3]);
+
+  names.onEntityDestroyed(900);
+  names.onEntityDestroyed(17);
+  rnAssert(names.size() == 2);
+  rnAssert(names.getData(5)->name == labels[0]);
+  rnAssert(names.getData(3)->name == labels[2]);
+
+  names.insertData(900, NameComponent{ "e" });
+  rnAssert(names.getData(900)->name == std::string_view{ "e" });
+}
+
+void test_component_manager() {
+  EntityManager entities;
+  ComponentManager components;
+  components.registerComponent<NameComponent>();
+
+  const EntityId a = entities.createEntity();
+  const EntityId b = entities.createEntity();
+  components.addComponent(a, NameComponent{ "a" });
+  components.addComponent(b, NameComponent{ "b" });
+  entities.setSignature(a, componentSignature<NameComponent>());
+  entities.setSignature(b, componentSignature<NameComponent>());
+
+  rnAssert(components.getComponent<NameComponent>(b).name == std::string_view{ "b" });
+
+  components.onEntityDestroyed(a, entities.getSignature(a));
+  entities.destroyEntity(a);
+  rnAssert(!components.getComponentArray<NameComponent>().contains(a));
+
+  components.onEntityDestroyed(b);
+  entities.destroyEntity(b);
+  rnAssert(components.getComponentArray<NameComponent>().size() == 0);
+}
+
+void test_entity_manager() {
+  EntityManager entities;
+
+  // Grows past what used to be a fixed 1024 without reserving up front.
+  std::vector<EntityId> ids;
+  for (size_t i = 0; i < 100000; i++)
+    ids.push_back(entities.createEntity());
+  rnAssert(entities.aliveCount() == ids.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    rnAssert(entityIndex(ids[i]) == i);
+    rnAssert(entities.alive(ids[i]));
+  }
+
+  // Stale handles are detected once the slot has been reused.
+  const EntityId stale = ids[42];
+  entities.setSignature(stale, componentSignature<NameComponent>());
+  entities.destroyEntity(stale);
+  rnAssert(!entities.alive(stale));
+
+  // Freed slots are reused oldest first.
+  entities.destroyEntity(ids[7]);
+  const EntityId reused = entities.createEntity();
+  rnAssert(entityIndex(reused) == entityIndex(stale));
+  rnAssert(entityGeneration(reused) == entityGeneration(stale) + 1);
+  rnAssert(reused != stale);
+  rnAssert(entities.alive(reused));
+  rnAssert(!entities.alive(stale));
+  rnAssert(entities.getSignature(reused).none());
+  rnAssert(entityIndex(entities.createEntity()) == 7);
+
+  // Component arrays do not mistake a stale handle for the new owner.
+  ComponentArray<NameComponent> names;
+  names.insertData(reused, NameComponent{ "new" });
+  rnAssert(names.contains(reused));
+  rnAssert(!names.contains(stale));
+
+  rnAssert(!entities.alive(InvalidEntity));
+}
+
+void test_bulk_create() {
+  EntityManager entities;
+
+  std::vector<EntityId> first(10);
+  entities.createEntities(first);
+  for (size_t i = 0; i < first.size(); i++)
+    rnAssert(first[i] == makeEntityId(uint32_t(i), 0));
+
+  entities.destroyEntity(first[3]);
+  entities.destroyEntity(first[8]);
+
+  // Free slots first, oldest first, then fresh slots across chunk ends.
+  std::vector<EntityId> second(2 * EntityManager::SlotChunkSize);
+  entities.createEntities(second);
+  rnAssert(second[0] == makeEntityId(3, 1));
+  rnAssert(second[1] == makeEntityId(8, 1));
+  for (size_t i = 2; i < second.size(); i++)
+    rnAssert(second[i] == makeEntityId(uint32_t(first.size() + i - 2), 0));
+  for (const EntityId id : second)
+    rnAssert(entities.alive(id) && entities.getSignature(id).none());
+  rnAssert(entities.aliveCount() == first.size() + second.size() - 2);
+
+  // Single creation carries on after the bulk range.
+  rnAssert(entityIndex(entities.createEntity()) == first.size() + second.size() - 2);
+
+  ComponentArray<NameComponent> names;
+  names.insertData(std::span<const EntityId>{ second }.subspan(0, 100), NameComponent{ "bulk" });
+  rnAssert(names.size() == 100);
+  rnAssert(names.added().size() == 100);
+  for (size_t i = 0; i < 100; i++) {
+    rnAssert(names.entities()[i] == second[i]);
+    rnAssert(names.getData(second[i])->name == std::string_view{ "bulk" });
+  }
+}
+
+void run_tests() {
+  test_entity_manager();
+  test_component_array();
+  test_component_manager();
+  test_bulk_create();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include <Ranae/Core/StringInterner.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace ranae;
+
+// Keys worked out at compile time match the runtime hash.
+constexpr uint64_t PositionKey = "Position"_hash64;
+static_assert(PositionKey == hash64(std::string_view{ "Position" }));
+static_assert(""_hash64 != "a"_hash64);
+static_assert(hash64("abc", 3, 1) != hash64("abc", 3, 2));
+
+void test_hash64() {
+  rnAssert(hash64(std::string{ "Position" }) == PositionKey);
+
+  // Every length class (empty, 1-3, 4-16, 17-48, longer) agrees with the
+  // constant evaluated path, and from any alignment.
+  std::string text;
+  for (size_t i = 0; i < 300; i++)
+    text.push_back(char('a' + (i * 7) % 26));
+
+  constexpr auto compileTime = [] {
+    std::array<uint64_t, 120> hashes{};
+    char buffer[120] = {};
+    for (size_t i = 0; i < 120; i++)
+      buffer[i] = char('a' + (i * 7) % 26);
+    for (size_t count = 0; count < hashes.size(); count++)
+      hashes[count] = hash64(buffer, count);
+    return hashes;
+  }();
+  for (size_t count = 0; count < compileTime.size(); count++)
+    rnAssert(hash64(text.data(), count) == compileTime[count]);
+
+  std::string shifted = "x" + text;
+  rnAssert(hash64(shifted.data() + 1, 200) == hash64(text.data(), 200));
+
+  // No collisions over a lot of similar short names, and a single
+  // changed byte changes the hash wherever it is.
+  std::unordered_set<uint64_t> hashes;
+  for (size_t i = 0; i < 100000; i++)
+    rnAssert(hashes.insert(hash64("entity_" + std::to_string(i))).second);
+
+  const uint64_t base = hash64(text);
+  for (size_t i = 0; i < text.size(); i += 13) {
+    std::string changed = text;
+    changed[i] ^= 1;
+    rnAssert(hash64(changed) != base);
+  }
+}
+
+void test_interner() {
+  StringInterner names;
+  rnAssert(names.find("player") == InvalidNameId);
+
+  const NameId player = names.intern("player");
+  const NameId camera = names.intern("camera");
+  const NameId empty  = names.intern("");
+  rnAssert(player != InvalidNameId && camera != player && empty != camera);
+  rnAssert(names.intern(std::string{ "player" }) == player);
+  rnAssert(names.find("camera") == camera);
+  rnAssert(names.name(player) == "player");
+  rnAssert(names.name(player).data()[6] == '\0');
+  rnAssert(names.name(empty).empty());
+  rnAssert(names.hash(camera) == "camera"_hash64);
+
+  // Grows past a few rehashes with the views staying valid.
+  const std::string_view first = names.name(player);
+  for (size_t i = 0; i < 5000; i++)
+    rnAssert(names.intern("name_" + std::to_string(i)) == NameId(i + 4));
+  rnAssert(names.size() == 5003);
+  rnAssert(first.data() == names.name(player).data());
+  for (size_t i = 0; i < 5000; i += 7)
+    rnAssert(names.find("name_" + std::to_string(i)) == NameId(i + 4));
+}
+
+void test_concurrent_interning() {
+  StringInterner names;
+  constexpr size_t ThreadCount = 6;
+  constexpr size_t Count       = 4096;
+
+  // Every thread interns the same names in a different order, and all
+  // of them must end up with the same ids.
+  std::vector<std::vector<NameId>> ids(ThreadCount, std::vector<NameId>(Count));
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < ThreadCount; t++) {
+    threads.emplace_back([&, t] {
+      for (size_t k = 0; k < Count; k++) {
+        const size_t i = (k * (2 * t + 1) + t * 977) % Count;
+        ids[t][i] = names.intern("shared_" + std::to_string(i));
+        rnAssert(names.name(ids[t][i]) == "shared_" + std::to_string(i));
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  rnAssert(names.size() == Count);
+  for (size_t t = 1; t < ThreadCount; t++)
+    rnAssert(ids[t] == ids[0]);
+}
+
+void run_tests() {
+  test_hash64();
+  test_interner();
+  test_concurrent_interning();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include <Ranae/Scene/Hierarchy.h>
+#include <iostream>
+
+using namespace ranae;
+
+bool near(const Vector<float, 3>& a, const Vector<float, 3>& b) {
+  for (size_t i = 0; i < 3; i++) {
+    if (std::abs(a[i] - b[i]) > 1e-4f)
+      return false;
+  }
+  return true;
+}
+
+Transform offset(float x, float y, float z) {
+  return Transform{ .position = Vector<float, 3>{ x, y, z } };
+}
+
+// Recomputes a world transform the slow way by walking up the parents.
+Transform reference_world(const TransformHierarchy& h, EntityId entity) {
+  Transform world = h.local(entity);
+  for (EntityId p = h.parent(entity); p != InvalidEntity; p = h.parent(p))
+    world = h.local(p) * world;
+  return world;
+}
+
+void check_all(const TransformHierarchy& h, EntityId count) {
+  for (EntityId e = 0; e < count; e++) {
+    if (h.contains(e))
+      rnAssert(near(h.world(e).position, reference_world(h, e).position));
+  }
+}
+
+// Hands chunks out in reverse, to catch anything relying on chunk order.
+struct ReverseExecutor {
+  template <typename Func>
+  void operator()(size_t count, size_t grain, Func&& func) const {
+    for (size_t begin = (count - 1) / grain * grain; ; begin -= grain) {
+      func(begin, std::min(count, begin + grain));
+      if (begin == 0)
+        break;
+    }
+  }
+};
+
+void test_basic() {
+  TransformHierarchy h;
+
+  // 0 -> 1 -> 2, 3 root. Added child first to check the sort.
+  h.addNode(0, InvalidEntity, offset(1, 0, 0));
+  h.addNode(1, 0, offset(0, 1, 0));
+  h.addNode(3, InvalidEntity, offset(0, 0, 5));
+  h.addNode(2, 1, offset(0, 0, 1));
+  h.propagate();
+
+  rnAssert(h.levelCount() == 3);
+  rnAssert(h.lastUpdateCount() == 4);
+  rnAssert(near(h.world(2).position, Vector<float, 3>{ 1.0f, 1.0f, 1.0f }));
+  rnAssert(near(h.world(3).position, Vector<float, 3>{ 0.0f, 0.0f, 5.0f }));
+
+  // Nothing changed, nothing to do.
+  h.propagate();
+  rnAssert(h.lastUpdateCount() == 0);
+
+  // Moving the middle node only touches its subtree.
+  h.setLocal(1, offset(0, 2, 0));
+  h.propagate();
+  rnAssert(h.lastUpdateCount() == 2);
+  rnAssert(near(h.world(2).position, Vector<float, 3>{ 1.0f, 2.0f, 1.0f }));
+
+  // Reparent under 3.
+  h.setParent(1, 3);
+  h.propagate();
+  rnAssert(h.parent(1) == 3);
+  rnAssert(near(h.world(2).position, Vector<float, 3>{ 0.0f, 2.0f, 6.0f }));
+
+  // Removing 1 orphans 2.
+  h.onEntityDestroyed(1);
+  h.propagate();
+  rnAssert(!h.contains(1));
+  rnAssert(h.parent(2) == InvalidEntity);
+  rnAssert(near(h.world(2).position, Vector<float, 3>{ 0.0f, 0.0f, 1.0f }));
+}
+
+void test_large() {
+  constexpr EntityId Count = 5000;
+
+  TransformHierarchy h;
+  for (EntityId e = 0; e < Count; e++) {
+    const EntityId parent = e == 0 ? InvalidEntity : (e * 7919u) % e;
+    Transform local = offset(float(e % 3), 1.0f, float(e % 5) * 0.5f);
+    local.orientation = Quaternion<float>{ normalize(Vector<float, 4>{ 0.1f * float(e % 4), 0.0f, 0.2f, 1.0f }) };
+    h.addNode(e, parent, local);
+  }
+  h.propagate(ReverseExecutor{}, 64);
+  rnAssert(h.lastUpdateCount() == Count);
+  check_all(h, Count);
+
+  // Touch a few percent.
+  for (EntityId e = Count - 1; e > Count - 100; e--)
+    h.setLocal(e, offset(2.0f, 0.0f, 0.0f));
+  h.propagate(ReverseExecutor{}, 64);
+  rnAssert(h.lastUpdateCount() < Count / 10);
+  check_all(h, Count);
+
+  h.setLocal(0, offset(-3.0f, 1.0f, 0.0f));
+  h.propagate(ReverseExecutor{}, 64);
+  rnAssert(h.lastUpdateCount() == Count);
+  check_all(h, Count);
+}
+
+void test_removal() {
+  constexpr EntityId Count = 2000;
+
+  TransformHierarchy h;
+  for (EntityId e = 0; e < Count; e++)
+    h.addNode(e, e < 10 ? InvalidEntity : e / 2, offset(1.0f, float(e % 7), 0.0f));
+  h.propagate();
+
+  // Orphans read as roots right away, before the removed nodes are
+  // compacted away by the next propagate().
+  for (EntityId e = 20; e < Count; e += 3)
+    h.removeNode(e);
+  rnAssert(h.size() == Count - (Count - 20 + 2) / 3);
+  rnAssert(!h.contains(20) && h.contains(21));
+  rnAssert(h.parent(40) == InvalidEntity);
+  rnAssert(h.parent(42) == 21);
+
+  // 40 used to be below 10 (through 20), hanging 10 under it is no cycle.
+  h.setParent(10, 40);
+
+  // A removed entity can come back before the rebuild.
+  h.addNode(23, 5, offset(0.0f, 0.0f, 1.0f));
+  h.propagate();
+  rnAssert(h.contains(23) && h.parent(23) == 5);
+  rnAssert(h.parent(10) == 40 && h.parent(40) == InvalidEntity && h.parent(82) == InvalidEntity);
+  check_all(h, Count);
+
+  h.setLocal(5, offset(0.0f, 3.0f, 0.0f));
+  h.propagate();
+  check_all(h, Count);
+}
+
+void run_tests() {
+  test_basic();
+  test_large();
+  test_removal();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -1,5 +1,6 @@
 #include <Ranae/Math/Matrix.h>
 #include <iostream>
+#include <vector>
 
 using namespace ranae;
 
@@ -59,11 +60,162 @@ void test_generic_type() {
   rnAssert(determinant(scale) == T{ 16 });
   rnAssert(determinant(c) == T{ 0 });
 
+  // Test products
+  {
+    const Matrix<T, 2, 2> f = Matrix<T, 2, 2>{
+      Vector<T, 2>{ T{ 1 }, T{ 2 }, },
+      Vector<T, 2>{ T{ 3 }, T{ 4 }, },
+    };
+    const Matrix<T, 2, 2> g = Matrix<T, 2, 2>{
+      Vector<T, 2>{ T{ 5 }, T{ 6 }, },
+      Vector<T, 2>{ T{ 7 }, T{ 8 }, },
+    };
+    const Matrix<T, 2, 2> fg = Matrix<T, 2, 2>{
+      Vector<T, 2>{ T{ 23 }, T{ 34 }, },
+      Vector<T, 2>{ T{ 31 }, T{ 46 }, },
+    };
+    rnAssert(f * g == fg);
+    rnAssert(f * Vector<T, 2>{ T{ 1 }, T{ 1 } } == Vector<T, 2>{ T{ 4 }, T{ 6 } });
+
+    Matrix<T, 2, 2> h = f;
+    h *= g;
+    rnAssert(h == fg);
+
+    // 2 vectors of 3 times 4 vectors of 2 -> 4 vectors of 3.
+    const Matrix<T, 2, 3> n{};
+    const Matrix<T, 4, 2> o{ T{ 2 } };
+    const Matrix<T, 4, 3> no = n * o;
+    rnAssert(no[0] == (Vector<T, 3>{ T{ 2 }, T{ 0 }, T{ 0 } }));
+    rnAssert(no[1] == (Vector<T, 3>{ T{ 0 }, T{ 2 }, T{ 0 } }));
+    rnAssert(no[2] == Vector<T, 3>{});
+    rnAssert(no[3] == Vector<T, 3>{});
+  }
+  rnAssert(identity * c == c);
+  rnAssert(c * identity == c);
+  rnAssert(scale * identity == scale);
+  rnAssert(c * Vector<T, 4>{ T{ 0 }, T{ 1 }, T{ 0 }, T{ 0 } } == c[1]);
+
   // Test printing
   std::cout << identity << std::endl;
   std::cout << e << std::endl;
 }
 
+template <typename T, size_t N, size_t M, size_t K>
+Matrix<T, K, M> reference_product(const Matrix<T, N, M>& a, const Matrix<T, K, N>& b) {
+  Matrix<T, K, M> result{ T{ 0 } };
+  for (size_t j = 0; j < K; j++) {
+    for (size_t i = 0; i < M; i++) {
+      for (size_t k = 0; k < N; k++)
+        result[j][i] += a[k][i] * b[j][k];
+    }
+  }
+  return result;
+}
+
+template <typename T, size_t N, size_t M, size_t K>
+void test_product() {
+  Matrix<T, N, M> a;
+  Matrix<T, K, N> b;
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = 0; j < M; j++)
+      a[i][j] = T((i * 3 + j * 5) % 7) - T{ 3 };
+  }
+  for (size_t i = 0; i < K; i++) {
+    for (size_t j = 0; j < N; j++)
+      b[i][j] = T((i * 2 + j * 7) % 5) - T{ 2 };
+  }
+  rnAssert(a * b == reference_product(a, b));
+}
+
+// Plain cofactor expansion, to check the closed forms against.
+template <typename T, size_t N>
+T reference_determinant(const Matrix<T, N, N>& a) {
+  if constexpr (N == 1) {
+    return a[0][0];
+  } else {
+    T result = T{};
+    for (size_t x = 0; x < N; x++) {
+      const T sign = (x % 2) ? T{ -1 } : T{ 1 };
+      result += sign * a[0][x] * reference_determinant(minor(a, x, 0));
+    }
+    return result;
+  }
+}
+
+template <typename T, size_t N>
+Matrix<T, N, N> test_pattern(size_t seed) {
+  // Diagonally dominant so it is never singular.
+  Matrix<T, N, N> m;
+  for (size_t y = 0; y < N; y++) {
+    for (size_t x = 0; x < N; x++)
+      m[y][x] = y == x ? T(N * 3) : T((y * 7 + x * 3 + seed) % 5) - T{ 2 };
+  }
+  return m;
+}
+
+template <typename T, size_t N>
+void test_determinant() {
+  for (size_t seed = 0; seed < 4; seed++) {
+    const Matrix<T, N, N> m = test_pattern<T, N>(seed);
+    rnAssert(determinant(m) == reference_determinant(m));
+  }
+}
+
+template <typename T, size_t N>
+bool near_identity(const Matrix<T, N, N>& m, T eps) {
+  for (size_t y = 0; y < N; y++) {
+    for (size_t x = 0; x < N; x++) {
+      if (std::abs(m[y][x] - (y == x ? T{ 1 } : T{ 0 })) > eps)
+        return false;
+    }
+  }
+  return true;
+}
+
+template <typename T, size_t N>
+void test_inverse() {
+  const T eps = T{ 1e-5 };
+  for (size_t seed = 0; seed < 4; seed++) {
+    const Matrix<T, N, N> m = test_pattern<T, N>(seed);
+    const Matrix<T, N, N> inv = inverse(m);
+    rnAssert(near_identity(m * inv, eps));
+    rnAssert(near_identity(inv * m, eps));
+    rnAssert(std::abs(determinant(m) - reference_determinant(m)) <= eps * std::abs(reference_determinant(m)));
+  }
+}
+
+template <typename T>
+void test_inverse_affine() {
+  Matrix<T, 4, 4> m = test_pattern<T, 4>(1);
+  for (size_t y = 0; y < 3; y++)
+    m[y][3] = T{ 0 };
+  m[3] = Vector<T, 4>{ T{ 3 }, T{ -2 }, T{ 5 }, T{ 1 } };
+
+  const Matrix<T, 4, 4> inv = inverseAffine(m);
+  rnAssert(near_identity(m * inv, T{ 1e-5 }));
+
+  const Matrix<T, 4, 4> general = inverse(m);
+  for (size_t y = 0; y < 4; y++) {
+    for (size_t x = 0; x < 4; x++)
+      rnAssert(std::abs(general[y][x] - inv[y][x]) <= T{ 1e-5 });
+  }
+}
+
+void test_batched_inverse() {
+  std::vector<Matrix4> in, out(37);
+  for (size_t i = 0; i < out.size(); i++)
+    in.push_back(test_pattern<float, 4>(i));
+
+  inverse(std::span<const Matrix4>{ in }, std::span<Matrix4>{ out });
+  for (size_t i = 0; i < in.size(); i++) {
+    const Matrix4 expected = inverse(in[i]);
+    for (size_t y = 0; y < 4; y++) {
+      for (size_t x = 0; x < 4; x++)
+        rnAssert(std::abs(out[i][y][x] - expected[y][x]) <= 1e-6f);
+    }
+  }
+}
+
 template <typename T> 
 void test_integer_type() {
   test_generic_type<T>();
@@ -77,6 +229,41 @@ void test_integer_type() {
 template <typename T>
 void test_float_type() {
   test_generic_type<T>();
+
+  // Small ints keep all of these exact, so SIMD and blocked paths must match.
+  test_product<T, 4, 4, 4>();
+  test_product<T, 3, 4, 2>();
+  test_product<T, 8, 8, 8>();
+  test_product<T, 9, 7, 11>();
+  test_product<T, 70, 5, 6>();
+
+  test_inverse<T, 1>();
+  test_inverse<T, 2>();
+  test_inverse<T, 3>();
+  test_inverse<T, 4>();
+  test_inverse<T, 5>();
+  test_inverse<T, 7>();
+  test_inverse_affine<T>();
+}
+
+void test_batched_multiply() {
+  std::vector<Matrix4> a(33), b(33), out(33);
+  for (size_t i = 0; i < a.size(); i++) {
+    for (size_t j = 0; j < 4; j++) {
+      for (size_t k = 0; k < 4; k++) {
+        a[i][j][k] = float((i + j * 4 + k) % 9) - 4.0f;
+        b[i][j][k] = float((i * 3 + j + k * 2) % 7) - 3.0f;
+      }
+    }
+  }
+
+  multiply(std::span<const Matrix4>{ a }, std::span<const Matrix4>{ b }, std::span<Matrix4>{ out });
+  for (size_t i = 0; i < a.size(); i++)
+    rnAssert(out[i] == reference_product(a[i], b[i]));
+
+  multiply(a[3], std::span<const Matrix4>{ b }, std::span<Matrix4>{ out });
+  for (size_t i = 0; i < b.size(); i++)
+    rnAssert(out[i] == reference_product(a[3], b[i]));
 }
 
 void run_tests() {
@@ -88,6 +275,16 @@ void run_tests() {
   test_integer_type<int16_t>();
   test_integer_type<int32_t>();
   test_integer_type<int64_t>();
+
+  test_product<int32_t, 8, 8, 8>();
+  test_batched_multiply();
+
+  test_determinant<int32_t, 2>();
+  test_determinant<int32_t, 3>();
+  test_determinant<int32_t, 4>();
+  test_determinant<int32_t, 5>();
+  test_determinant<int64_t, 6>();
+  test_batched_inverse();
 }
 
 int main() {
@@ -0,0 +1,152 @@
+#define RN_PROFILE 1
+#include <Ranae/Core/Profiler.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace ranae;
+
+size_t count_events(const std::vector<ProfileEvent>& events, uint32_t name, ProfileEventType type) {
+  size_t count = 0;
+  for (const ProfileEvent& event : events)
+    count += event.name == name && event.type == type;
+  return count;
+}
+
+void nested_work(size_t depth) {
+  RN_ZONE("nested");
+  if (depth > 0)
+    nested_work(depth - 1);
+}
+
+void test_zones() {
+  Profiler::clear();
+  Profiler::setThreadName("main");
+
+  {
+    RN_ZONE("outer");
+    RN_ZONE("inner");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  nested_work(9);
+  for (int i = 0; i < 5; i++)
+    RN_COUNTER("entities", i * 10);
+  RN_FRAME();
+
+  const std::vector<ProfileEvent> events = Profiler::collect();
+  rnAssert(count_events(events, "outer"_hash, ProfileEventType::Zone) == 1);
+  rnAssert(count_events(events, "nested"_hash, ProfileEventType::Zone) == 10);
+  rnAssert(count_events(events, "entities"_hash, ProfileEventType::Counter) == 5);
+  rnAssert(Profiler::name("outer"_hash) == std::string_view{ "outer" });
+
+  // Zones are recorded on exit, so the inner one comes first and sits
+  // inside the outer one.
+  const ProfileEvent& inner = events[0];
+  const ProfileEvent& outer = events[1];
+  rnAssert(inner.name == "inner"_hash && outer.name == "outer"_hash);
+  rnAssert(outer.begin <= inner.begin && inner.data <= outer.data);
+  rnAssert(double(inner.data - inner.begin) * Profiler::tickPeriod() >= 1e6);
+
+  const ProfileEvent& counter = events[events.size() - 2];
+  rnAssert(counter.type == ProfileEventType::Counter && counter.value() == 40.0);
+  rnAssert(events.back().type == ProfileEventType::Frame);
+}
+
+void test_threads() {
+  Profiler::clear();
+
+  constexpr size_t ThreadCount = 4;
+  constexpr size_t Zones = 1000;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < ThreadCount; t++) {
+    threads.emplace_back([] {
+      for (size_t i = 0; i < Zones; i++) {
+        RN_ZONE("worker");
+      }
+    });
+  }
+
+  // Dumping while the threads record only ever sees whole events.
+  for (size_t i = 0; i < 10; i++) {
+    for (const ProfileEvent& event : Profiler::collect())
+      rnAssert(event.type == ProfileEventType::Zone && event.name == "worker"_hash && event.begin <= event.data);
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  const std::vector<ProfileEvent> events = Profiler::collect();
+  rnAssert(count_events(events, "worker"_hash, ProfileEventType::Zone) == ThreadCount * Zones);
+}
+
+void test_wrap_around() {
+  Profiler::clear();
+
+  // Only the newest events are kept once the ring is full.
+  for (size_t i = 0; i < ProfileBuffer::Capacity + 100; i++)
+    RN_COUNTER("index", i);
+
+  const std::vector<ProfileEvent> events = Profiler::collect();
+  rnAssert(events.size() == ProfileBuffer::Capacity - 1);
+  rnAssert(events.front().value() == 101.0);
+  rnAssert(events.back().value() == double(ProfileBuffer::Capacity + 99));
+}
+
+void test_chrome_trace() {
+  Profiler::clear();
+  {
+    RN_ZONE("say \"hi\"");
+    RN_COUNTER("memory", 1.5);
+  }
+  RN_FRAME();
+
+  std::ostringstream out;
+  Profiler::writeChromeTrace(out);
+  const std::string trace = out.str();
+
+  rnAssert(trace.starts_with("{\"traceEvents\":["));
+  rnAssert(trace.find("\"name\":\"thread_name\",\"ph\":\"M\"") != std::string::npos);
+  rnAssert(trace.find("\"args\":{\"name\":\"main\"}") != std::string::npos);
+  rnAssert(trace.find("\"name\":\"say \\\"hi\\\"\",\"ph\":\"X\"") != std::string::npos);
+  rnAssert(trace.find("\"name\":\"memory\",\"ph\":\"C\"") != std::string::npos);
+  rnAssert(trace.find("\"args\":{\"value\":1.500}") != std::string::npos);
+  rnAssert(trace.find("\"ph\":\"i\",\"s\":\"g\"") != std::string::npos);
+
+  size_t depth = 0;
+  for (const char c : trace) {
+    depth += c == '{' || c == '[';
+    rnAssert(c != '}' && c != ']' ? true : depth-- > 0);
+  }
+  rnAssert(depth == 0);
+}
+
+void test_overhead() {
+  Profiler::clear();
+
+  constexpr size_t Count = 50000;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < Count; i++) {
+    RN_ZONE("empty");
+  }
+  const double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()) / Count;
+  std::cout << "Zone overhead: " << ns << " ns" << std::endl;
+  // Loose, the target is ~20 ns in optimized builds.
+  rnAssert(ns < 1000.0);
+}
+
+void run_tests() {
+  test_zones();
+  test_threads();
+  test_wrap_around();
+  test_chrome_trace();
+  test_overhead();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+#include <Ranae/Math/Quaternion.h>
+#include <Ranae/Math/VectorStream.h>
+#include <iostream>
+#include <vector>
+
+using namespace ranae;
+
+template <typename T>
+bool near(const Vector<T, 3>& a, const Vector<T, 3>& b) {
+  for (size_t c = 0; c < 3; c++) {
+    if (std::abs(a[c] - b[c]) > T{ 1e-5 })
+      return false;
+  }
+  return true;
+}
+
+template <typename T>
+bool near(const Quaternion<T>& a, const Quaternion<T>& b) {
+  for (size_t c = 0; c < 4; c++) {
+    if (std::abs(a[c] - b[c]) > T{ 1e-5 })
+      return false;
+  }
+  return true;
+}
+
+// The textbook form, q * (0, v) * conjugate(q).
+template <typename T>
+Vector<T, 3> reference_rotate(const Quaternion<T>& q, const Vector<T, 3>& v) {
+  return vector(q * Quaternion<T>{ v, T{ 0 } } * conjugate(q));
+}
+
+template <typename T>
+Quaternion<T> make_rotation(size_t i) {
+  const T s = T(i % 13) * T{ 0.1 };
+  return Quaternion<T>{ normalize(Vector<T, 4>{ T{ 0.3 } + s, T{ -0.2 } * s, T{ 0.7 }, T{ 1 } - s }) };
+}
+
+template <typename T>
+Vector<T, 3> make_vector(size_t i) {
+  return Vector<T, 3>{ T(i % 7) - T{ 3 }, T{ 0.5 } * T(i % 5), T{ 2 } - T(i % 3) };
+}
+
+template <typename T>
+void test_single() {
+  const Quaternion<T> identity{ T{ 0 }, T{ 0 }, T{ 0 }, T{ 1 } };
+  const Vector<T, 3> v{ T{ 1 }, T{ 2 }, T{ 3 } };
+  rnAssert(identity * v == v);
+
+  // 90 degrees around z takes x to y.
+  const T h = std::sqrt(T{ 0.5 });
+  const Quaternion<T> z90{ T{ 0 }, T{ 0 }, h, h };
+  rnAssert(near(z90 * Vector<T, 3>{ T{ 1 }, T{ 0 }, T{ 0 } }, Vector<T, 3>{ T{ 0 }, T{ 1 }, T{ 0 } }));
+
+  for (size_t i = 0; i < 50; i++)
+    rnAssert(near(make_rotation<T>(i) * make_vector<T>(i), reference_rotate(make_rotation<T>(i), make_vector<T>(i))));
+}
+
+template <typename T>
+void test_batched(size_t count) {
+  std::vector<Quaternion<T>> qs(count), ps(count);
+  std::vector<Vector<T, 3>> vs(count);
+  for (size_t i = 0; i < count; i++) {
+    qs[i] = make_rotation<T>(i);
+    ps[i] = make_rotation<T>(i + 5);
+    vs[i] = make_vector<T>(i);
+  }
+  const std::span<const Quaternion<T>> q{ qs }, p{ ps };
+  const std::span<const Vector<T, 3>> v{ vs };
+
+  std::vector<Vector<T, 3>> rotated(count);
+  rotate(qs[count / 2], v, std::span<Vector<T, 3>>{ rotated });
+  for (size_t i = 0; i < count; i++)
+    rnAssert(near(rotated[i], reference_rotate(qs[count / 2], vs[i])));
+
+  rotate(q, v, std::span<Vector<T, 3>>{ rotated });
+  for (size_t i = 0; i < count; i++)
+    rnAssert(near(rotated[i], qs[i] * vs[i]));
+
+  std::vector<Quaternion<T>> products(count);
+  multiply(q, p, std::span<Quaternion<T>>{ products });
+  for (size_t i = 0; i < count; i++)
+    rnAssert(near(products[i], qs[i] * ps[i]));
+
+  // Test in-place
+  std::vector<Quaternion<T>> scaled(count);
+  for (size_t i = 0; i < count; i++)
+    scaled[i] = Quaternion<T>{ qs[i] * T(i % 4 + 2) };
+  normalize(std::span<const Quaternion<T>>{ scaled }, std::span<Quaternion<T>>{ scaled });
+  for (size_t i = 0; i < count; i++)
+    rnAssert(near(scaled[i], qs[i]));
+
+  // Test the SoA stream kernels against the same results.
+  std::vector<Vector<T, 4>> qv(count), pv(count);
+  for (size_t i = 0; i < count; i++) {
+    qv[i] = qs[i];
+    pv[i] = ps[i];
+  }
+  const VectorStream<T, 4> qStream{ std::span<const Vector<T, 4>>{ qv } };
+  const VectorStream<T, 4> pStream{ std::span<const Vector<T, 4>>{ pv } };
+  const VectorStream<T, 3> vStream{ v };
+  VectorStream<T, 3> out{ count };
+
+  rotate(qs[0], vStream, out);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(near(out.get(i), qs[0] * vs[i]));
+
+  rotate(qStream, vStream, out);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(near(out.get(i), qs[i] * vs[i]));
+
+  VectorStream<T, 4> composed = qStream;
+  compose(composed, pStream, composed);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(near(Quaternion<T>{ composed.get(i) }, qs[i] * ps[i]));
+}
+
+void run_tests() {
+  test_single<float>();
+  test_single<double>();
+
+  // Odd counts to exercise the tail after the last full block.
+  for (size_t count : { 1, 7, 16, 37, 1000 }) {
+    test_batched<float>(count);
+    test_batched<double>(count);
+  }
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
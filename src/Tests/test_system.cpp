@@ -0,0 +1,481 @@
+#include <Ranae/Scene/System.h>
+#include <Ranae/Math/Vector.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace ranae;
+
+struct PositionComponent {
+  static constexpr uint32_t ComponentIdx = 1;
+
+  Vector<float, 3> value;
+};
+
+struct VelocityComponent {
+  static constexpr uint32_t ComponentIdx = 2;
+
+  Vector<float, 3> value;
+};
+
+void test_job_system() {
+  JobSystem jobs{ 4 };
+  rnAssert(jobs.threadCount() == 5);
+
+  // Every index is visited exactly once, whatever the split.
+  for (size_t count : { 0, 1, 63, 64, 1000, 100000 }) {
+    std::vector<std::atomic<uint32_t>> visits(count);
+    jobs(count, 64, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
+        visits[i].fetch_add(1, std::memory_order_relaxed);
+    });
+    for (size_t i = 0; i < count; i++)
+      rnAssert(visits[i].load() == 1);
+  }
+
+  // Jobs that fan out again and wait on their own counters.
+  std::atomic<uint32_t> total{ 0 };
+  JobCounter counter;
+  for (size_t i = 0; i < 32; i++) {
+    jobs.run(counter, [&] {
+      jobs(1000, 10, [&](size_t begin, size_t end) {
+        total.fetch_add(uint32_t(end - begin), std::memory_order_relaxed);
+      });
+    });
+  }
+  jobs.wait(counter);
+  rnAssert(counter.done());
+  rnAssert(total.load() == 32 * 1000);
+
+  // No workers at all, everything runs on the waiting thread.
+  JobSystem inline_jobs{ 0 };
+  size_t sum = 0;
+  inline_jobs(100, 7, [&](size_t begin, size_t end) { sum += end - begin; });
+  rnAssert(sum == 100);
+}
+
+// Tracks its copies, to check captures are destroyed once, run or not.
+struct CaptureTracker {
+  static inline std::atomic<int> live{ 0 };
+
+  std::atomic<uint32_t>* runs;
+  char                   padding[128] = {};
+
+  explicit CaptureTracker(std::atomic<uint32_t>* runs) : runs{ runs } { live++; }
+  CaptureTracker(const CaptureTracker& other) : runs{ other.runs } { live++; }
+  ~CaptureTracker() { live--; }
+
+  void operator()() const { runs->fetch_add(1, std::memory_order_relaxed); }
+};
+
+void test_job_storage() {
+  std::atomic<uint32_t> runs{ 0 };
+  {
+    JobSystem jobs{ 2 };
+
+    // Callables too big to be stored inline, and a std::function.
+    JobCounter counter;
+    for (size_t i = 0; i < 1000; i++)
+      jobs.run(counter, CaptureTracker{ &runs });
+    jobs.run(counter, JobSystem::Job{ [&runs] { runs.fetch_add(1, std::memory_order_relaxed); } });
+    jobs.wait(counter);
+    rnAssert(runs.load() == 1001);
+    rnAssert(CaptureTracker::live == 0);
+
+    // Two jobs parked on each other's counters never run, and are dropped
+    // with the system. The gate holds a back until the cycle is set up.
+    std::atomic<bool> open{ false };
+    JobCounter gate, a, b;
+    jobs.run(gate, [&open] {
+      while (!open.load())
+        std::this_thread::yield();
+    });
+    jobs.runAfter(gate, a, [] {});
+    jobs.runAfter(a, b, CaptureTracker{ &runs });
+    jobs.runAfter(b, a, CaptureTracker{ &runs });
+    open.store(true);
+    jobs.wait(gate);
+    rnAssert(CaptureTracker::live == 2);
+  }
+  rnAssert(runs.load() == 1001);
+  rnAssert(CaptureTracker::live == 0);
+
+  // Jobs pushed while the workers sleep must wake one of them up: the
+  // pushing thread never helps here, it only watches for the job to run.
+  JobSystem jobs{ 2 };
+  for (size_t i = 0; i < 200; i++) {
+    if (i % 20 == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    std::atomic<bool> ran{ false };
+    JobCounter counter;
+    jobs.run(counter, [&ran] { ran.store(true); });
+    while (!ran.load())
+      std::this_thread::yield();
+    while (!counter.done())
+      std::this_thread::yield();
+  }
+}
+
+void test_work_stealing_deque() {
+  // Owner side alone behaves like a stack, and grows past its capacity.
+  WorkStealingDeque<uintptr_t> deque{ 4 };
+  for (uintptr_t i = 0; i < 100; i++)
+    deque.push(i);
+  rnAssert(deque.size() == 100);
+  uintptr_t item;
+  rnAssert(deque.steal(item) && item == 0);
+  for (uintptr_t i = 100; i-- > 1;)
+    rnAssert(deque.pop(item) && item == i);
+  rnAssert(!deque.pop(item) && !deque.steal(item) && deque.empty());
+
+  // Thieves and the owner race for the same items, each is taken once.
+  constexpr uintptr_t Count = 200000;
+  std::vector<std::atomic<uint32_t>> taken(Count);
+  std::atomic<bool> pushing{ true };
+  std::vector<std::thread> thieves;
+  for (size_t t = 0; t < 4; t++) {
+    thieves.emplace_back([&] {
+      uintptr_t stolen;
+      while (pushing.load() || !deque.empty()) {
+        if (deque.steal(stolen))
+          taken[stolen].fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (uintptr_t i = 0; i < Count; i++) {
+    deque.push(i);
+    if (i % 3 == 0 && deque.pop(item))
+      taken[item].fetch_add(1, std::memory_order_relaxed);
+  }
+  while (deque.pop(item))
+    taken[item].fetch_add(1, std::memory_order_relaxed);
+  pushing.store(false);
+  for (std::thread& thief : thieves)
+    thief.join();
+
+  for (uintptr_t i = 0; i < Count; i++)
+    rnAssert(taken[i].load() == 1);
+}
+
+void test_job_dependencies() {
+  JobSystem jobs{ 3 };
+
+  // Three stages, each only starting once the one before is done.
+  for (size_t round = 0; round < 20; round++) {
+    std::atomic<uint32_t> first{ 0 }, second{ 0 }, third{ 0 };
+    std::atomic<bool> ordered{ true };
+    JobCounter a, b, c;
+    for (size_t i = 0; i < 16; i++) {
+      jobs.run(a, [&] {
+        std::this_thread::yield();
+        first.fetch_add(1);
+      });
+    }
+    for (size_t i = 0; i < 8; i++) {
+      jobs.runAfter(a, b, [&] {
+        if (first.load() != 16)
+          ordered.store(false);
+        second.fetch_add(1);
+      });
+    }
+    jobs.runAfter(b, c, [&] {
+      if (second.load() != 8)
+        ordered.store(false);
+      third.fetch_add(1);
+    });
+
+    jobs.wait(c);
+    rnAssert(ordered.load());
+    rnAssert(third.load() == 1);
+    rnAssert(a.done() && b.done());
+  }
+
+  // A finished dependency doesn't hold anything back.
+  JobCounter done, after;
+  bool ran = false;
+  jobs.runAfter(done, after, [&] { ran = true; });
+  jobs.wait(after);
+  rnAssert(ran);
+
+  // Without workers the waiting thread runs the whole chain.
+  JobSystem inline_jobs{ 0 };
+  JobCounter x, y;
+  std::vector<int> order;
+  inline_jobs.run(x, [&] { order.push_back(1); });
+  inline_jobs.runAfter(x, y, [&] { order.push_back(2); });
+  inline_jobs.wait(y);
+  rnAssert((order == std::vector<int>{ 1, 2 }));
+}
+
+void test_parallel_for() {
+  JobSystem jobs{ 4 };
+
+  // Automatic grain, every index once.
+  for (size_t count : { 0, 1, 17, 5000, 1000000 }) {
+    std::vector<uint8_t> visits(count);
+    jobs.parallelFor(count, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
+        visits[i]++;
+    });
+    rnAssert(std::all_of(visits.begin(), visits.end(), [](uint8_t v) { return v == 1; }));
+  }
+
+  // Chunks start at multiples of the grain and never exceed it.
+  std::atomic<bool> aligned{ true };
+  jobs.parallelFor(10000, 96, [&](size_t begin, size_t end) {
+    if (begin % 96 != 0 || end - begin > 96 || (end - begin < 96 && end != 10000))
+      aligned.store(false);
+  });
+  rnAssert(aligned.load());
+
+  constexpr uint64_t Count = 1000000;
+  const auto sum = [](uint64_t a, uint64_t b) { return a + b; };
+  const auto map = [](size_t begin, size_t end) {
+    uint64_t total = 0;
+    for (size_t i = begin; i < end; i++)
+      total += i;
+    return total;
+  };
+  rnAssert(jobs.parallelReduce(Count, uint64_t(0), map, sum) == Count * (Count - 1) / 2);
+  rnAssert(jobs.parallelReduce(Count, 1, uint64_t(0), map, sum) == Count * (Count - 1) / 2);
+  rnAssert(jobs.parallelReduce(0, uint64_t(7), map, sum) == 7);
+
+  // Non-trivial results.
+  using Bounds = std::pair<float, float>;
+  std::vector<float> values(100000);
+  for (size_t i = 0; i < values.size(); i++)
+    values[i] = float((i * 7919) % 100003) - 50000.0f;
+  const Bounds bounds = jobs.parallelReduce(values.size(), 256, Bounds{ 1e30f, -1e30f },
+    [&](size_t begin, size_t end) {
+      const auto [lo, hi] = std::minmax_element(values.begin() + begin, values.begin() + end);
+      return Bounds{ *lo, *hi };
+    },
+    [](Bounds a, Bounds b) { return Bounds{ std::min(a.first, b.first), std::max(a.second, b.second) }; });
+  const auto [lo, hi] = std::minmax_element(values.begin(), values.end());
+  rnAssert(bounds.first == *lo && bounds.second == *hi);
+
+  // Nested inside jobs, with the outer thread helping.
+  std::atomic<uint64_t> total{ 0 };
+  jobs.parallelFor(64, 1, [&](size_t, size_t) {
+    total.fetch_add(jobs.parallelReduce(1000, uint64_t(0), map, sum));
+  });
+  rnAssert(total.load() == 64 * (1000 * 999 / 2));
+}
+
+void test_dependencies() {
+  SystemScheduler scheduler;
+  const auto none = [](World&, JobSystem&) {};
+  const uint32_t move      = scheduler.addSystem<Read<VelocityComponent>, Write<PositionComponent>>("move", none);
+  const uint32_t render    = scheduler.addSystem<Read<PositionComponent>>("render", none);
+  const uint32_t steer     = scheduler.addSystem<Write<VelocityComponent>>("steer", none);
+  const uint32_t names     = scheduler.addSystem<Read<NameComponent>>("names", none);
+  const uint32_t constrain = scheduler.addSystem<Write<PositionComponent>>("constrain", none);
+
+  rnAssert(scheduler.access(move).reads == componentSignature<VelocityComponent>());
+  rnAssert(scheduler.access(move).writes == componentSignature<PositionComponent>());
+  rnAssert(scheduler.findSystem("steer") == steer);
+  rnAssert(scheduler.findSystem("nope") == SystemScheduler::InvalidSystem);
+
+  // No graph yet.
+  rnAssert(scheduler.dependencies(move).empty());
+  rnAssert(scheduler.dependencies(constrain).empty());
+
+  World world;
+  JobSystem jobs{ 2 };
+  scheduler.run(world, jobs);
+
+  using Deps = std::vector<uint32_t>;
+  rnAssert(scheduler.dependencies(move).empty());
+  rnAssert(scheduler.dependencies(render) == Deps{ move });
+  rnAssert(scheduler.dependencies(steer) == Deps{ move });
+  rnAssert(scheduler.dependencies(names).empty());
+  // move -> constrain is implied through render.
+  rnAssert(scheduler.dependencies(constrain) == Deps{ render });
+
+  scheduler.setEnabled(render, false);
+  scheduler.run(world, jobs);
+  rnAssert(scheduler.dependencies(constrain) == Deps{ move });
+
+  // Added since the last run.
+  const uint32_t late = scheduler.addSystem<Write<PositionComponent>>("late", none);
+  rnAssert(scheduler.dependencies(late).empty());
+  scheduler.run(world, jobs);
+  rnAssert(scheduler.dependencies(late) == Deps{ constrain });
+}
+
+void test_scheduler() {
+  World world;
+  world.registerComponent<PositionComponent>();
+  world.registerComponent<VelocityComponent>();
+
+  constexpr size_t Count = 5000;
+  for (size_t i = 0; i < Count; i++) {
+    const EntityId id = world.createEntity();
+    world.addComponent(id, PositionComponent{});
+    world.addComponent(id, VelocityComponent{ Vector<float, 3>{ float(i), 1.0f, 0.0f } });
+  }
+
+  // Each system records when it ran, conflicting ones must see the order
+  // they were added in.
+  std::atomic<uint32_t> clock{ 0 };
+  uint32_t moved = 0, steered = 0, read = 0;
+  float    sum   = 0.0f;
+
+  SystemScheduler scheduler;
+  scheduler.addSystem<Read<VelocityComponent>, Write<PositionComponent>>("move", [&](World& world, JobSystem& jobs) {
+    world.query<PositionComponent, VelocityComponent>().forEach(jobs, 256,
+      [](EntityId, PositionComponent& position, VelocityComponent& velocity) {
+        position.value += velocity.value;
+      });
+    moved = clock.fetch_add(1);
+  });
+  scheduler.addSystem<Write<VelocityComponent>>("steer", [&](World& world, JobSystem& jobs) {
+    world.query<VelocityComponent>().forEach(jobs, 256, [](EntityId, VelocityComponent& velocity) {
+      velocity.value[1] = 2.0f;
+    });
+    steered = clock.fetch_add(1);
+  });
+  scheduler.addSystem<Read<PositionComponent>>("read", [&](World& world, JobSystem&) {
+    world.query<PositionComponent>().forEach([&](EntityId, PositionComponent& position) {
+      sum += position.value[1];
+    });
+    read = clock.fetch_add(1);
+  });
+
+  JobSystem jobs{ 3 };
+  for (size_t frame = 0; frame < 3; frame++) {
+    scheduler.run(world, jobs);
+    rnAssert(moved < steered);
+    rnAssert(moved < read);
+  }
+
+  // Frame 0 moves by y = 1, later frames by the steered y = 2.
+  rnAssert(sum == float(Count) * (1.0f + 3.0f + 5.0f));
+  const auto entities = world.query<PositionComponent>().entities();
+  for (size_t i = 0; i < Count; i++) {
+    const PositionComponent& position = world.getComponent<PositionComponent>(entities[i]);
+    rnAssert(position.value[1] == 5.0f);
+    rnAssert(position.value[0] == 3.0f * world.getComponent<VelocityComponent>(entities[i]).value[0]);
+  }
+}
+
+void test_change_ticks() {
+  World world;
+  world.registerComponent<PositionComponent>();
+  world.registerComponent<VelocityComponent>();
+
+  std::vector<EntityId> ids;
+  for (size_t i = 0; i < 1000; i++) {
+    ids.push_back(world.createEntity());
+    world.addComponent(ids.back(), PositionComponent{});
+    world.addComponent(ids.back(), VelocityComponent{});
+  }
+
+  // steer touches a few velocities, move only picks up those, and sync
+  // only sees the positions move wrote since sync last ran.
+  size_t frame = 0, moved = 0, synced = 0;
+
+  SystemScheduler scheduler;
+  scheduler.addSystem<Write<VelocityComponent>>("steer", [&](World& world, JobSystem&) {
+    for (size_t i = frame; i < ids.size(); i += 100)
+      world.getComponent<VelocityComponent>(ids[i]).value[0] += 1.0f;
+  });
+  scheduler.addSystem<Read<VelocityComponent>, Write<PositionComponent>>("move", [&](World& world, JobSystem& jobs, uint32_t lastRun) {
+    moved = 0;
+    world.query<PositionComponent, Changed<const VelocityComponent>>().since(lastRun).forEach(jobs, 4,
+      [&](EntityId, PositionComponent& position, const VelocityComponent& velocity) {
+        position.value += velocity.value;
+      });
+    world.query<Changed<const VelocityComponent>>().since(lastRun).forEach([&](EntityId, const VelocityComponent&) { moved++; });
+  });
+  scheduler.addSystem<Read<PositionComponent>>("sync", [&](World& world, JobSystem&, uint32_t lastRun) {
+    synced = 0;
+    world.query<Changed<const PositionComponent>>().since(lastRun).forEach([&](EntityId, const PositionComponent&) { synced++; });
+  });
+
+  JobSystem jobs{ 2 };
+
+  // Everything is new on the first run.
+  scheduler.run(world, jobs);
+  rnAssert(moved == ids.size());
+  rnAssert(synced == ids.size());
+
+  for (frame = 1; frame < 4; frame++) {
+    scheduler.run(world, jobs);
+    rnAssert(moved == 10);
+    rnAssert(synced == 10);
+  }
+
+  // Changes made between frames are picked up on the next one.
+  world.getComponent<PositionComponent>(ids[3]).value[1] = 5.0f;
+  scheduler.run(world, jobs);
+  rnAssert(synced == 11);
+}
+
+// A system's own writes must not show up as changes on its next run, even
+// when another system advances the tick while it is running.
+void test_concurrent_change_ticks() {
+  World world;
+  world.registerComponent<PositionComponent>();
+  world.registerComponent<VelocityComponent>();
+
+  std::vector<EntityId> ids;
+  for (size_t i = 0; i < 100; i++) {
+    ids.push_back(world.createEntity());
+    world.addComponent(ids.back(), PositionComponent{});
+    world.addComponent(ids.back(), VelocityComponent{});
+  }
+
+  size_t changed = 0;
+  std::atomic<bool> otherStarted{ false };
+
+  SystemScheduler scheduler;
+  scheduler.addSystem<Write<PositionComponent>>("write_own", [&](World& world, JobSystem&, uint32_t lastRun) {
+    // Give the other system the chance to start (and take a tick) first.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    while (!otherStarted.load() && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::yield();
+
+    changed = 0;
+    world.query<Changed<const PositionComponent>>().since(lastRun).forEach([&](EntityId, const PositionComponent&) { changed++; });
+    world.getComponent<PositionComponent>(ids[0]).value[0] += 1.0f;
+  });
+  scheduler.addSystem<Write<VelocityComponent>>("other", [&](World& world, JobSystem&) {
+    otherStarted.store(true);
+    world.getComponent<VelocityComponent>(ids[1]).value[0] += 1.0f;
+  });
+
+  JobSystem jobs{ 2 };
+  scheduler.run(world, jobs);
+  rnAssert(changed == ids.size());
+
+  for (size_t frame = 1; frame < 20; frame++) {
+    otherStarted.store(false);
+    scheduler.run(world, jobs);
+    rnAssert(changed == 0);
+  }
+}
+
+void run_tests() {
+  test_job_system();
+  test_work_stealing_deque();
+  test_job_storage();
+  test_job_dependencies();
+  test_parallel_for();
+  test_dependencies();
+  test_scheduler();
+  test_change_ticks();
+  test_concurrent_change_ticks();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <Ranae/Math/Transform.h>
+#include <iostream>
+#include <vector>
+
+using namespace ranae;
+
+bool near(const Vector<float, 3>& a, const Vector<float, 3>& b, float eps = 1e-5f) {
+  for (size_t i = 0; i < 3; i++) {
+    if (std::abs(a[i] - b[i]) > eps)
+      return false;
+  }
+  return true;
+}
+
+Transform test_transform(size_t seed) {
+  const float s = float(seed);
+  const Quaternion<float> q{ normalize(Vector<float, 4>{ 0.3f + s, -0.2f * s, 0.7f, 1.0f + 0.1f * s }) };
+  return Transform {
+    .position    = Vector<float, 3>{ s, -2.0f * s, 0.5f },
+    .orientation = q,
+    .scale       = Vector<float, 3>{ 1.0f + 0.25f * s, 2.0f, 0.5f },
+  };
+}
+
+Vector<float, 3> apply(const Transform& t, const Vector<float, 3>& p) {
+  return t.position + t.orientation * (t.scale * p);
+}
+
+void test_transform_matrix() {
+  const Vector<float, 3> points[] = {
+    Vector<float, 3>{ 1.0f, 0.0f, 0.0f },
+    Vector<float, 3>{ 0.0f, 1.0f, 0.0f },
+    Vector<float, 3>{ 0.0f, 0.0f, 1.0f },
+    Vector<float, 3>{ 3.0f, -1.0f, 2.0f },
+  };
+
+  // Default transform is identity.
+  rnAssert(identity(Transform{}));
+  rnAssert(transformMatrix4(Transform{}) == Matrix4{});
+
+  for (size_t seed = 0; seed < 8; seed++) {
+    const Transform t  = test_transform(seed);
+    const Matrix4   m  = transformMatrix4(t);
+    const Matrix4x3 m3 = transformMatrix4x3(t);
+
+    for (const auto& p : points) {
+      const Vector<float, 4> r = m * Vector<float, 4>{ p[0], p[1], p[2], 1.0f };
+      rnAssert(near(Vector<float, 3>{ r[0], r[1], r[2] }, apply(t, p)));
+      rnAssert(r[3] == 1.0f);
+      rnAssert(near(m3 * Vector<float, 4>{ p[0], p[1], p[2], 1.0f }, apply(t, p)));
+    }
+  }
+}
+
+void test_batched_transform_matrices() {
+  for (size_t count : { 0, 1, 15, 16, 41 }) {
+    TransformStream stream{ count };
+    const TransformStreamView view = stream.view();
+    for (size_t i = 0; i < count; i++)
+      view.set(i, test_transform(i));
+
+    std::vector<Matrix4>   out4(count);
+    std::vector<Matrix4x3> out3(count);
+    transformMatrices(view, std::span<Matrix4>{ out4 });
+    transformMatrices(view, std::span<Matrix4x3>{ out3 });
+
+    // Compare with a tolerance, the compiler may contract to FMA differently.
+    for (size_t i = 0; i < count; i++) {
+      const Transform t = view.get(i);
+      const Matrix4   m4 = transformMatrix4(t);
+      const Matrix4x3 m3 = transformMatrix4x3(t);
+      for (size_t c = 0; c < 4; c++) {
+        rnAssert(near(m3[c], out3[i][c]));
+        rnAssert(near(Vector<float, 3>{ m4[c][0], m4[c][1], m4[c][2] }, Vector<float, 3>{ out4[i][c][0], out4[i][c][1], out4[i][c][2] }));
+        rnAssert(m4[c][3] == out4[i][c][3]);
+      }
+    }
+  }
+}
+
+void run_tests() {
+  test_transform_matrix();
+  test_batched_transform_matrices();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -99,7 +99,63 @@ void test_float_type() {
   }
 }
 
+// Checks the Vector<float, 3/4> fast paths against a plain scalar reference.
+template <size_t Size>
+void test_simd_float() {
+  using V = Vector<float, Size>;
+
+  V a, b;
+  for (size_t i = 0; i < Size; i++) {
+    a[i] = float(i) * 1.5f + 0.25f;
+    b[i] = 3.0f - float(i) * 0.75f;
+  }
+
+  V sum, diff, prod, quot, scaled;
+  float refDot = 0.0f;
+  for (size_t i = 0; i < Size; i++) {
+    sum[i]    = a[i] + b[i];
+    diff[i]   = a[i] - b[i];
+    prod[i]   = a[i] * b[i];
+    quot[i]   = a[i] / b[i];
+    scaled[i] = a[i] * 2.5f;
+    refDot   += a[i] * b[i];
+  }
+
+  rnAssert(a + b == sum);
+  rnAssert(a - b == diff);
+  rnAssert(a * b == prod);
+  rnAssert(a / b == quot);
+  rnAssert(a * 2.5f == scaled);
+
+  V c = a;
+  c += b;
+  rnAssert(c == sum);
+  c -= b;
+  c *= b;
+  rnAssert(c == prod);
+
+  const auto near = [](float x, float y, float eps) { return std::abs(x - y) <= eps * std::max(1.0f, std::abs(y)); };
+
+  rnAssert(near(dot(a, b), refDot, 1e-6f));
+  rnAssert(near(length(a), std::sqrt(dot(a, a)), 1e-6f));
+
+  const float rlen = 1.0f / std::sqrt(dot(a, a));
+  const V n  = normalize(a);
+  const V nf = normalizeFast(a);
+  const V r  = rcp(b);
+  const V rf = rcpFast(b);
+  for (size_t i = 0; i < Size; i++) {
+    rnAssert(near(n[i],  a[i] * rlen, 1e-6f));
+    rnAssert(near(nf[i], a[i] * rlen, 1e-5f));
+    rnAssert(near(r[i],  1.0f / b[i], 1e-6f));
+    rnAssert(near(rf[i], 1.0f / b[i], 1e-5f));
+  }
+}
+
 void run_tests() {
+  test_simd_float<3>();
+  test_simd_float<4>();
+
   test_float_type<float>();
   test_float_type<double>();
   test_float_type<long double>();
@@ -0,0 +1,155 @@
+#include <Ranae/Math/VectorStream.h>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+using namespace ranae;
+
+// So containers of streams move them when growing, instead of copying.
+static_assert(std::is_nothrow_move_constructible_v<VectorStream<float, 3>>);
+static_assert(std::is_nothrow_move_assignable_v<VectorStream<float, 4>>);
+
+template <typename T, size_t Size>
+void test_generic_type(size_t count) {
+  std::vector<Vector<T, Size>> as(count), bs(count);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t c = 0; c < Size; c++) {
+      as[i][c] = T(i % 7 + c + 1);
+      bs[i][c] = T((i + c) % 5 + 1);
+    }
+  }
+
+  const VectorStream<T, Size> a{ std::span<const Vector<T, Size>>{ as } };
+  const VectorStream<T, Size> b{ std::span<const Vector<T, Size>>{ bs } };
+  VectorStream<T, Size> out{ count };
+
+  // Test layout/conversions
+  rnAssert(a.size() == count);
+  rnAssert(a.capacity() % VectorStreamBlock == 0);
+  rnAssert(reinterpret_cast<uintptr_t>(a.lane(0)) % VectorStreamAlignment == 0);
+  {
+    std::vector<Vector<T, Size>> back(count);
+    a.toVectors(back);
+    rnAssert(back == as);
+  }
+
+  // Test element-wise kernels against the AoS ops.
+  add(a, b, out);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(out.get(i) == as[i] + bs[i]);
+
+  sub(a, b, out);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(out.get(i) == as[i] - bs[i]);
+
+  mul(a, b, out);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(out.get(i) == as[i] * bs[i]);
+
+  fma(a, b, a, out);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(out.get(i) == as[i] * bs[i] + as[i]);
+
+  scale(a, T{ 3 }, out);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(out.get(i) == as[i] * T{ 3 });
+
+  min(a, b, out);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t c = 0; c < Size; c++)
+      rnAssert(out.get(i)[c] == std::min(as[i][c], bs[i][c]));
+  }
+
+  max(a, b, out);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t c = 0; c < Size; c++)
+      rnAssert(out.get(i)[c] == std::max(as[i][c], bs[i][c]));
+  }
+
+  // Test in-place
+  VectorStream<T, Size> c = a;
+  add(c, b, c);
+  for (size_t i = 0; i < count; i++)
+    rnAssert(c.get(i) == as[i] + bs[i]);
+
+  std::vector<T> dots(count);
+  dot(a, b, std::span<T>{ dots });
+  for (size_t i = 0; i < count; i++)
+    rnAssert(dots[i] == dot(as[i], bs[i]));
+
+  // Test transform
+  Matrix<T, Size, Size> m{};
+  m[0][Size - 1] = T{ 2 };
+  m[Size - 1][0] = T{ 3 };
+  transform(m, a, out);
+  for (size_t i = 0; i < count; i++) {
+    Vector<T, Size> expected = as[i];
+    expected[Size - 1] += T{ 2 } * as[i][0];
+    expected[0]        += T{ 3 } * as[i][Size - 1];
+    rnAssert(out.get(i) == expected);
+  }
+
+  // Test resize keeps contents
+  c.resize(count + 3);
+  rnAssert(c.size() == count + 3);
+  rnAssert(c.get(count) == Vector<T, Size>{});
+  for (size_t i = 0; i < count; i++)
+    rnAssert(c.get(i) == as[i] + bs[i]);
+}
+
+template <typename T, size_t Size>
+void test_float_type(size_t count) {
+  test_generic_type<T, Size>(count);
+
+  std::vector<Vector<T, Size>> as(count);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t c = 0; c < Size; c++)
+      as[i][c] = T(i % 11) - T(c) + T{ 0.5 };
+  }
+  const VectorStream<T, Size> a{ std::span<const Vector<T, Size>>{ as } };
+  VectorStream<T, Size> out{ count };
+
+  const auto near = [](T x, T y) { return std::abs(x - y) <= T{ 1e-5 }; };
+
+  std::vector<T> lengths(count);
+  length(a, std::span<T>{ lengths });
+  for (size_t i = 0; i < count; i++)
+    rnAssert(near(lengths[i], length<T, Size, T>(as[i])));
+
+  normalize(a, out);
+  for (size_t i = 0; i < count; i++) {
+    const Vector<T, Size> expected = normalize<T, Size, T>(as[i]);
+    for (size_t c = 0; c < Size; c++)
+      rnAssert(near(out.get(i)[c], expected[c]));
+  }
+
+  // Test transformPoint applies the translation column.
+  Matrix<T, Size + 1, Size + 1> m{};
+  m[Size][0] = T{ 4 };
+  transformPoint(m, a, out);
+  for (size_t i = 0; i < count; i++) {
+    Vector<T, Size> expected = as[i];
+    expected[0] += T{ 4 };
+    rnAssert(out.get(i) == expected);
+  }
+}
+
+void run_tests() {
+  // Odd counts to exercise the tail after the last full block.
+  for (size_t count : { 0, 1, 16, 37, 1000 }) {
+    test_float_type<float, 3>(count);
+    test_float_type<float, 4>(count);
+    test_float_type<double, 3>(count);
+
+    test_generic_type<int32_t, 3>(count);
+    test_generic_type<int32_t, 4>(count);
+  }
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,438 @@
+#include <Ranae/Scene/World.h>
+#include <Ranae/Math/Vector.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace ranae;
+
+struct PositionComponent {
+  static constexpr uint32_t ComponentIdx = 1;
+
+  Vector<float, 3> value;
+};
+
+struct VelocityComponent {
+  static constexpr uint32_t ComponentIdx = 2;
+
+  Vector<float, 3> value;
+};
+
+struct FrozenComponent {
+  static constexpr uint32_t ComponentIdx = 3;
+};
+
+// Components past the first few words of a signature.
+template <uint32_t Idx>
+struct TagComponent {
+  static constexpr uint32_t ComponentIdx = Idx;
+
+  uint32_t value;
+};
+
+using GameComponents = EngineComponents::Append<PositionComponent, VelocityComponent, FrozenComponent>;
+
+static_assert(GameComponents::Signature == componentSignature<NameComponent, PositionComponent, VelocityComponent, FrozenComponent>());
+static_assert(componentIndicesUnique<PositionComponent, TagComponent<2>>());
+static_assert(!componentIndicesUnique<PositionComponent, TagComponent<1>>());
+static_assert(!componentIndicesUnique<PositionComponent, PositionComponent>());
+
+using MovingQuery = Query<PositionComponent, VelocityComponent, Without<FrozenComponent>>;
+
+static_assert(MovingQuery::Required == componentSignature<PositionComponent, VelocityComponent>());
+static_assert(MovingQuery::Excluded == componentSignature<FrozenComponent>());
+static_assert(Query<Without<NameComponent, FrozenComponent>>::Required.none());
+static_assert(Query<Without<NameComponent, FrozenComponent>>::Excluded == componentSignature<NameComponent, FrozenComponent>());
+
+// Checks the cached set against matching every entity from scratch.
+template <typename... Terms>
+void check_query(World& world, const std::vector<EntityId>& ids) {
+  Query<Terms...> query = world.query<Terms...>();
+
+  size_t expected = 0;
+  for (const EntityId id : ids) {
+    if (!world.alive(id))
+      continue;
+    const ComponentSignature signature = world.getSignature(id);
+    const bool match = (signature & query.Required) == query.Required && (signature & query.Excluded).none();
+    rnAssert(query.contains(id) == match);
+    expected += match;
+  }
+  rnAssert(query.size() == expected);
+}
+
+void test_query() {
+  World world;
+  world.registerComponents(GameComponents{});
+
+  std::vector<EntityId> ids;
+  for (size_t i = 0; i < 300; i++) {
+    const EntityId id = world.createEntity();
+    ids.push_back(id);
+
+    const float f = float(i);
+    world.addComponent(id, PositionComponent{ Vector<float, 3>{ f, 0.0f, 0.0f } });
+    if (i % 2 == 0)
+      world.addComponent(id, VelocityComponent{ Vector<float, 3>{ 1.0f, f, 0.0f } });
+    if (i % 3 == 0)
+      world.addComponent(id, FrozenComponent{});
+  }
+
+  // Created after the entities: filled by a scan.
+  MovingQuery moving = world.query<PositionComponent, VelocityComponent, Without<FrozenComponent>>();
+  check_query<PositionComponent, VelocityComponent, Without<FrozenComponent>>(world, ids);
+
+  // Created before further changes: kept up to date incrementally.
+  check_query<Without<VelocityComponent>>(world, ids);
+
+  moving.forEach([](EntityId, PositionComponent& position, VelocityComponent& velocity) {
+    position.value += velocity.value;
+  });
+  for (size_t i = 0; i < ids.size(); i++) {
+    const float f = float(i);
+    const bool  moved = i % 2 == 0 && i % 3 != 0;
+    rnAssert(world.getComponent<PositionComponent>(ids[i]).value == (moved
+      ? Vector<float, 3>{ f + 1.0f, f, 0.0f }
+      : Vector<float, 3>{ f, 0.0f, 0.0f }));
+  }
+
+  for (size_t i = 0; i < ids.size(); i += 3)
+    world.removeComponent<FrozenComponent>(ids[i]);
+  for (size_t i = 0; i < ids.size(); i += 5)
+    world.addComponent(ids[i], NameComponent{ "named" });
+  for (size_t i = 1; i < ids.size(); i += 4)
+    world.destroyEntity(ids[i]);
+  for (size_t i = 0; i < 20; i++) {
+    const EntityId id = world.createEntity();
+    ids.push_back(id);
+    world.addComponent(id, PositionComponent{});
+    world.addComponent(id, VelocityComponent{});
+  }
+
+  check_query<PositionComponent, VelocityComponent, Without<FrozenComponent>>(world, ids);
+  check_query<Without<VelocityComponent>>(world, ids);
+  check_query<NameComponent, PositionComponent>(world, ids);
+  rnAssert(moving.size() == world.query<PositionComponent, VelocityComponent, Without<FrozenComponent>>().size());
+
+  // Same masks in a different order share the cached state.
+  const size_t queries = world.queryCount();
+  world.query<VelocityComponent, PositionComponent, Without<FrozenComponent>>();
+  rnAssert(world.queryCount() == queries);
+
+  // Entities with no components match exclusion only queries.
+  const EntityId empty = world.createEntity();
+  rnAssert(world.query<Without<VelocityComponent>>().contains(empty));
+  rnAssert(!moving.contains(empty));
+  world.destroyEntity(empty);
+  rnAssert(!world.query<Without<VelocityComponent>>().contains(empty));
+}
+
+void test_change_detection() {
+  World world;
+  world.registerComponent<PositionComponent>();
+  world.registerComponent<VelocityComponent>();
+
+  std::vector<EntityId> ids;
+  for (size_t i = 0; i < 100; i++) {
+    ids.push_back(world.createEntity());
+    world.addComponent(ids.back(), PositionComponent{});
+    world.addComponent(ids.back(), VelocityComponent{});
+  }
+
+  const ComponentArray<PositionComponent>& positions = world.components().getComponentArray<PositionComponent>();
+  rnAssert(positions.added().size() == ids.size());
+
+  // A consumer takes a fresh tick when it runs, anything running after it
+  // does so under a newer one (the scheduler advances per system).
+  uint32_t lastRun = world.advanceTick();
+  world.advanceTick();
+
+  // Reading through const access is not a change.
+  auto changed = world.query<Changed<const PositionComponent>, const VelocityComponent>();
+  size_t visited = 0;
+  changed.since(lastRun).forEach([&](EntityId, const PositionComponent&, const VelocityComponent&) { visited++; });
+  rnAssert(visited == 0);
+  std::as_const(world).getComponent<PositionComponent>(ids[0]);
+
+  // Mutable access is.
+  for (size_t i = 0; i < ids.size(); i += 10)
+    world.getComponent<PositionComponent>(ids[i]).value[0] = 1.0f;
+  for (size_t i = 0; i < ids.size(); i++)
+    rnAssert(positions.changedSince(ids[i], lastRun) == (i % 10 == 0));
+
+  // Fetching a component mutably through a query stamps it too.
+  lastRun = world.advanceTick();
+  world.advanceTick();
+  world.query<const PositionComponent, VelocityComponent>().forEach([&](EntityId id, const PositionComponent&, VelocityComponent&) {
+    rnAssert(!positions.changedSince(id, lastRun));
+  });
+  world.query<PositionComponent>().forEach([&](EntityId id, PositionComponent&) {
+    rnAssert(positions.changedSince(id, lastRun));
+  });
+
+  // data() reads even through a mutable array, mutableData() writes all.
+  ComponentArray<PositionComponent>& writable = world.components().getComponentArray<PositionComponent>();
+  lastRun = world.advanceTick();
+  world.advanceTick();
+  rnAssert(writable.data().size() == ids.size());
+  for (const EntityId id : ids)
+    rnAssert(!positions.changedSince(id, lastRun));
+  writable.mutableData()[0].value[1] = 0.0f;
+  for (const EntityId id : ids)
+    rnAssert(positions.changedSince(id, lastRun));
+
+  // A consumer doesn't see writes made under its own tick.
+  lastRun = world.advanceTick();
+  world.getComponent<PositionComponent>(ids[1]).value[0] = 3.0f;
+  world.advanceTick();
+  for (size_t i = 5; i < ids.size(); i += 10)
+    world.getComponent<PositionComponent>(ids[i]).value[0] = 2.0f;
+
+  std::vector<EntityId> seen;
+  changed.since(lastRun).forEach([&](EntityId id, const PositionComponent& position, const VelocityComponent&) {
+    rnAssert(position.value[0] == 2.0f);
+    seen.push_back(id);
+  });
+  rnAssert(seen.size() == 10);
+
+  // Parallel-shaped iteration filters the same way.
+  size_t chunked = 0;
+  changed.since(lastRun).forEach(SerialExecutor{}, 7, [&](EntityId, const PositionComponent&, const VelocityComponent&) { chunked++; });
+  rnAssert(chunked == 10);
+
+  // Since 0 everything counts as changed.
+  visited = 0;
+  changed.since(0).forEach([&](EntityId, const PositionComponent&, const VelocityComponent&) { visited++; });
+  rnAssert(visited == ids.size());
+
+  // Removals swap the tick along with the component.
+  world.removeComponent<PositionComponent>(ids[0]);
+  for (size_t i = 0; i < seen.size(); i++)
+    rnAssert(positions.changedSince(seen[i], lastRun));
+
+  // Added/removed events, in tick order.
+  lastRun = world.advanceTick();
+  world.advanceTick();
+  world.destroyEntity(ids[1]);
+  const EntityId spawned = world.createEntity();
+  world.addComponent(spawned, PositionComponent{});
+
+  rnAssert(positions.addedSince(lastRun).size() == 1);
+  rnAssert(positions.addedSince(lastRun)[0].entity == spawned);
+  rnAssert(positions.removedSince(lastRun).size() == 1);
+  rnAssert(positions.removedSince(lastRun)[0].entity == ids[1]);
+  rnAssert(positions.removed().size() == 2);
+  rnAssert(positions.removed()[0].entity == ids[0]);
+
+  world.clearEvents();
+  rnAssert(positions.added().empty() && positions.removed().empty());
+
+  rnAssert(isNewerTick(1, ~0u));
+  rnAssert(!isNewerTick(~0u, 1));
+}
+
+void test_prefab() {
+  World world;
+  world.registerComponent<NameComponent>();
+  world.registerComponent<PositionComponent>();
+  world.registerComponent<VelocityComponent>();
+  world.registerComponent<FrozenComponent>();
+
+  auto moving = world.query<PositionComponent, VelocityComponent, Without<FrozenComponent>>();
+  auto empty  = world.query<Without<PositionComponent>>();
+
+  Prefab particle;
+  particle.add(PositionComponent{ Vector<float, 3>{ 1.0f, 2.0f, 3.0f } })
+          .add(VelocityComponent{ Vector<float, 3>{ 0.0f, -1.0f, 0.0f } })
+          .add(NameComponent{ "particle" });
+  rnAssert(particle.signature() == componentSignature<PositionComponent, VelocityComponent, NameComponent>());
+
+  Prefab frozen = particle;
+  frozen.add(FrozenComponent{});
+  frozen.get<PositionComponent>().value[0] = 5.0f;
+  rnAssert(particle.get<PositionComponent>().value[0] == 1.0f);
+  rnAssert(!particle.has<FrozenComponent>());
+
+  const std::vector<EntityId> burst = world.instantiate(particle, 10000);
+  const std::vector<EntityId> still = world.instantiate(frozen, 100);
+  const std::vector<EntityId> bare  = world.createEntities(50);
+
+  rnAssert(moving.size() == burst.size());
+  rnAssert(empty.size() == bare.size());
+  check_query<NameComponent, FrozenComponent>(world, still);
+
+  for (const EntityId id : burst) {
+    rnAssert(world.getSignature(id) == particle.signature());
+    rnAssert(world.getComponent<PositionComponent>(id).value == (Vector<float, 3>{ 1.0f, 2.0f, 3.0f }));
+    rnAssert(world.getComponent<NameComponent>(id).name == particle.get<NameComponent>().name);
+  }
+  for (const EntityId id : still)
+    rnAssert(world.getComponent<PositionComponent>(id).value[0] == 5.0f);
+
+  // Components land in one contiguous run per array.
+  const auto positions = world.components().getComponentArray<PositionComponent>().entities();
+  rnAssert(std::equal(burst.begin(), burst.end(), positions.begin()));
+
+  // Bulk created entities behave like any other.
+  world.destroyEntity(burst[0]);
+  world.removeComponent<PositionComponent>(burst[1]);
+  rnAssert(moving.size() == burst.size() - 2);
+  rnAssert(empty.size() == bare.size() + 1);
+}
+
+void test_wide_signatures() {
+  using Wide   = TagComponent<40>;
+  using Wider  = TagComponent<95>;
+  using Widest = TagComponent<MaxComponents - 1>;
+
+  World world;
+  world.registerComponent<PositionComponent>();
+  world.registerComponent<Wide>();
+  world.registerComponent<Wider>();
+  world.registerComponent<Widest>();
+
+  std::vector<EntityId> ids = world.createEntities(200);
+  for (uint32_t i = 0; i < ids.size(); i++) {
+    if (i % 2 == 0)
+      world.addComponent(ids[i], PositionComponent{});
+    if (i % 3 == 0)
+      world.addComponent(ids[i], Wide{ i });
+    if (i % 5 == 0)
+      world.addComponent(ids[i], Wider{ i });
+    if (i % 7 == 0)
+      world.addComponent(ids[i], Widest{ i });
+  }
+
+  check_query<PositionComponent, Widest>(world, ids);
+  check_query<Wide, Without<Wider, Widest>>(world, ids);
+  check_query<Without<PositionComponent, Wide>>(world, ids);
+
+  uint32_t sum = 0;
+  world.query<const Wide, const Widest>().forEach([&](EntityId, const Wide& wide, const Widest& widest) {
+    rnAssert(wide.value == widest.value);
+    sum += wide.value;
+  });
+  rnAssert(sum == 0 + 21 + 42 + 63 + 84 + 105 + 126 + 147 + 168 + 189);
+
+  for (uint32_t i = 0; i < ids.size(); i += 7)
+    world.removeComponent<Widest>(ids[i]);
+  rnAssert(world.query<Widest>().empty());
+  world.destroyEntity(ids[15]);
+  check_query<Wide, Wider>(world, ids);
+
+  // Batch matching agrees with testing bit by bit.
+  const ComponentSignature required = componentSignature<Wide, Widest>();
+  const ComponentSignature excluded = componentSignature<Wider>();
+  std::vector<ComponentSignature> signatures;
+  for (uint32_t i = 0; i < 256; i++) {
+    ComponentSignature signature;
+    for (uint32_t bit = 0; bit < MaxComponents; bit++)
+      signature.set(bit, (i * 2654435761u >> (bit % 29)) & 1u);
+    signature.set(Wide::ComponentIdx, i % 2);
+    signature.set(Widest::ComponentIdx, i % 3);
+    signature.set(Wider::ComponentIdx, i % 5 == 0);
+    signatures.push_back(signature);
+  }
+
+  std::vector<uint32_t> matched;
+  forEachMatchingSignature(signatures, required, excluded, [&](uint32_t i) { matched.push_back(i); });
+
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < signatures.size(); i++) {
+    if (i % 2 && i % 3 && i % 5)
+      expected.push_back(i);
+  }
+  rnAssert(matched == expected);
+}
+
+void test_names() {
+  World world;
+  world.registerComponent<NameComponent>();
+  world.registerComponent<PositionComponent>();
+
+  std::vector<EntityId> ids = world.createEntities(1000);
+  std::vector<std::string> names(ids.size());
+  for (uint32_t i = 0; i < ids.size(); i++) {
+    // Every fourth entity shares a name with the one before it.
+    names[i] = (i % 4 < 2 ? "light_" : "enemy_") + std::to_string(i % 4 == 3 ? i - 1 : i);
+    world.addComponent(ids[i], NameComponent{ names[i].c_str() });
+  }
+  rnAssert(world.names().size() == ids.size());
+  rnAssert(world.findEntity("light_0") == ids[0]);
+  rnAssert(world.findEntity("light_1") == ids[1]);
+  rnAssert(world.findEntity("missing") == InvalidEntity);
+  rnAssert(world.names().findAll("enemy_2").size() == 2);
+  rnAssert(world.names().findAll("enemy_3").empty());
+
+  // Prefixes, in sorted order.
+  std::vector<std::string_view> found;
+  world.names().forEachWithPrefix("light_1", [&](EntityId id, std::string_view name) {
+    rnAssert(name == names[entityIndex(id)]);
+    found.push_back(name);
+  });
+  rnAssert(std::is_sorted(found.begin(), found.end()));
+  size_t expected = 0;
+  for (const std::string& name : names)
+    expected += name.starts_with("light_1");
+  rnAssert(found.size() == expected);
+
+  size_t all = 0;
+  world.names().forEachWithPrefix("", [&](EntityId, std::string_view) { all++; });
+  rnAssert(all == ids.size());
+
+  // Removing, renaming and destroying keep the index in sync.
+  world.removeComponent<NameComponent>(ids[2]);
+  rnAssert(world.findEntity("enemy_2") == ids[3]);
+  world.destroyEntity(ids[3]);
+  rnAssert(world.findEntity("enemy_2") == InvalidEntity);
+
+  world.setComponent(ids[0], NameComponent{ "player" });
+  rnAssert(world.findEntity("player") == ids[0]);
+  rnAssert(world.findEntity("light_0") == InvalidEntity);
+  rnAssert(world.getComponent<NameComponent>(ids[0]).name == std::string_view{ "player" });
+
+  world.setComponent(ids[2], NameComponent{ "player" });
+  rnAssert(world.names().findAll("player").size() == 2);
+  rnAssert(world.names().size() == ids.size() - 1);
+
+  found.clear();
+  world.names().forEachWithPrefix("pl", [&](EntityId, std::string_view name) { found.push_back(name); });
+  rnAssert(found.size() == 2 && found[0] == "player");
+
+  // Swap removal moves the last entity with a name into the hole.
+  std::vector<EntityId> crowd = world.createEntities(100);
+  for (const EntityId id : crowd)
+    world.addComponent(id, NameComponent{ "crowd" });
+  for (size_t i = 0; i < crowd.size(); i += 3)
+    world.destroyEntity(crowd[i]);
+  const std::span<const EntityId> left = world.names().findAll("crowd");
+  rnAssert(left.size() == 66);
+  for (const EntityId id : left)
+    rnAssert(world.alive(id) && world.names().contains(id));
+
+  // Entities from prefabs are named too, and unnamed ones don't count.
+  Prefab prefab;
+  prefab.add(NameComponent{ "spawned" }).add(PositionComponent{});
+  world.instantiate(prefab, 10);
+  world.createEntities(10);
+  rnAssert(world.names().findAll("spawned").size() == 10);
+  rnAssert(world.names().size() == ids.size() - 1 + 66 + 10);
+}
+
+void run_tests() {
+  test_query();
+  test_change_detection();
+  test_prefab();
+  test_wide_signatures();
+  test_names();
+}
+
+int main() {
+  run_tests();
+
+  std::cout << "Tests passed!" << std::endl;
+
+  return 0;
+}